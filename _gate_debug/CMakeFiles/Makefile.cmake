@@ -0,0 +1,57 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "CMakeFiles/3.25.1/CMakeCCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "/root/repo/host/CMakeLists.txt"
+  "/usr/share/cmake-3.25/Modules/CMakeCInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "CMakeFiles/mesh_core.dir/DependInfo.cmake"
+  "CMakeFiles/bench_peers.dir/DependInfo.cmake"
+  "CMakeFiles/bench_parser.dir/DependInfo.cmake"
+  "CMakeFiles/fuzz_adv_parser.dir/DependInfo.cmake"
+  "CMakeFiles/telemetry_dump.dir/DependInfo.cmake"
+  "CMakeFiles/provision_hex.dir/DependInfo.cmake"
+  "CMakeFiles/mesh_core_sim.dir/DependInfo.cmake"
+  "CMakeFiles/mesh_sim.dir/DependInfo.cmake"
+  "CMakeFiles/test_adv_codec.dir/DependInfo.cmake"
+  "CMakeFiles/test_config_store.dir/DependInfo.cmake"
+  "CMakeFiles/test_provisioner.dir/DependInfo.cmake"
+  "CMakeFiles/test_mode_change.dir/DependInfo.cmake"
+  "CMakeFiles/test_lvlup_token.dir/DependInfo.cmake"
+  "CMakeFiles/test_overseer.dir/DependInfo.cmake"
+  "CMakeFiles/test_profiler.dir/DependInfo.cmake"
+  )
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/bench_parser.dir/adv_corpus.c.o"
+  "CMakeFiles/bench_parser.dir/adv_corpus.c.o.d"
+  "CMakeFiles/bench_parser.dir/bench_parser.c.o"
+  "CMakeFiles/bench_parser.dir/bench_parser.c.o.d"
+  "bench_parser"
+  "bench_parser.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/bench_parser.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/bench_peers.dir/bench_peers.c.o"
+  "CMakeFiles/bench_peers.dir/bench_peers.c.o.d"
+  "bench_peers"
+  "bench_peers.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/bench_peers.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/host/adv_corpus.c" "CMakeFiles/fuzz_adv_parser.dir/adv_corpus.c.o" "gcc" "CMakeFiles/fuzz_adv_parser.dir/adv_corpus.c.o.d"
+  "/root/repo/host/fuzz_adv_parser.c" "CMakeFiles/fuzz_adv_parser.dir/fuzz_adv_parser.c.o" "gcc" "CMakeFiles/fuzz_adv_parser.dir/fuzz_adv_parser.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gate_debug/CMakeFiles/mesh_core.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
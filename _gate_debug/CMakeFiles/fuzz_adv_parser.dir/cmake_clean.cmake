@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/fuzz_adv_parser.dir/adv_corpus.c.o"
+  "CMakeFiles/fuzz_adv_parser.dir/adv_corpus.c.o.d"
+  "CMakeFiles/fuzz_adv_parser.dir/fuzz_adv_parser.c.o"
+  "CMakeFiles/fuzz_adv_parser.dir/fuzz_adv_parser.c.o.d"
+  "fuzz_adv_parser"
+  "fuzz_adv_parser.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/fuzz_adv_parser.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,21 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mesh_core.dir/platform_host.c.o"
+  "CMakeFiles/mesh_core.dir/platform_host.c.o.d"
+  "CMakeFiles/mesh_core.dir/root/repo/src/adv_ring.c.o"
+  "CMakeFiles/mesh_core.dir/root/repo/src/adv_ring.c.o.d"
+  "CMakeFiles/mesh_core.dir/root/repo/src/config_store.c.o"
+  "CMakeFiles/mesh_core.dir/root/repo/src/config_store.c.o.d"
+  "CMakeFiles/mesh_core.dir/root/repo/src/mesh_core.c.o"
+  "CMakeFiles/mesh_core.dir/root/repo/src/mesh_core.c.o.d"
+  "CMakeFiles/mesh_core.dir/root/repo/src/peer_table.c.o"
+  "CMakeFiles/mesh_core.dir/root/repo/src/peer_table.c.o.d"
+  "CMakeFiles/mesh_core.dir/root/repo/src/profiler.c.o"
+  "CMakeFiles/mesh_core.dir/root/repo/src/profiler.c.o.d"
+  "libmesh_core.a"
+  "libmesh_core.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/mesh_core.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
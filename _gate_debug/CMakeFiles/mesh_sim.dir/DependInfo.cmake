@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/host/sim/sim.c" "CMakeFiles/mesh_sim.dir/sim/sim.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim/sim.c.o.d"
+  "/root/repo/host/sim/sim_core.c" "CMakeFiles/mesh_sim.dir/sim/sim_core.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim/sim_core.c.o.d"
+  "/root/repo/host/sim/sim_main.c" "CMakeFiles/mesh_sim.dir/sim/sim_main.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim/sim_main.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gate_debug/CMakeFiles/mesh_core_sim.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mesh_sim.dir/sim/sim.c.o"
+  "CMakeFiles/mesh_sim.dir/sim/sim.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim/sim_core.c.o"
+  "CMakeFiles/mesh_sim.dir/sim/sim_core.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim/sim_main.c.o"
+  "CMakeFiles/mesh_sim.dir/sim/sim_main.c.o.d"
+  "mesh_sim"
+  "mesh_sim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/mesh_sim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
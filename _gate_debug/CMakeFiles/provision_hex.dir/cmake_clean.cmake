@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/provision_hex.dir/provision_hex.c.o"
+  "CMakeFiles/provision_hex.dir/provision_hex.c.o.d"
+  "provision_hex"
+  "provision_hex.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/provision_hex.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_adv_codec.dir/test_adv_codec.c.o"
+  "CMakeFiles/test_adv_codec.dir/test_adv_codec.c.o.d"
+  "test_adv_codec"
+  "test_adv_codec.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_adv_codec.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_config_store.dir/test_config_store.c.o"
+  "CMakeFiles/test_config_store.dir/test_config_store.c.o.d"
+  "test_config_store"
+  "test_config_store.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_config_store.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
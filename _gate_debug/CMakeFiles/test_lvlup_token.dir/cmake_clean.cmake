@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_lvlup_token.dir/test_lvlup_token.c.o"
+  "CMakeFiles/test_lvlup_token.dir/test_lvlup_token.c.o.d"
+  "test_lvlup_token"
+  "test_lvlup_token.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_lvlup_token.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
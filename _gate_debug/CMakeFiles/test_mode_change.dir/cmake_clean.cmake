@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_mode_change.dir/test_mode_change.c.o"
+  "CMakeFiles/test_mode_change.dir/test_mode_change.c.o.d"
+  "test_mode_change"
+  "test_mode_change.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_mode_change.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_overseer.dir/test_overseer.c.o"
+  "CMakeFiles/test_overseer.dir/test_overseer.c.o.d"
+  "test_overseer"
+  "test_overseer.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_overseer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
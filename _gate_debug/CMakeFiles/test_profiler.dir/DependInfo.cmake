@@ -0,0 +1,25 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/host/platform_host.c" "CMakeFiles/test_profiler.dir/platform_host.c.o" "gcc" "CMakeFiles/test_profiler.dir/platform_host.c.o.d"
+  "/root/repo/src/adv_ring.c" "CMakeFiles/test_profiler.dir/root/repo/src/adv_ring.c.o" "gcc" "CMakeFiles/test_profiler.dir/root/repo/src/adv_ring.c.o.d"
+  "/root/repo/src/config_store.c" "CMakeFiles/test_profiler.dir/root/repo/src/config_store.c.o" "gcc" "CMakeFiles/test_profiler.dir/root/repo/src/config_store.c.o.d"
+  "/root/repo/src/mesh_core.c" "CMakeFiles/test_profiler.dir/root/repo/src/mesh_core.c.o" "gcc" "CMakeFiles/test_profiler.dir/root/repo/src/mesh_core.c.o.d"
+  "/root/repo/src/peer_table.c" "CMakeFiles/test_profiler.dir/root/repo/src/peer_table.c.o" "gcc" "CMakeFiles/test_profiler.dir/root/repo/src/peer_table.c.o.d"
+  "/root/repo/src/profiler.c" "CMakeFiles/test_profiler.dir/root/repo/src/profiler.c.o" "gcc" "CMakeFiles/test_profiler.dir/root/repo/src/profiler.c.o.d"
+  "/root/repo/host/test_profiler.c" "CMakeFiles/test_profiler.dir/test_profiler.c.o" "gcc" "CMakeFiles/test_profiler.dir/test_profiler.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
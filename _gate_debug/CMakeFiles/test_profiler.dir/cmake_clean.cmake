@@ -0,0 +1,23 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_profiler.dir/platform_host.c.o"
+  "CMakeFiles/test_profiler.dir/platform_host.c.o.d"
+  "CMakeFiles/test_profiler.dir/root/repo/src/adv_ring.c.o"
+  "CMakeFiles/test_profiler.dir/root/repo/src/adv_ring.c.o.d"
+  "CMakeFiles/test_profiler.dir/root/repo/src/config_store.c.o"
+  "CMakeFiles/test_profiler.dir/root/repo/src/config_store.c.o.d"
+  "CMakeFiles/test_profiler.dir/root/repo/src/mesh_core.c.o"
+  "CMakeFiles/test_profiler.dir/root/repo/src/mesh_core.c.o.d"
+  "CMakeFiles/test_profiler.dir/root/repo/src/peer_table.c.o"
+  "CMakeFiles/test_profiler.dir/root/repo/src/peer_table.c.o.d"
+  "CMakeFiles/test_profiler.dir/root/repo/src/profiler.c.o"
+  "CMakeFiles/test_profiler.dir/root/repo/src/profiler.c.o.d"
+  "CMakeFiles/test_profiler.dir/test_profiler.c.o"
+  "CMakeFiles/test_profiler.dir/test_profiler.c.o.d"
+  "test_profiler"
+  "test_profiler.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_profiler.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
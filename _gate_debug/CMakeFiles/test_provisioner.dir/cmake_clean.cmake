@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_provisioner.dir/test_provisioner.c.o"
+  "CMakeFiles/test_provisioner.dir/test_provisioner.c.o.d"
+  "test_provisioner"
+  "test_provisioner.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_provisioner.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
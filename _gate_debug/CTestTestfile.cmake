@@ -0,0 +1,28 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/host
+# Build directory: /root/repo/_gate_debug
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test([=[adv_codec]=] "/root/repo/_gate_debug/test_adv_codec" "1000000")
+set_tests_properties([=[adv_codec]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;88;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[config_store]=] "/root/repo/_gate_debug/test_config_store")
+set_tests_properties([=[config_store]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;92;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[provisioner]=] "/root/repo/_gate_debug/test_provisioner")
+set_tests_properties([=[provisioner]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;96;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[mode_change]=] "/root/repo/_gate_debug/test_mode_change")
+set_tests_properties([=[mode_change]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;100;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[lvlup_token]=] "/root/repo/_gate_debug/test_lvlup_token")
+set_tests_properties([=[lvlup_token]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;104;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[overseer]=] "/root/repo/_gate_debug/test_overseer")
+set_tests_properties([=[overseer]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;108;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[profiler]=] "/root/repo/_gate_debug/test_profiler")
+set_tests_properties([=[profiler]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;122;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[adv_parser_replay]=] "/root/repo/_gate_debug/fuzz_adv_parser" "64" "/root/repo/host/corpus/hall_mix.txt")
+set_tests_properties([=[adv_parser_replay]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;124;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[telemetry_dump_sample]=] "/root/repo/_gate_debug/telemetry_dump" "/root/repo/host/corpus/telemetry_sample.txt")
+set_tests_properties([=[telemetry_dump_sample]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;126;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[provision_hex_sample]=] "/root/repo/_gate_debug/provision_hex" "/root/repo/host/corpus/provision_sample.txt")
+set_tests_properties([=[provision_hex_sample]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;127;add_test;/root/repo/host/CMakeLists.txt;0;")
+add_test([=[mesh_sim_smoke]=] "/root/repo/_gate_debug/mesh_sim" "--auras" "60" "--devices" "8" "--overseers" "1" "--seconds" "60" "--warmup" "20" "--seed" "1,2" "-j" "2")
+set_tests_properties([=[mesh_sim_smoke]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/host/CMakeLists.txt;128;add_test;/root/repo/host/CMakeLists.txt;0;")
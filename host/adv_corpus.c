@@ -0,0 +1,77 @@
+/* adv_corpus.c - Loader for recorded scan report mixes (host tools only) */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adv_corpus.h"
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = (char)toupper((unsigned char)c);
+    return c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+int adv_corpus_load(const char *path, adv_corpus_report_t *reports, int count, int max) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_no++;
+        int weight;
+        int rssi;
+        char hex[128];
+        char *start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+        if (sscanf(start, "%d %d %127s", &weight, &rssi, hex) != 3 || weight < 0 ||
+            rssi < -128 || rssi > 127 || strlen(hex) % 2 != 0 || strlen(hex) / 2 > ADV_CORPUS_MAX_DATA) {
+            fprintf(stderr, "%s:%d: expected <weight> <rssi> <hex, at most %d bytes>\n",
+                    path, line_no, ADV_CORPUS_MAX_DATA);
+            fclose(file);
+            return -1;
+        }
+
+        adv_corpus_report_t report = {.rssi = (int8_t)rssi, .len = (uint8_t)(strlen(hex) / 2)};
+        for (int i = 0; i < report.len; i++) {
+            int hi = hex_nibble(hex[2 * i]);
+            int lo = hex_nibble(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) {
+                fprintf(stderr, "%s:%d: bad hex\n", path, line_no);
+                fclose(file);
+                return -1;
+            }
+            report.data[i] = (uint8_t)(hi << 4 | lo);
+        }
+
+        for (int rep = 0; rep < weight && count < max; rep++) {
+            // Locally administered MAC: line number and repetition
+            report.mac[0] = 0xC2;
+            report.mac[1] = (uint8_t)(line_no >> 8);
+            report.mac[2] = (uint8_t)line_no;
+            report.mac[3] = (uint8_t)(rep >> 16);
+            report.mac[4] = (uint8_t)(rep >> 8);
+            report.mac[5] = (uint8_t)rep;
+            reports[count++] = report;
+        }
+    }
+    fclose(file);
+    return count;
+}
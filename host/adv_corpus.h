@@ -0,0 +1,29 @@
+/* adv_corpus.h - Loader for recorded scan report mixes (host tools only) */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ADV_CORPUS_H
+#define ADV_CORPUS_H
+
+#include <stdint.h>
+#include "defines.h"
+
+#define ADV_CORPUS_MAX_DATA 31 // Legacy advertising data limit
+
+// One scan report as scan_cb would receive it
+typedef struct {
+    uint8_t mac[MAC_LEN]; // Unique per report, derived from line and repetition
+    int8_t rssi;
+    uint8_t len; // Bytes of AD structures in data
+    uint8_t data[ADV_CORPUS_MAX_DATA];
+} adv_corpus_report_t;
+
+// Append the reports of a corpus file (see corpus/hall_mix.txt for the format),
+// each line repeated by its weight, up to max reports in total.
+// Returns the new total, or -1 if the file cannot be read or a line is malformed.
+int adv_corpus_load(const char *path, adv_corpus_report_t *reports, int count, int max);
+
+#endif /* ADV_CORPUS_H */
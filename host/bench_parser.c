@@ -0,0 +1,172 @@
+/* bench_parser.c - Scan report parser microbenchmark on recorded advert mixes */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Loads one or more corpus files (corpus/hall_mix.txt by default), shuffles
+ * the weighted reports and times three paths over the whole mix:
+ *
+ *   copy        the original scan_cb front end: copy the buffer state, clear
+ *               a 16-byte mfg buffer, copy the first manufacturer data out,
+ *               then check the magic
+ *   adv_parse   mesh_core_find_payload(): RSSI gate and in-place adv_parse()
+ *   scan_report mesh_core_scan_report() in device mode, parse plus handlers,
+ *               with one end of cycle per pass
+ *
+ * accepted is the share of reports handed on to the decoders.
+ *
+ * Usage: bench_parser [passes] [corpus_file...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "adv_corpus.h"
+#include "mesh_core.h"
+#include "platform_host.h"
+#include "defines.h"
+
+#ifndef ADV_CORPUS_DIR
+#define ADV_CORPUS_DIR "corpus"
+#endif
+
+#define MAX_REPORTS 8192
+
+static adv_corpus_report_t reports[MAX_REPORTS];
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void) {
+    // xorshift64*, deterministic between runs
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// The scan_cb front end before adv_parse(), with net_buf_simple reduced to data/len
+struct copy_buf {
+    const uint8_t *data;
+    uint16_t len;
+};
+
+static const uint8_t *copy_find_payload(int8_t rssi, const struct copy_buf *buf, uint8_t *mfg, int *mfg_len) {
+    if (rssi < RSSI_SCAN_GATE) {
+        return NULL;
+    }
+    memset(mfg, 0, 16);
+    *mfg_len = 0;
+    struct copy_buf temp = *buf;
+    while (temp.len > 1) {
+        uint8_t length = *temp.data++;
+        temp.len--;
+        if (length == 0 || length > temp.len) {
+            break;
+        }
+        uint8_t type = *temp.data++;
+        temp.len--;
+        length -= 1;
+        if (type == BT_DATA_MANUFACTURER_DATA && length >= 2) {
+            memcpy(mfg, temp.data, length > 16 ? 16 : length);
+            *mfg_len = length;
+            break;
+        }
+        temp.data += length;
+        temp.len -= length;
+    }
+    if ((*mfg_len >= MESH_ADV_LEN && adv_kind(mfg) == ADV_KIND_MESH) ||
+        (*mfg_len >= MASTER_ADV_LEN && adv_kind(mfg) == ADV_KIND_MASTER) ||
+        (*mfg_len >= OVERSEER_V2_LEN(1) && adv_kind(mfg) == ADV_KIND_OVERSEER)) {
+        return mfg;
+    }
+    return NULL;
+}
+
+static void report_line(const char *path, uint64_t ns, uint64_t runs, uint64_t accepted) {
+    printf("%-12s %9.2f %9.1f%%\n", path, (double)ns / (double)runs, 100.0 * (double)accepted / (double)runs);
+}
+
+int main(int argc, char **argv) {
+    static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+    int passes = argc > 1 ? atoi(argv[1]) : 200;
+    int count = 0;
+
+    if (passes <= 0) {
+        fprintf(stderr, "usage: %s [passes] [corpus_file...]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        for (int i = 2; i < argc && count >= 0; i++) {
+            count = adv_corpus_load(argv[i], reports, count, MAX_REPORTS);
+        }
+    } else {
+        count = adv_corpus_load(ADV_CORPUS_DIR "/hall_mix.txt", reports, 0, MAX_REPORTS);
+    }
+    if (count <= 0) {
+        fprintf(stderr, "no reports loaded\n");
+        return 1;
+    }
+
+    // Interleave the mix as the radio would
+    for (int i = count - 1; i > 0; i--) {
+        int j = rng_next() % (i + 1);
+        adv_corpus_report_t tmp = reports[i];
+        reports[i] = reports[j];
+        reports[j] = tmp;
+    }
+
+    device_info.mode = MODE_DEVICE;
+    device_info.affinity = AFFINITY_MAGIC;
+    device_info.level = 1;
+    mesh_core_init(own_mac);
+    set_mode(MODE_DEVICE);
+
+    uint64_t runs = (uint64_t)count * passes;
+    uint64_t accepted = 0;
+    volatile uint32_t sink = 0;
+    uint8_t mfg[16];
+    int mfg_len;
+
+    printf("reports=%d passes=%d\n", count, passes);
+    printf("%-12s %9s %10s\n", "path", "ns/report", "accepted");
+
+    uint64_t start = host_time_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int i = 0; i < count; i++) {
+            struct copy_buf buf = {reports[i].data, reports[i].len};
+            if (copy_find_payload(reports[i].rssi, &buf, mfg, &mfg_len)) {
+                accepted++;
+                sink += mfg[2];
+            }
+        }
+    }
+    report_line("copy", host_time_ns() - start, runs, accepted);
+
+    accepted = 0;
+    start = host_time_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int i = 0; i < count; i++) {
+            uint8_t payload_len;
+            const uint8_t *payload = mesh_core_find_payload(reports[i].rssi, reports[i].data, reports[i].len, &payload_len);
+            if (payload) {
+                accepted++;
+                sink += payload[2];
+            }
+        }
+    }
+    report_line("adv_parse", host_time_ns() - start, runs, accepted);
+
+    start = host_time_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int i = 0; i < count; i++) {
+            mesh_core_scan_report(reports[i].mac, reports[i].rssi, reports[i].data, reports[i].len);
+        }
+        mesh_core_end_of_cycle();
+    }
+    report_line("scan_report", host_time_ns() - start, runs, accepted);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/* bench_peers.c - Peer table microbenchmark on synthetic advert streams */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Drives N synthetic aura pendants through mesh_core_scan_report() (the same
+ * entry point scan_cb uses on target) and times it, then times the
+ * end-of-cycle handler. Each cycle a fraction of the population walks out
+ * and is replaced by new MACs, so the table sees realistic churn.
+ *
+ * max_disp is the largest home-slot distance left in the table after the
+ * last cycle; dropped counts new peers refused by the capacity/probe bound.
+ * Configured with -DCYCLE_PROFILER=ON, every run is followed by the profiler
+ * histograms of the core probes (end of cycle, age_peers, count_stable, set_mode).
+ *
+ * Usage: bench_peers [cycles] [reports_per_peer_per_cycle] [churn_percent]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "mesh_core.h"
+#include "peer_table.h"
+#include "platform_host.h"
+#include "profiler.h"
+#include "defines.h"
+
+#define MAX_BENCH_PEERS 1024
+
+typedef struct {
+    uint8_t mac[MAC_LEN];
+    uint8_t adv[2 + MESH_ADV_LEN]; // [len][type][mfg data]
+} bench_peer_t;
+
+static bench_peer_t population[MAX_BENCH_PEERS];
+static uint16_t order[MAX_BENCH_PEERS * 16];
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void) {
+    // xorshift64*, deterministic between runs
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static void make_peer(bench_peer_t *peer) {
+    for (int i = 0; i < MAC_LEN; i++) {
+        peer->mac[i] = (uint8_t)rng_next();
+    }
+    device_info_t info = {
+        .mode = MODE_AURA,
+        .affinity = rng_next() % 3,
+        .level = rng_next() % (MAX_AURA_LEVEL + 1),
+    };
+    peer->adv[0] = 1 + MESH_ADV_LEN;
+    peer->adv[1] = 0xFF; // Manufacturer specific data
+    adv_mesh_encode(&peer->adv[2], &info, 1);
+}
+
+#if CYCLE_PROFILER
+// Median, 99th percentile as bucket upper bounds (2^b ns) and the exact maximum
+static void print_profile(void) {
+    for (int probe = 0; probe < PROF_PROBE_COUNT; probe++) {
+        const prof_histogram_t *h = prof_histogram((prof_probe_t)probe);
+        if (!h->count) {
+            continue;
+        }
+        printf("  %-13s n=%-7u p50<%-10lu p99<%-10lu max=%u ns\n", prof_probe_name((prof_probe_t)probe),
+               (unsigned)h->count, 1ul << prof_percentile_bucket((prof_probe_t)probe, 50),
+               1ul << prof_percentile_bucket((prof_probe_t)probe, 99), (unsigned)h->max);
+    }
+}
+#endif
+
+static void run(operation_mode_t mode, int peers, int cycles, int reports, int churn_percent) {
+    static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+
+    device_info.mode = mode;
+    device_info.affinity = AFFINITY_MAGIC;
+    device_info.level = 1;
+    mesh_core_init(own_mac);
+    prof_reset();
+    set_mode(mode);
+
+    for (int i = 0; i < peers; i++) {
+        make_peer(&population[i]);
+    }
+
+    uint64_t scan_ns = 0;
+    uint64_t eoc_ns = 0;
+    uint64_t eoc_max_ns = 0;
+    uint64_t report_count = 0;
+    peer_table_reset_stats();
+
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        // Churn: some players leave the hall and new ones arrive
+        int leaving = peers * churn_percent / 100;
+        for (int i = 0; i < leaving; i++) {
+            make_peer(&population[rng_next() % peers]);
+        }
+
+        // Interleave every peer's reports in random order, as the radio would
+        int total = peers * reports;
+        for (int i = 0; i < total; i++) {
+            order[i] = i % peers;
+        }
+        for (int i = total - 1; i > 0; i--) {
+            int j = rng_next() % (i + 1);
+            uint16_t tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+
+        uint64_t start = host_time_ns();
+        for (int i = 0; i < total; i++) {
+            const bench_peer_t *peer = &population[order[i]];
+            mesh_core_scan_report(peer->mac, -50, peer->adv, sizeof(peer->adv));
+        }
+        uint64_t mid = host_time_ns();
+        mesh_core_end_of_cycle();
+        uint64_t end = host_time_ns();
+
+        scan_ns += mid - start;
+        report_count += total;
+        eoc_ns += end - mid;
+        if (end - mid > eoc_max_ns) {
+            eoc_max_ns = end - mid;
+        }
+    }
+
+    const peer_table_stats_t *stats = peer_table_stats();
+    printf("%-8s %5d %9.1f %9.2f %9u %9u %11.1f %11.1f %6u %8u %7u\n",
+           mode == MODE_DEVICE ? "device" : "overseer",
+           peers,
+           (double)scan_ns / (double)report_count,
+           stats->lookups ? (double)stats->probes / (double)stats->lookups : 0.0,
+           (unsigned)stats->max_probe,
+           (unsigned)stats->max_displacement,
+           (double)eoc_ns / (double)cycles / 1000.0,
+           (double)eoc_max_ns / 1000.0,
+           (unsigned)peer_count,
+           (unsigned)stats->dropped,
+           (unsigned)mesh_core_adv()->interval_min * 625 / 1000);
+#if CYCLE_PROFILER
+    print_profile();
+#endif
+}
+
+int main(int argc, char **argv) {
+    int cycles = argc > 1 ? atoi(argv[1]) : 200;
+    int reports = argc > 2 ? atoi(argv[2]) : 9; // ~3 adv events x 3 channels per 3.5s cycle
+    int churn_percent = argc > 3 ? atoi(argv[3]) : 5;
+    static const int sizes[] = {130, 255, 500};
+
+    if (cycles <= 0 || reports <= 0 || reports > 16 || churn_percent < 0 || churn_percent > 100) {
+        fprintf(stderr, "usage: %s [cycles] [reports_per_peer_per_cycle (1-16)] [churn_percent]\n", argv[0]);
+        return 1;
+    }
+
+    printf("cycles=%d reports/peer/cycle=%d churn=%d%% capacity=%d slots=%d\n",
+           cycles, reports, churn_percent, MAX_PEERS, PEER_TABLE_SIZE);
+    printf("%-8s %5s %9s %9s %9s %9s %11s %11s %6s %8s %7s\n",
+           "mode", "peers", "ns/adv", "avg_probe", "max_probe", "max_disp", "eoc_avg_us", "eoc_max_us", "table", "dropped",
+           "adv_ms");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run(MODE_DEVICE, sizes[i], cycles, reports, churn_percent);
+        run(MODE_OVERSEER, sizes[i], cycles, reports, churn_percent);
+    }
+    return 0;
+}
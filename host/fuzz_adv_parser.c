@@ -0,0 +1,189 @@
+/* fuzz_adv_parser.c - libFuzzer target for the scan report parser and decoders */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Input: [control][rssi][mac:6][AD structures...]
+ *   control bits 0-2 pick the mode (mod 5), bit 7 runs an end of cycle after
+ *   the report.
+ *
+ * Each input goes the way scan_cb and adv_worker take it on target:
+ * mesh_core_find_payload(), adv_ring push/pop, mesh_core_process_payload().
+ * adv_parse() results are checked against the report bounds and the per-kind
+ * minimum lengths; any violation aborts.
+ *
+ * Built with -DADV_FUZZ=ON (clang) this is a libFuzzer binary. Otherwise a
+ * replay driver is linked in: it runs every report of the given corpus files
+ * in all modes, plus deterministic mutations of each (byte flips, truncation,
+ * length byte changes), so the ctest run exercises the same checks with gcc.
+ *
+ * Usage (replay): fuzz_adv_parser [mutations_per_report] corpus_file...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "adv_ring.h"
+#include "mesh_core.h"
+#include "peer_table.h"
+#include "defines.h"
+
+#define FUZZ_HEADER_LEN (2 + MAC_LEN)
+
+#define FUZZ_CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        abort(); \
+    } \
+} while (0)
+
+int LLVMFuzzerTestOneInput(const uint8_t *input, size_t size) {
+    static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+    static bool initialized;
+    static operation_mode_t mode = MODE_NONE;
+
+    if (!initialized) {
+        mesh_core_init(own_mac);
+        set_mode(MODE_NONE);
+        initialized = true;
+    }
+    if (size < FUZZ_HEADER_LEN || size - FUZZ_HEADER_LEN > UINT16_MAX) {
+        return 0;
+    }
+
+    operation_mode_t wanted = (operation_mode_t)((input[0] & 0x07) % (MODE_PROVISIONER + 1));
+    int8_t rssi = (int8_t)input[1];
+    const uint8_t *mac = &input[2];
+    const uint8_t *data = &input[FUZZ_HEADER_LEN];
+    uint16_t len = (uint16_t)(size - FUZZ_HEADER_LEN);
+
+    if (wanted != mode) {
+        mode = wanted;
+        device_info.mode = mode;
+        set_mode(mode);
+    }
+
+    // Parser invariants
+    const uint8_t *payload;
+    uint8_t payload_len;
+    adv_kind_t kind = adv_parse(data, len, &payload, &payload_len);
+    if (kind != ADV_KIND_NONE) {
+        FUZZ_CHECK(payload >= data + 2 && payload + payload_len <= data + len);
+        FUZZ_CHECK(payload_len >= adv_min_len(kind) && payload_len <= ADV_RECORD_MAX_DATA);
+        FUZZ_CHECK(adv_kind(payload) == kind);
+        FUZZ_CHECK(payload[-1] == BT_DATA_MANUFACTURER_DATA);
+    }
+
+    uint8_t found_len;
+    const uint8_t *found = mesh_core_find_payload(rssi, data, len, &found_len);
+    FUZZ_CHECK(found == (rssi >= RSSI_SCAN_GATE && kind != ADV_KIND_NONE ? payload : NULL));
+
+    // Same path as scan_cb -> adv_worker
+    if (found) {
+        adv_record_t record;
+        FUZZ_CHECK(adv_ring_push(mac, rssi, found, found_len));
+        FUZZ_CHECK(adv_ring_pop(&record));
+        FUZZ_CHECK(record.len == found_len && memcmp(record.data, found, found_len) == 0);
+        mesh_core_process_payload(record.mac, record.rssi, record.data, record.len);
+    }
+    if (mesh_core_mode_changed()) {
+        mode = (operation_mode_t)device_info.mode;
+        set_mode(mode);
+    }
+    if (input[0] & 0x80) {
+        mesh_core_end_of_cycle();
+    }
+    FUZZ_CHECK(peer_count <= MAX_PEERS);
+    FUZZ_CHECK(mesh_core_adv()->len <= ADV_RECORD_MAX_DATA);
+    FUZZ_CHECK(!mesh_core_adv()->telemetry_len ||
+               mesh_core_adv()->len + mesh_core_adv()->telemetry_len + 4 <= ADV_DATA_MAX_LEN);
+    return 0;
+}
+
+#ifndef ADV_FUZZ_LIBFUZZER
+
+#include "adv_corpus.h"
+
+#define MAX_REPORTS 4096
+
+static adv_corpus_report_t reports[MAX_REPORTS];
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng_next(void) {
+    // xorshift64*, deterministic between runs
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// Build a fuzz input from a corpus report, then apply mutation number m (0 = none)
+static size_t make_input(uint8_t *input, const adv_corpus_report_t *report, uint8_t control, int m) {
+    input[0] = control;
+    input[1] = (uint8_t)report->rssi;
+    memcpy(&input[2], report->mac, MAC_LEN);
+    memcpy(&input[FUZZ_HEADER_LEN], report->data, report->len);
+    size_t size = FUZZ_HEADER_LEN + report->len;
+    if (m == 0 || report->len == 0) {
+        return size;
+    }
+
+    uint8_t *data = &input[FUZZ_HEADER_LEN];
+    switch (m % 4) {
+    case 0: // Truncate
+        return FUZZ_HEADER_LEN + rng_next() % report->len;
+    case 1: // Flip a bit
+        data[rng_next() % report->len] ^= (uint8_t)(1 << (rng_next() & 7));
+        break;
+    case 2: // Rewrite the first length byte
+        data[0] = (uint8_t)rng_next();
+        break;
+    default: // Random byte, then random trailing garbage
+        data[rng_next() % report->len] = (uint8_t)rng_next();
+        while (size < FUZZ_HEADER_LEN + ADV_CORPUS_MAX_DATA && (rng_next() & 1)) {
+            input[size++] = (uint8_t)rng_next();
+        }
+        break;
+    }
+    return size;
+}
+
+int main(int argc, char **argv) {
+    int mutations = argc > 1 ? atoi(argv[1]) : -1;
+    int count = 0;
+
+    if (argc < 3 || mutations < 0) {
+        fprintf(stderr, "usage: %s mutations_per_report corpus_file...\n", argv[0]);
+        return 1;
+    }
+    for (int i = 2; i < argc && count >= 0; i++) {
+        count = adv_corpus_load(argv[i], reports, count, MAX_REPORTS);
+    }
+    if (count <= 0) {
+        fprintf(stderr, "no reports loaded\n");
+        return 1;
+    }
+
+    uint8_t input[FUZZ_HEADER_LEN + ADV_CORPUS_MAX_DATA];
+    unsigned long runs = 0;
+    for (int i = 0; i < count; i++) {
+        for (int m = 0; m <= mutations; m++) {
+            uint8_t control = (uint8_t)((i + m) % (MODE_PROVISIONER + 1));
+            if ((rng_next() & 0x3F) == 0) {
+                control |= 0x80;
+            }
+            size_t size = make_input(input, &reports[i], control, m);
+            LLVMFuzzerTestOneInput(input, size);
+            runs++;
+        }
+    }
+    printf("%lu inputs from %d reports, all checks passed\n", runs, count);
+    return 0;
+}
+
+#endif /* ADV_FUZZ_LIBFUZZER */
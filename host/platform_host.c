@@ -0,0 +1,65 @@
+/* platform_host.c - Linux implementation of the platform shim */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "platform.h"
+#include "platform_host.h"
+#include "defines.h"
+
+host_platform_t host_platform;
+
+void platform_set_output_pin(bool state) {
+    host_platform.output_pin = state;
+    host_platform.output_pin_writes++;
+}
+
+void platform_set_led_state(int led_idx, enum led_state state) {
+    if (led_idx >= 0 && led_idx < 3) {
+        host_platform.leds[led_idx] = state;
+    }
+}
+
+void platform_mode_transition(void) {
+    host_platform.mode_transitions++; // No LEDs to blink, no delay on the host
+}
+
+void platform_request_mode_change(void) {
+    host_platform.mode_change_requests++; // Host tools poll mesh_core_mode_changed()
+}
+
+void platform_store_device_info(const device_info_t *info) {
+    host_platform.stored_device_info = *info;
+    host_platform.device_info_writes++;
+}
+
+bool platform_read_provision_record(uint16_t index, uint8_t *record) {
+    if (index >= host_platform.provision_record_count) {
+        return false;
+    }
+    memcpy(record, &host_platform.provision_records[index * PROVISION_RECORD_LEN], PROVISION_RECORD_LEN);
+    return true;
+}
+
+void platform_get_telemetry(platform_telemetry_t *telemetry) {
+    *telemetry = host_platform.telemetry;
+}
+
+uint32_t platform_cycles(void) {
+    return (uint32_t)host_time_ns(); // Nanoseconds, wraps every ~4.3 s
+}
+
+uint32_t platform_cycles_per_sec(void) {
+    return 1000000000u;
+}
+
+uint64_t host_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
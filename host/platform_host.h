@@ -0,0 +1,34 @@
+/* platform_host.h - Linux implementation of the platform shim */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PLATFORM_HOST_H
+#define PLATFORM_HOST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+
+// Everything the core asked the "board" to do, for inspection by host tools
+typedef struct {
+    bool output_pin; // Last value written to the output pin
+    uint32_t output_pin_writes; // Number of platform_set_output_pin calls
+    enum led_state leds[3]; // Last LED states by index
+    uint32_t mode_transitions; // Number of mode-change animations played
+    uint32_t mode_change_requests; // Number of platform_request_mode_change calls
+    uint32_t device_info_writes; // Number of flash writes requested
+    device_info_t stored_device_info; // Last device_info written to "flash"
+    platform_telemetry_t telemetry; // Returned by platform_get_telemetry, set by host tools
+    const uint8_t *provision_records; // Provisioner queue area (PROVISION_RECORD_LEN each), set by host tools
+    uint16_t provision_record_count;
+} host_platform_t;
+
+extern host_platform_t host_platform;
+
+// Monotonic time in nanoseconds, for benchmarks
+uint64_t host_time_ns(void);
+
+#endif /* PLATFORM_HOST_H */
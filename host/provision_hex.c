@@ -0,0 +1,198 @@
+/* provision_hex.c - Build the provisioner queue as an Intel HEX file */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Reads one assignment per line:
+ *
+ *   <mac> <mode> <affinity> <level> [threshold [zone [group]]]
+ *
+ *   e.g. C0:FF:EE:00:00:01 aura magic 2
+ *        C0:FF:EE:00:00:02 aura unity 1/3 0 0 5      (Unity aura: magic/techno levels)
+ *
+ * ('#' starts a comment; the MAC as printed by sniffers, most significant byte
+ * first; modes and affinities by name or number) and writes the queue area of
+ * a provisioner as Intel HEX, one PROVISION_RECORD_LEN-byte entry per line, to
+ * be merged with the firmware or flashed on its own (nrfjprog --program ...
+ * --sectorerase). An erased record follows the last entry and ends the queue.
+ * The queue area starts behind the NVS sectors of storage_partition
+ * (pm_static.yml), on the nRF51 with its 1 KB pages at 0x28C00.
+ *
+ * Usage: provision_hex [-a address] [assignments_file]   (stdin if none)
+ * Exit status is non-zero on a malformed line or a queue longer than PROVISION_QUEUE_MAX.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_store.h"
+#include "defines.h"
+
+#define DEFAULT_ADDRESS 0x28C00 // storage_partition + 3 NVS pages of 1 KB
+#define MAX_LINE 256
+
+static const char *mode_names[] = {"none", "aura", "device", "token", "overseer", "provisioner"};
+static const char *affinity_names[] = {"unity", "magic", "techno"};
+
+// Name or number from names[], -1 if neither
+static int lookup(const char *word, const char *const *names, int count) {
+    char *end;
+    long value = strtol(word, &end, 0);
+    if (*end == '\0') {
+        return value >= 0 && value < count ? (int)value : -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!strcmp(word, names[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// "AA:BB:CC:DD:EE:FF" -> val[] order (least significant byte first), as compared with own_mac
+static int parse_mac(const char *s, uint8_t *mac) {
+    unsigned b[MAC_LEN];
+    char tail;
+    if (sscanf(s, "%x:%x:%x:%x:%x:%x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &tail) != MAC_LEN) {
+        return -1;
+    }
+    for (int i = 0; i < MAC_LEN; i++) {
+        if (b[i] > 0xFF) {
+            return -1;
+        }
+        mac[MAC_LEN - 1 - i] = (uint8_t)b[i];
+    }
+    return 0;
+}
+
+// Plain level, or magic/techno for Unity auras
+static int parse_level(const char *s, uint8_t affinity, uint8_t *level) {
+    unsigned magic, techno, plain;
+    char tail;
+    if (affinity == AFFINITY_UNITY && sscanf(s, "%u/%u%c", &magic, &techno, &tail) == 2) {
+        if (magic > MAX_AURA_LEVEL || techno > MAX_AURA_LEVEL) {
+            return -1;
+        }
+        *level = (uint8_t)(magic << 4 | techno);
+        return 0;
+    }
+    if (sscanf(s, "%u%c", &plain, &tail) != 1 || plain > HOSTILE_ENVIRONMENT_LEVEL) {
+        return -1;
+    }
+    *level = (uint8_t)plain;
+    return 0;
+}
+
+static int parse_line(char *line, uint8_t *mac, device_info_t *info) {
+    char *words[7];
+    int count = 0;
+    for (char *word = strtok(line, " \t\r\n"); word && count < 7; word = strtok(NULL, " \t\r\n")) {
+        words[count++] = word;
+    }
+    int mode = count >= 4 ? lookup(words[1], mode_names, sizeof(mode_names) / sizeof(mode_names[0])) : -1;
+    int affinity = count >= 4 ? lookup(words[2], affinity_names, sizeof(affinity_names) / sizeof(affinity_names[0])) : -1;
+    if (mode < 0 || affinity < 0 || parse_mac(words[0], mac)) {
+        return -1;
+    }
+    memset(info, 0, sizeof(*info));
+    info->mode = (uint8_t)mode;
+    info->affinity = (uint8_t)affinity;
+    if (parse_level(words[3], info->affinity, &info->level)) {
+        return -1;
+    }
+    long extra[3] = {0, 0, 0};
+    for (int i = 4; i < count; i++) {
+        char *end;
+        extra[i - 4] = strtol(words[i], &end, 0);
+        if (*end != '\0') {
+            return -1;
+        }
+    }
+    if (extra[0] < -128 || extra[0] > 127 || extra[1] < 0 || extra[1] > 0xFF || extra[2] < 0 || extra[2] > 0xFF) {
+        return -1;
+    }
+    info->dynamic_rssi_threshold = (int8_t)extra[0];
+    info->zone = (uint8_t)extra[1];
+    info->group = (uint8_t)extra[2];
+    return 0;
+}
+
+static void hex_record(uint8_t type, uint16_t address, const uint8_t *data, uint8_t len) {
+    uint8_t sum = (uint8_t)(len + (address >> 8) + address + type);
+    printf(":%02X%04X%02X", len, address, type);
+    for (uint8_t i = 0; i < len; i++) {
+        printf("%02X", data[i]);
+        sum += data[i];
+    }
+    printf("%02X\n", (uint8_t)-sum);
+}
+
+int main(int argc, char **argv) {
+    unsigned long address = DEFAULT_ADDRESS;
+    int arg = 1;
+    if (arg + 1 < argc && !strcmp(argv[arg], "-a")) {
+        address = strtoul(argv[arg + 1], NULL, 0);
+        arg += 2;
+    }
+    FILE *in = arg < argc ? fopen(argv[arg], "r") : stdin;
+    if (!in) {
+        perror(argv[arg]);
+        return 1;
+    }
+
+    char line[MAX_LINE];
+    int line_no = 0;
+    int entries = 0;
+    unsigned long upper = ~0ul;
+    while (fgets(line, sizeof(line), in)) {
+        uint8_t mac[MAC_LEN];
+        device_info_t info;
+        uint8_t record[PROVISION_RECORD_LEN];
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        if (line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        if (parse_line(line, mac, &info)) {
+            fprintf(stderr, "line %d: malformed assignment\n", line_no);
+            return 1;
+        }
+        if (entries == PROVISION_QUEUE_MAX) {
+            fprintf(stderr, "line %d: more than %d assignments\n", line_no, PROVISION_QUEUE_MAX);
+            return 1;
+        }
+        unsigned long at = address + (unsigned long)entries * PROVISION_RECORD_LEN;
+        if ((at >> 16) != upper) {
+            upper = at >> 16;
+            uint8_t ela[2] = {(uint8_t)(upper >> 8), (uint8_t)upper};
+            hex_record(0x04, 0, ela, sizeof(ela)); // Extended linear address
+        }
+        provision_record_encode(record, mac, &info);
+        hex_record(0x00, (uint16_t)at, record, sizeof(record));
+        entries++;
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    // An erased record ends the queue; with --sectorerase it also clears a longer old queue on its page
+    if (entries < PROVISION_QUEUE_MAX) {
+        uint8_t end[PROVISION_RECORD_LEN];
+        unsigned long at = address + (unsigned long)entries * PROVISION_RECORD_LEN;
+        memset(end, 0xFF, sizeof(end));
+        if ((at >> 16) != upper) {
+            uint8_t ela[2] = {(uint8_t)(at >> 24), (uint8_t)(at >> 16)};
+            hex_record(0x04, 0, ela, sizeof(ela));
+        }
+        hex_record(0x00, (uint16_t)at, end, sizeof(end));
+    }
+    hex_record(0x01, 0, NULL, 0);
+    fprintf(stderr, "%d assignments\n", entries);
+    return 0;
+}
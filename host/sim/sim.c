@@ -0,0 +1,931 @@
+/* sim.c - Event engine, RF model, node scheduler and metrics of the simulator */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Time is in microseconds. Every node runs the real core (selected with
+ * sim_core_select) under a scheduler that mirrors main.c: the same cycle
+ * phases, jitter, drain pause, live advert updates and mode-change handling,
+ * with the cycle length and jitter taken from the configuration.
+ *
+ * RF model
+ *  - Log-distance path loss plus per-packet Gaussian fading, in dBm.
+ *  - Each advertising event sends the payload on channels 37, 38, 39 back to
+ *    back, every interval plus the 0-10 ms advDelay.
+ *  - A scanner listens on one channel per scan interval, rotating 37-38-39,
+ *    for the first `window` of each interval, and hears nothing while its own
+ *    advertising event is on air.
+ *  - A packet is received if it arrives above sensitivity and beats the sum of
+ *    all overlapping packets on its channel by the capture ratio.
+ *  - The controller duplicate filter is a FIFO of dup_len addresses, cleared
+ *    on every scan start, filled by every received packet whatever its RSSI.
+ *    Only in play when the core is built with SCAN_FILTER_DUPLICATES=1.
+ *
+ * Metrics (after warmup)
+ *  - discovery: at each device/overseer end of cycle, the share of auras whose
+ *    mean RSSI is above RSSI_THRESHOLD that were accepted at least once.
+ *  - time to correct state: every device has a shadow core instance fed, at
+ *    each of the device's decisions, one clean report from everything in range
+ *    (mean RSSI, no loss). The shadow's output is the correct state; latency
+ *    runs from a shadow change until the real output matches it.
+ *  - false toggles: real output changes that leave it different from the shadow.
+ *  - telemetry: a sniffer hearing every packet on channel 37 decodes the
+ *    nodes' telemetry adverts with the firmware's decoder.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "adv_codec.h"
+#include "mesh_core.h"
+#include "defines.h"
+#include "sim.h"
+
+#define SIM_MAX_NODES 1024
+#define US_PER_MS 1000ull
+#define ADV_DELAY_MAX_US 10000 // advDelay added to every advertising event
+#define ADV_CHANNEL_GAP_US 150 // Radio turnaround between the three channels
+#define MOVE_TICK_US 250000 // Positions and mean RSSI are refreshed this often
+#define PACKET_RING 4096 // Packets kept for collision checks, power of two
+#define COLLISION_WINDOW_US 3000 // Older packets cannot overlap one ending now
+#define FADING_TABLE 4096 // Precomputed N(0,1) samples, power of two
+#define MAX_PAUSE_US 30000000ull // Auras stop for up to 30 s at each waypoint
+#define AD_MAX 31 // Legacy advertising data: MESH/OVERSEER structure plus telemetry
+
+enum {
+    EV_BOOT,
+    EV_START,
+    EV_CYCLE,
+    EV_ADV,
+    EV_TX_END,
+    EV_MODE_CHANGE,
+    EV_MOVE,
+};
+
+// Same phases as main.c
+enum {
+    CYCLE_ADV_START,
+    CYCLE_SCAN_START,
+    CYCLE_SCAN_STOP,
+    CYCLE_END,
+};
+
+typedef struct {
+    uint64_t t;
+    uint32_t seq; // Tie-break, keeps runs deterministic
+    uint32_t arg; // Generation (start/cycle/adv events) or packet ring index
+    uint16_t node;
+    uint8_t type;
+} event_t;
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint16_t node;
+    uint8_t channel; // 0-2 for 37-39
+    uint8_t len;
+    uint8_t data[AD_MAX]; // [len][0xFF][payload]([len][0xFF][telemetry])
+} packet_t;
+
+typedef struct {
+    device_info_t info;
+    uint8_t mac[MAC_LEN];
+    float x, y; // Position, m
+    float target_x, target_y; // Aura waypoint
+    float speed; // m/s
+    uint64_t pause_until;
+    uint64_t boot_time;
+    uint32_t reports_received; // scan_cb counters for telemetry
+    uint32_t reports_rssi_rejected;
+
+    // Advertising (loaded_adv in main.c)
+    bool adv_on;
+    uint32_t adv_gen;
+    uint64_t adv_since; // When the current advertisement set went on air
+    uint32_t adv_interval_us;
+    mesh_adv_t loaded;
+    uint8_t ad[AD_MAX];
+    uint8_t ad_len;
+    uint64_t tx_start, tx_end; // Last advertising event on air
+
+    // Scanning and cycle
+    uint32_t cycle_gen;
+    int cycle_phase;
+    int scan_remaining_ms;
+    int eval_ticks;
+    uint32_t scan_duration_ms;
+    bool scanning;
+    bool filter_duplicates;
+    uint64_t scan_start;
+    uint32_t scan_interval_us;
+    uint32_t scan_window_us;
+    uint64_t cycle_start;
+    uint16_t *dup; // Duplicate filter FIFO
+    int dup_count;
+    int dup_next;
+    bool mode_change_pending;
+
+    // Metrics
+    uint8_t *heard; // Senders accepted this cycle, bitmap
+    int shadow; // Shadow slot for devices, -1 otherwise
+    bool pin;
+    bool shadow_pin;
+    bool pending; // Shadow changed and the real output has not followed yet
+    uint64_t pending_since;
+} sim_node_t;
+
+// --- Run state (one run per process at a time) ---
+static const sim_config_t *cfg;
+static sim_node_t *nodes;
+static int node_count;
+static float *mean_rssi; // [sender * node_count + receiver], dBm
+static packet_t *packets;
+static uint32_t packet_head;
+static event_t *heap;
+static uint32_t heap_len;
+static uint32_t heap_cap;
+static uint32_t event_seq;
+static uint64_t now;
+static uint64_t measure_from;
+static uint64_t rng_state;
+static float fading[FADING_TABLE];
+
+static uint64_t discovery_trials;
+static uint64_t discovery_hits;
+static uint64_t rx_attempts;
+static uint64_t rx_collisions;
+static uint64_t accepted_reports;
+static uint64_t false_toggles;
+static uint32_t ttc_missed;
+static uint64_t telemetry_reports;
+static uint16_t telemetry_peers_max;
+static uint8_t telemetry_probe_max;
+static uint32_t *ttc_ms;
+static uint32_t ttc_len;
+static uint32_t ttc_cap;
+
+static uint32_t rng_next(void) {
+    // xorshift64*, deterministic for a given seed
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static double rng_unit(void) {
+    return (rng_next() + 0.5) / 4294967296.0;
+}
+
+// --- Event queue (binary heap on time, then insertion order) ---
+
+static bool event_before(const event_t *a, const event_t *b) {
+    return a->t < b->t || (a->t == b->t && a->seq < b->seq);
+}
+
+static void schedule(uint64_t t, uint8_t type, int node, uint32_t arg) {
+    if (heap_len == heap_cap) {
+        heap_cap = heap_cap ? heap_cap * 2 : 1024;
+        heap = realloc(heap, heap_cap * sizeof(*heap));
+        if (!heap) {
+            fprintf(stderr, "mesh_sim: out of memory\n");
+            exit(1);
+        }
+    }
+    event_t ev = {t, event_seq++, arg, (uint16_t)node, type};
+    uint32_t i = heap_len++;
+    while (i > 0 && event_before(&ev, &heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = ev;
+}
+
+static event_t next_event(void) {
+    event_t top = heap[0];
+    event_t last = heap[--heap_len];
+    uint32_t i = 0;
+    while (1) {
+        uint32_t child = 2 * i + 1;
+        if (child >= heap_len) {
+            break;
+        }
+        if (child + 1 < heap_len && event_before(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!event_before(&heap[child], &last)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+// --- RF ---
+
+static void update_mean_rssi(void) {
+    for (int s = 0; s < node_count; s++) {
+        for (int r = s + 1; r < node_count; r++) {
+            float dx = nodes[s].x - nodes[r].x;
+            float dy = nodes[s].y - nodes[r].y;
+            float d2 = dx * dx + dy * dy;
+            if (d2 < 0.25f) {
+                d2 = 0.25f; // Bodies and pockets: no closer than 0.5 m
+            }
+            // 10 * ple * log10(d) = 5 * ple * log10(d^2)
+            float rssi = (float)(cfg->tx_dbm - cfg->pl1m - 5.0 * cfg->ple * log10f(d2));
+            mean_rssi[s * node_count + r] = rssi;
+            mean_rssi[r * node_count + s] = rssi;
+        }
+    }
+}
+
+static float rssi_at(int sender, int receiver) {
+    return mean_rssi[sender * node_count + receiver];
+}
+
+static int8_t to_rssi8(float rssi) {
+    float r = roundf(rssi);
+    return (int8_t)(r < -127 ? -127 : r > 20 ? 20 : r);
+}
+
+static uint32_t airtime_us(uint8_t ad_len) {
+    // Preamble 1, access address 4, header 2, AdvA 6, AD, CRC 3 bytes at 1 Mbit/s
+    return 8 * (1 + 4 + 2 + MAC_LEN + ad_len + 3);
+}
+
+static bool dup_seen(sim_node_t *n, uint16_t sender) {
+    for (int i = 0; i < n->dup_count; i++) {
+        if (n->dup[i] == sender) {
+            return true;
+        }
+    }
+    if (n->dup_count < (int)cfg->dup_len) {
+        n->dup[n->dup_count++] = sender;
+    } else if (cfg->dup_len > 0) {
+        n->dup[n->dup_next] = sender; // Oldest entry is recycled
+        n->dup_next = (n->dup_next + 1) % (int)cfg->dup_len;
+    }
+    return false;
+}
+
+static bool is_aura(const sim_node_t *n) {
+    return n->info.mode == MODE_AURA;
+}
+
+static bool counts_discovery(const sim_node_t *n) {
+    return n->info.mode == MODE_DEVICE || n->info.mode == MODE_OVERSEER;
+}
+
+static void deliver(int receiver, const packet_t *p, float rssi) {
+    sim_node_t *n = &nodes[receiver];
+    int8_t rssi8 = to_rssi8(rssi);
+    uint8_t payload_len;
+    const uint8_t *payload = mesh_core_find_payload(rssi8, p->data, p->len, &payload_len);
+    n->reports_received++;
+    if (!payload) {
+        n->reports_rssi_rejected += rssi8 < RSSI_SCAN_GATE;
+        return; // Rejected in scan_cb, the core state is not touched
+    }
+    if (now >= measure_from) {
+        accepted_reports++;
+    }
+    if (rssi8 >= RSSI_THRESHOLD) {
+        n->heard[p->node >> 3] |= 1 << (p->node & 7); // Hysteresis-band reports discover nothing
+    }
+    sim_core_select(receiver);
+    mesh_core_process_payload(nodes[p->node].mac, rssi8, payload, payload_len);
+}
+
+// A sniffer on channel 37 decoding telemetry reports like a host tool would
+static void sniff(const packet_t *p) {
+    telemetry_t t;
+    if (p->channel != 0 || now < measure_from || !adv_telemetry_find(p->data, p->len, &t)) {
+        return;
+    }
+    telemetry_reports++;
+    if (t.peers > telemetry_peers_max) {
+        telemetry_peers_max = t.peers;
+    }
+    if (t.max_probe > telemetry_probe_max) {
+        telemetry_probe_max = t.max_probe;
+    }
+}
+
+static void packet_end(uint32_t index) {
+    const packet_t *p = &packets[index & (PACKET_RING - 1)];
+    sniff(p);
+
+    // Packets overlapping this one on the same channel
+    uint16_t interferers[64];
+    int interferer_count = 0;
+    for (uint32_t k = 1; k < PACKET_RING && interferer_count < 64; k++) {
+        const packet_t *q = &packets[(index - k) & (PACKET_RING - 1)];
+        if (q->end == 0 || q->start + COLLISION_WINDOW_US < p->start) {
+            break;
+        }
+        if (q->channel == p->channel && q->start < p->end && q->end > p->start) {
+            interferers[interferer_count++] = q->node;
+        }
+    }
+    for (uint32_t j = index + 1; j != packet_head && interferer_count < 64; j++) {
+        // Events that started while this one was on air
+        const packet_t *q = &packets[j & (PACKET_RING - 1)];
+        if (q->channel == p->channel && q->start < p->end && q->end > p->start) {
+            interferers[interferer_count++] = q->node;
+        }
+    }
+
+    for (int r = 0; r < node_count; r++) {
+        sim_node_t *n = &nodes[r];
+        if (r == p->node || !n->scanning || n->scan_start > p->start) {
+            continue;
+        }
+        uint64_t offset = p->start - n->scan_start;
+        uint64_t k = offset / n->scan_interval_us;
+        uint64_t end_offset = p->end - n->scan_start - k * n->scan_interval_us;
+        if (end_offset > n->scan_window_us || k % 3 != p->channel) {
+            continue; // Outside the scan window or listening on another channel
+        }
+        if (n->adv_on && n->tx_start < p->end && n->tx_end > p->start) {
+            continue; // Own advertising event on air
+        }
+        float mean = rssi_at(p->node, r);
+        if (mean + 4 * cfg->sigma < cfg->sensitivity) {
+            continue;
+        }
+        float rssi = mean + (float)cfg->sigma * fading[rng_next() & (FADING_TABLE - 1)];
+        if (rssi < cfg->sensitivity) {
+            continue;
+        }
+        if (now >= measure_from) {
+            rx_attempts++;
+        }
+        if (interferer_count > 0) {
+            double interference_mw = 0;
+            for (int i = 0; i < interferer_count; i++) {
+                if (interferers[i] != r) {
+                    interference_mw += pow(10.0, rssi_at(interferers[i], r) / 10.0);
+                }
+            }
+            if (interference_mw > 0 && rssi - 10.0 * log10(interference_mw) < cfg->capture) {
+                if (now >= measure_from) {
+                    rx_collisions++;
+                }
+                continue;
+            }
+        }
+        if (n->filter_duplicates && dup_seen(n, p->node)) {
+            continue;
+        }
+        deliver(r, p, rssi);
+    }
+}
+
+// Start one advertising event: the payload goes out on 37, 38 and 39
+static void adv_event(int node) {
+    sim_node_t *n = &nodes[node];
+    uint32_t air = airtime_us(n->ad_len);
+    n->tx_start = now;
+    for (uint8_t ch = 0; ch < 3; ch++) {
+        uint32_t index = packet_head++;
+        packet_t *p = &packets[index & (PACKET_RING - 1)];
+        p->start = now + ch * (air + ADV_CHANNEL_GAP_US);
+        p->end = p->start + air;
+        p->node = (uint16_t)node;
+        p->channel = ch;
+        p->len = n->ad_len;
+        memcpy(p->data, n->ad, n->ad_len);
+        schedule(p->end, EV_TX_END, node, index);
+        n->tx_end = p->end;
+    }
+    schedule(now + n->adv_interval_us + rng_next() % ADV_DELAY_MAX_US, EV_ADV, node, n->adv_gen);
+}
+
+// --- Node scheduler (mirrors main.c) ---
+
+static void cycle_handler(int node);
+
+// main.c refresh_adv(): update the payload in place, restart only for new intervals
+static void refresh_adv(int node) {
+    sim_node_t *n = &nodes[node];
+    sim_core_select(node);
+    const mesh_adv_t *adv = mesh_core_adv();
+    bool params_changed = !n->adv_on ||
+        adv->interval_min != n->loaded.interval_min ||
+        adv->interval_max != n->loaded.interval_max;
+    bool data_changed = adv->len != n->loaded.len ||
+        memcmp(adv->data, n->loaded.data, adv->len) != 0 ||
+        adv->telemetry_len != n->loaded.telemetry_len ||
+        memcmp(adv->telemetry, n->loaded.telemetry, adv->telemetry_len) != 0;
+    if (!params_changed && !data_changed) {
+        return;
+    }
+    n->loaded = *adv;
+    n->ad_len = 2 + adv->len;
+    n->ad[0] = 1 + adv->len;
+    n->ad[1] = BT_DATA_MANUFACTURER_DATA;
+    memcpy(&n->ad[2], adv->data, adv->len);
+    if (adv->telemetry_len) {
+        n->ad[n->ad_len] = 1 + adv->telemetry_len;
+        n->ad[n->ad_len + 1] = BT_DATA_MANUFACTURER_DATA;
+        memcpy(&n->ad[n->ad_len + 2], adv->telemetry, adv->telemetry_len);
+        n->ad_len += 2 + adv->telemetry_len;
+    }
+    if (params_changed) {
+        n->adv_on = true;
+        n->adv_gen++;
+        n->adv_since = now;
+        n->adv_interval_us = cfg->adv_ms > 0 ? (uint32_t)(cfg->adv_ms * US_PER_MS) : adv->interval_min * 625u;
+        schedule(now + rng_next() % ADV_DELAY_MAX_US, EV_ADV, node, n->adv_gen);
+    }
+}
+
+static void load_scan(int node) {
+    sim_node_t *n = &nodes[node];
+    sim_core_select(node);
+    const mesh_scan_t *scan = mesh_core_scan();
+    n->filter_duplicates = scan->filter_duplicates;
+    n->scan_interval_us = scan->interval * 625u;
+    n->scan_window_us = scan->window * 625u;
+    n->scan_duration_ms = (uint32_t)(scan->duration_ms * cfg->cycle_ms / CYCLE_DURATION_MS);
+}
+
+static void scan_start(sim_node_t *n) {
+    n->scanning = true;
+    n->scan_start = now;
+    n->dup_count = 0; // Scan enable resets the controller duplicate filter
+    n->dup_next = 0;
+}
+
+// Shadow of a device: one clean report from everything in range, then the same decision.
+// With CONTINUOUS_SCAN the reports go with the evaluator ticks, not the end of cycle.
+static void run_shadow(int node, bool end_of_cycle) {
+    sim_node_t *n = &nodes[node];
+    sim_core_select(n->shadow);
+    for (int s = 0; s < node_count && !(CONTINUOUS_SCAN && end_of_cycle); s++) {
+        sim_node_t *sender = &nodes[s];
+        if (s == node || !sender->adv_on) {
+            continue;
+        }
+        int8_t rssi8 = to_rssi8(rssi_at(s, node));
+        if (rssi8 >= RSSI_THRESHOLD) {
+            mesh_core_scan_report(sender->mac, rssi8, sender->ad, sender->ad_len);
+        }
+    }
+    if (end_of_cycle) {
+        mesh_core_end_of_cycle();
+    } else {
+        mesh_core_evaluate();
+    }
+}
+
+// After a device decision: compare the real output with the shadow's
+static void device_decided(int node, bool pin_before, bool shadow_before) {
+    sim_node_t *n = &nodes[node];
+    if (now < measure_from) {
+        n->pending = false;
+        return;
+    }
+    if (n->shadow_pin != shadow_before) {
+        if (n->pending) {
+            ttc_missed++; // Correct state moved on before the device followed
+        }
+        n->pending = true;
+        n->pending_since = now;
+    }
+    if (n->pending && n->pin == n->shadow_pin) {
+        if (ttc_len == ttc_cap) {
+            ttc_cap = ttc_cap ? ttc_cap * 2 : 1024;
+            ttc_ms = realloc(ttc_ms, ttc_cap * sizeof(*ttc_ms));
+            if (!ttc_ms) {
+                fprintf(stderr, "mesh_sim: out of memory\n");
+                exit(1);
+            }
+        }
+        ttc_ms[ttc_len++] = (uint32_t)((now - n->pending_since) / US_PER_MS);
+        n->pending = false;
+    }
+    if (n->pin != pin_before && n->pin != n->shadow_pin) {
+        false_toggles++;
+    }
+}
+
+static void end_of_cycle(int node) {
+    sim_node_t *n = &nodes[node];
+    bool pin_before = n->pin;
+    bool shadow_before = n->shadow_pin;
+
+    sim_core_select(node);
+    mesh_core_end_of_cycle();
+
+    if (counts_discovery(n) && now >= measure_from) {
+        for (int s = 0; s < node_count; s++) {
+            sim_node_t *sender = &nodes[s];
+            if (!is_aura(sender) || !sender->adv_on || sender->adv_since > n->cycle_start ||
+                rssi_at(s, node) < RSSI_THRESHOLD) {
+                continue;
+            }
+            discovery_trials++;
+            discovery_hits += (n->heard[s >> 3] >> (s & 7)) & 1;
+        }
+    }
+    memset(n->heard, 0, (node_count + 7) / 8);
+
+    if (n->shadow >= 0) {
+        run_shadow(node, true);
+        device_decided(node, pin_before, shadow_before);
+    }
+}
+
+// main.c start_cycle(), run by EV_START when the node's generation still matches
+static void start_cycle(int node) {
+    sim_node_t *n = &nodes[node];
+#if CONTINUOUS_SCAN
+    refresh_adv(node);
+    load_scan(node);
+    scan_start(n);
+    n->cycle_start = now;
+    n->eval_ticks = 0;
+    schedule(now + PEER_EVAL_INTERVAL_MS * US_PER_MS, EV_CYCLE, node, n->cycle_gen);
+#else
+    n->cycle_phase = CYCLE_ADV_START;
+    cycle_handler(node);
+#endif
+}
+
+static void cycle_handler(int node) {
+    sim_node_t *n = &nodes[node];
+#if CONTINUOUS_SCAN
+    int cycle_ticks = (int)(cfg->cycle_ms / PEER_EVAL_INTERVAL_MS);
+    bool eoc = ++n->eval_ticks >= (cycle_ticks > 0 ? cycle_ticks : 1);
+    bool pin_before = n->pin;
+    bool shadow_before = n->shadow_pin;
+
+    sim_core_select(node);
+    mesh_core_evaluate();
+    if (n->shadow >= 0) {
+        run_shadow(node, false);
+        device_decided(node, pin_before, shadow_before);
+    }
+    if (eoc) {
+        n->eval_ticks = 0;
+        end_of_cycle(node);
+        n->cycle_start = now;
+    }
+    refresh_adv(node);
+    if (eoc && n->filter_duplicates) {
+        scan_start(n);
+    }
+    schedule(now + PEER_EVAL_INTERVAL_MS * US_PER_MS, EV_CYCLE, node, n->cycle_gen);
+#else
+    switch (n->cycle_phase) {
+    case CYCLE_ADV_START: {
+        refresh_adv(node);
+        load_scan(node);
+        uint32_t jitter_ms = cfg->jitter_ms >= 1 ? rng_next() % (uint32_t)cfg->jitter_ms : 0;
+        n->scan_remaining_ms = (int)n->scan_duration_ms - (int)jitter_ms;
+        n->cycle_start = now;
+        n->cycle_phase = CYCLE_SCAN_START;
+        schedule(now + jitter_ms * US_PER_MS, EV_CYCLE, node, n->cycle_gen);
+        break;
+    }
+    case CYCLE_SCAN_START: {
+        scan_start(n);
+        int window_ms = n->scan_remaining_ms;
+        if (SCAN_DUP_FILTER_REARM_MS > 0 && n->filter_duplicates && window_ms > SCAN_DUP_FILTER_REARM_MS) {
+            window_ms = SCAN_DUP_FILTER_REARM_MS;
+        }
+        n->scan_remaining_ms -= window_ms;
+        n->cycle_phase = CYCLE_SCAN_STOP;
+        schedule(now + (uint64_t)(window_ms > 0 ? window_ms : 0) * US_PER_MS, EV_CYCLE, node, n->cycle_gen);
+        break;
+    }
+    case CYCLE_SCAN_STOP:
+        n->scanning = false;
+        if (n->scan_remaining_ms > 0) {
+            n->cycle_phase = CYCLE_SCAN_START;
+            schedule(now, EV_CYCLE, node, n->cycle_gen);
+            break;
+        }
+        n->cycle_phase = CYCLE_END;
+        schedule(now + CYCLE_DRAIN_MS * US_PER_MS, EV_CYCLE, node, n->cycle_gen);
+        break;
+    case CYCLE_END:
+        end_of_cycle(node);
+        n->cycle_phase = CYCLE_ADV_START;
+        schedule(now, EV_CYCLE, node, n->cycle_gen);
+        break;
+    }
+#endif
+}
+
+// main.c main_loop(): stop the cycle, apply set_mode, restart right away
+static void mode_change(int node) {
+    sim_node_t *n = &nodes[node];
+    n->mode_change_pending = false;
+    n->cycle_gen++; // Cancels the pending cycle phase
+    n->adv_gen++;
+    n->scanning = false;
+    n->adv_on = false;
+
+    sim_core_select(node);
+    if (mesh_core_mode_changed()) {
+        n->info = device_info;
+        set_mode(device_info.mode);
+    }
+    schedule(now, EV_START, node, n->cycle_gen);
+}
+
+static void boot(int node) {
+    sim_node_t *n = &nodes[node];
+    n->boot_time = now;
+    sim_core_select(node);
+    device_info = n->info;
+    mesh_core_init(n->mac);
+    set_mode(n->info.mode);
+    if (n->shadow >= 0) {
+        sim_core_select(n->shadow);
+        device_info = n->info;
+        mesh_core_init(n->mac);
+        set_mode(n->info.mode);
+    }
+    // main_loop starts the first cycle right after set_mode, the LED animation does not hold it up
+    schedule(now, EV_START, node, n->cycle_gen);
+}
+
+void sim_on_output_pin(int slot, bool state) {
+    for (int i = 0; i < node_count; i++) {
+        if (slot == i) {
+            nodes[i].pin = state;
+            return;
+        }
+        if (slot == nodes[i].shadow) {
+            nodes[i].shadow_pin = state;
+            return;
+        }
+    }
+}
+
+void sim_on_telemetry(int slot, platform_telemetry_t *telemetry) {
+    memset(telemetry, 0, sizeof(*telemetry)); // The simulated radio never fails or runs late
+    for (int i = 0; i < node_count; i++) {
+        if (slot == i || slot == nodes[i].shadow) {
+            telemetry->uptime_s = (uint32_t)((now - nodes[i].boot_time) / 1000000);
+            telemetry->reports_received = nodes[i].reports_received;
+            telemetry->reports_rssi_rejected = nodes[i].reports_rssi_rejected;
+            return;
+        }
+    }
+}
+
+void sim_on_mode_change_request(int slot) {
+    if (slot >= 0 && slot < node_count && !nodes[slot].mode_change_pending) {
+        nodes[slot].mode_change_pending = true;
+        schedule(now, EV_MODE_CHANGE, slot, 0);
+    }
+}
+
+static void move_auras(void) {
+    double dt = MOVE_TICK_US / 1e6;
+    for (int i = 0; i < node_count; i++) {
+        sim_node_t *n = &nodes[i];
+        if (!is_aura(n) || n->speed <= 0 || now < n->pause_until) {
+            continue;
+        }
+        float dx = n->target_x - n->x;
+        float dy = n->target_y - n->y;
+        float dist = sqrtf(dx * dx + dy * dy);
+        float step = (float)(n->speed * dt);
+        if (dist <= step) {
+            n->x = n->target_x;
+            n->y = n->target_y;
+            n->target_x = (float)(rng_unit() * cfg->width);
+            n->target_y = (float)(rng_unit() * cfg->height);
+            n->pause_until = now + rng_next() % MAX_PAUSE_US;
+        } else {
+            n->x += dx / dist * step;
+            n->y += dy / dist * step;
+        }
+    }
+    update_mean_rssi();
+}
+
+// --- Scenario ---
+
+static void place(sim_node_t *n, float x, float y) {
+    n->x = x;
+    n->y = y;
+    n->target_x = x;
+    n->target_y = y;
+}
+
+static bool setup(void) {
+    int auras = (int)cfg->auras;
+    int hostile = (int)cfg->hostile;
+    int devices = (int)cfg->devices;
+    int overseers = (int)cfg->overseers;
+    node_count = auras + hostile + devices + overseers;
+    if (node_count < 2 || node_count > SIM_MAX_NODES || auras < 0 || hostile < 0 || devices < 0 ||
+        overseers < 0 || cfg->width <= 0 || cfg->height <= 0 || cfg->cycle_ms < 500 ||
+        cfg->dup_len < 0 || cfg->seconds <= 0) {
+        fprintf(stderr, "mesh_sim: bad scenario (1 < nodes <= %d, positive sizes, cycle_ms >= 500)\n",
+                SIM_MAX_NODES);
+        return false;
+    }
+
+    nodes = calloc(node_count, sizeof(*nodes));
+    mean_rssi = calloc((size_t)node_count * node_count, sizeof(*mean_rssi));
+    packets = calloc(PACKET_RING, sizeof(*packets));
+    if (!nodes || !mean_rssi || !packets || !sim_core_init(node_count + devices)) {
+        return false;
+    }
+
+    for (int i = 0; i < FADING_TABLE; i += 2) {
+        // Box-Muller
+        double r = sqrt(-2.0 * log(rng_unit()));
+        double a = 2.0 * M_PI * rng_unit();
+        fading[i] = (float)(r * cos(a));
+        fading[i + 1] = (float)(r * sin(a));
+    }
+
+    int shadow = node_count;
+    for (int i = 0; i < node_count; i++) {
+        sim_node_t *n = &nodes[i];
+        n->mac[0] = 0xC0 | (uint8_t)(i >> 8); // Static random address
+        n->mac[1] = (uint8_t)i;
+        for (int b = 2; b < MAC_LEN; b++) {
+            n->mac[b] = (uint8_t)rng_next();
+        }
+        n->dup = calloc(cfg->dup_len > 0 ? (size_t)cfg->dup_len : 1, sizeof(*n->dup));
+        n->heard = calloc((node_count + 7) / 8, 1);
+        if (!n->dup || !n->heard) {
+            return false;
+        }
+        n->shadow = -1;
+        place(n, (float)(rng_unit() * cfg->width), (float)(rng_unit() * cfg->height));
+
+        if (i < auras) {
+            // Walking pendant, level 0-3; Unity carries magic<<4|techno
+            uint8_t affinity = rng_next() % 3;
+            uint8_t level = rng_next() % (MAX_AURA_LEVEL + 1);
+            n->info = (device_info_t){MODE_AURA, affinity,
+                                      affinity == AFFINITY_UNITY ? (uint8_t)(level << 4 | level) : level, 0, 0, 0};
+            n->speed = (float)(cfg->walk * (0.5 + rng_unit()));
+        } else if (i < auras + hostile) {
+            n->info = (device_info_t){MODE_AURA, (uint8_t)(AFFINITY_MAGIC + rng_next() % 2),
+                                      HOSTILE_ENVIRONMENT_LEVEL, 0, 0, 0};
+        } else if (i < auras + hostile + devices) {
+            n->info = (device_info_t){MODE_DEVICE, rng_next() % 3, rng_next() % (MAX_AURA_LEVEL + 1), 0, 0, 0};
+            n->shadow = shadow++;
+        } else {
+            // Overseers spread along the hall, one zone each
+            int k = i - (auras + hostile + devices);
+            n->info = (device_info_t){MODE_OVERSEER, AFFINITY_UNITY, 0, 0, (uint8_t)k, 0};
+            place(n, (float)((k + 0.5) * cfg->width / overseers), (float)(cfg->height / 2));
+        }
+    }
+    // Devices follow the nearest overseer's zone
+    for (int i = auras + hostile; i < auras + hostile + devices && overseers > 0; i++) {
+        float best = 1e9f;
+        for (int k = 0; k < overseers; k++) {
+            const sim_node_t *o = &nodes[auras + hostile + devices + k];
+            float d = fabsf(o->x - nodes[i].x);
+            if (d < best) {
+                best = d;
+                nodes[i].info.zone = (uint8_t)k;
+            }
+        }
+    }
+    update_mean_rssi();
+
+    for (int i = 0; i < node_count; i++) {
+        schedule((uint64_t)(rng_unit() * cfg->boot_ms * US_PER_MS), EV_BOOT, i, 0);
+    }
+    schedule(MOVE_TICK_US, EV_MOVE, 0, 0);
+    return true;
+}
+
+static void teardown(void) {
+    for (int i = 0; nodes && i < node_count; i++) {
+        free(nodes[i].dup);
+        free(nodes[i].heard);
+    }
+    free(nodes);
+    free(mean_rssi);
+    free(packets);
+    free(heap);
+    free(ttc_ms);
+    nodes = NULL;
+    mean_rssi = NULL;
+    packets = NULL;
+    heap = NULL;
+    ttc_ms = NULL;
+    heap_len = heap_cap = 0;
+    ttc_len = ttc_cap = 0;
+    sim_core_free();
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+bool sim_run(const sim_config_t *config, sim_result_t *result) {
+    double wall_start = wall_seconds();
+    cfg = config;
+    rng_state = 0x9E3779B97F4A7C15ull ^ ((uint64_t)config->seed * 0xD1B54A32D192ED03ull);
+    now = 0;
+    event_seq = 0;
+    packet_head = 0;
+    measure_from = (uint64_t)(config->warmup * 1e6);
+    discovery_trials = discovery_hits = rx_attempts = rx_collisions = 0;
+    accepted_reports = false_toggles = 0;
+    ttc_missed = 0;
+    telemetry_reports = telemetry_peers_max = telemetry_probe_max = 0;
+
+    if (!setup()) {
+        teardown();
+        return false;
+    }
+
+    uint64_t end = (uint64_t)(config->seconds * 1e6);
+    while (heap_len > 0) {
+        event_t ev = next_event();
+        if (ev.t > end) {
+            break;
+        }
+        now = ev.t;
+        sim_node_t *n = &nodes[ev.node];
+        switch (ev.type) {
+        case EV_BOOT:
+            boot(ev.node);
+            break;
+        case EV_START:
+            if (ev.arg == n->cycle_gen) {
+                start_cycle(ev.node);
+            }
+            break;
+        case EV_CYCLE:
+            if (ev.arg == n->cycle_gen) {
+                cycle_handler(ev.node);
+            }
+            break;
+        case EV_ADV:
+            if (n->adv_on && ev.arg == n->adv_gen) {
+                adv_event(ev.node);
+            }
+            break;
+        case EV_TX_END:
+            packet_end(ev.arg);
+            break;
+        case EV_MODE_CHANGE:
+            mode_change(ev.node);
+            break;
+        case EV_MOVE:
+            move_auras();
+            schedule(now + MOVE_TICK_US, EV_MOVE, 0, 0);
+            break;
+        }
+    }
+
+    double measured_s = config->seconds - config->warmup;
+    double device_hours = config->devices * measured_s / 3600.0;
+    memset(result, 0, sizeof(*result));
+    result->discovery_pct = discovery_trials ? 100.0 * discovery_hits / discovery_trials : 0;
+    if (ttc_len > 0) {
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < ttc_len; i++) {
+            sum += ttc_ms[i];
+        }
+        qsort(ttc_ms, ttc_len, sizeof(*ttc_ms), compare_u32);
+        result->ttc_mean_ms = (double)sum / ttc_len;
+        result->ttc_p90_ms = ttc_ms[(ttc_len * 9) / 10];
+    }
+    result->ttc_samples = ttc_len;
+    result->ttc_missed = ttc_missed;
+    result->false_toggles_per_hour = device_hours > 0 ? false_toggles / device_hours : 0;
+    result->collision_pct = rx_attempts ? 100.0 * rx_collisions / rx_attempts : 0;
+    result->reports_per_s = measured_s > 0 ? accepted_reports / measured_s : 0;
+    result->telemetry_reports = (uint32_t)telemetry_reports;
+    result->telemetry_peers_max = telemetry_peers_max;
+    result->telemetry_probe_max = telemetry_probe_max;
+
+    teardown();
+    result->wall_s = wall_seconds() - wall_start;
+    return true;
+}
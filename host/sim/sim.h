@@ -0,0 +1,82 @@
+/* sim.h - Discrete-event simulator of a hall full of mesh nodes */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MESH_SIM_H
+#define MESH_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "types.h"
+
+// Every scenario, radio and timing knob. Each one can be given a list of
+// values on the command line and the sweep runs the cartesian product.
+// X(name, default, help)
+#define SIM_PARAMS(X) \
+    X(auras, 300, "walking aura pendants (MODE_AURA, level 0-3)") \
+    X(hostile, 2, "static hostile-environment auras (level 4)") \
+    X(devices, 40, "static devices (MODE_DEVICE)") \
+    X(overseers, 3, "static overseers (MODE_OVERSEER), one zone each") \
+    X(width, 50, "hall width, m") \
+    X(height, 30, "hall depth, m") \
+    X(walk, 1.0, "aura walking speed, m/s (0 = everyone stands still)") \
+    X(seconds, 300, "simulated time, s") \
+    X(warmup, 40, "seconds before metrics are collected") \
+    X(seed, 1, "random seed") \
+    X(tx_dbm, -20, "transmit power, dBm (CONFIG_BT_CTLR_TX_PWR_MINUS_20)") \
+    X(pl1m, 40, "path loss at 1 m, dB") \
+    X(ple, 2.5, "path loss exponent") \
+    X(sigma, 4, "per-packet fading, dB standard deviation") \
+    X(sensitivity, -93, "receiver sensitivity, dBm") \
+    X(capture, 6, "capture ratio: wanted signal over interference, dB") \
+    X(dup_len, 64, "controller duplicate filter entries, with SCAN_FILTER_DUPLICATES=1 (dup_filter.conf)") \
+    X(cycle_ms, 3500, "scan cycle length (CYCLE_DURATION_MS), scales every mode's duration") \
+    X(jitter_ms, 120, "random delay before scanning (PEER_DISCOVERY_JITTER_MS)") \
+    X(adv_ms, 0, "fixed advertising interval, ms (0 = the interval the core asks for)") \
+    X(boot_ms, 10000, "nodes power up at random within this window")
+
+typedef struct {
+#define SIM_PARAM_FIELD(name, def, help) double name;
+    SIM_PARAMS(SIM_PARAM_FIELD)
+#undef SIM_PARAM_FIELD
+} sim_config_t;
+
+typedef struct {
+    double discovery_pct; // In-range aura heard at least once per device/overseer scan cycle
+    double ttc_mean_ms; // Time from a correct-state change to the device output following it
+    double ttc_p90_ms;
+    uint32_t ttc_samples; // Correct-state changes the device followed
+    uint32_t ttc_missed; // Correct-state changes reverted before the device followed
+    double false_toggles_per_hour; // Output toggles away from the correct state, per device
+    double collision_pct; // Receptions above sensitivity lost to overlapping packets
+    double reports_per_s; // Scan reports accepted by the core (after the RSSI gate), all nodes
+    uint32_t telemetry_reports; // Telemetry adverts decoded by a sniffer on channel 37
+    uint16_t telemetry_peers_max; // Largest peer table size they reported
+    uint8_t telemetry_probe_max; // Longest probe they reported
+    double wall_s; // Host time spent
+} sim_result_t;
+
+// Run one scenario to completion, false on a setup error
+bool sim_run(const sim_config_t *config, sim_result_t *result);
+
+// --- sim_core.c: one copy of the core's state per virtual node ---
+
+// Allocate slots, each starting from the core's power-on state
+bool sim_core_init(int slots);
+void sim_core_free(void);
+// Swap the given slot's state into the core before calling it
+void sim_core_select(int slot);
+int sim_core_selected(void);
+// Size of one slot in bytes
+uint32_t sim_core_state_size(void);
+
+// Platform shim callbacks, implemented by sim.c for the selected slot
+void sim_on_output_pin(int slot, bool state);
+void sim_on_mode_change_request(int slot);
+void sim_on_telemetry(int slot, platform_telemetry_t *telemetry);
+
+#endif /* MESH_SIM_H */
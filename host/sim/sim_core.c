@@ -0,0 +1,110 @@
+/* sim_core.c - Per-node copies of the mesh core state and the platform shim */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * core_state.ld gathers every writable byte of the core between
+ * __mesh_state_start and __mesh_state_end. A virtual node is one copy of that
+ * range: selecting a node saves the live range into the previous node's copy
+ * and loads the new one. Pointers the core keeps into its own state stay
+ * valid because the live range never moves. The core objects are built
+ * without ASan so the range holds no redzones.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "sim.h"
+
+extern uint8_t __mesh_state_start[];
+extern uint8_t __mesh_state_end[];
+
+static uint8_t *states; // slots x state size
+static int slot_count;
+static int selected = -1;
+
+static uint32_t state_size(void) {
+    return (uint32_t)(__mesh_state_end - __mesh_state_start);
+}
+
+uint32_t sim_core_state_size(void) {
+    return state_size();
+}
+
+bool sim_core_init(int slots) {
+    uint32_t size = state_size();
+    states = malloc((size_t)slots * size);
+    if (!states) {
+        return false;
+    }
+    // The live range still holds the power-on values (nothing ran yet)
+    for (int i = 0; i < slots; i++) {
+        memcpy(states + (size_t)i * size, __mesh_state_start, size);
+    }
+    slot_count = slots;
+    selected = -1;
+    return true;
+}
+
+void sim_core_free(void) {
+    free(states);
+    states = NULL;
+    slot_count = 0;
+    selected = -1;
+}
+
+void sim_core_select(int slot) {
+    uint32_t size = state_size();
+    if (slot == selected) {
+        return;
+    }
+    if (selected >= 0) {
+        memcpy(states + (size_t)selected * size, __mesh_state_start, size);
+    }
+    memcpy(__mesh_state_start, states + (size_t)slot * size, size);
+    selected = slot;
+}
+
+int sim_core_selected(void) {
+    return selected;
+}
+
+// --- Platform shim, routed to the selected node ---
+
+void platform_set_output_pin(bool state) {
+    sim_on_output_pin(selected, state);
+}
+
+void platform_set_led_state(int led_idx, enum led_state state) {
+}
+
+void platform_mode_transition(void) {
+    // LED animation only, the radio keeps running
+}
+
+void platform_request_mode_change(void) {
+    sim_on_mode_change_request(selected);
+}
+
+void platform_store_device_info(const device_info_t *info) {
+}
+
+bool platform_read_provision_record(uint16_t index, uint8_t *record) {
+    return false; // The simulator has no provisioners
+}
+
+void platform_get_telemetry(platform_telemetry_t *telemetry) {
+    sim_on_telemetry(selected, telemetry);
+}
+
+uint32_t platform_cycles(void) {
+    return 0; // No CPU model: core code takes no simulated time
+}
+
+uint32_t platform_cycles_per_sec(void) {
+    return 1000000;
+}
@@ -0,0 +1,192 @@
+/* sim_main.c - Command line, parameter sweeps and CSV output of the simulator */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Every parameter of sim.h takes one value or a comma-separated list:
+ *
+ *   mesh_sim --cycle_ms 2500,3500,5000 --jitter_ms 60,120,240 --seed 1,2,3 -j 8 -o sweep.csv
+ *
+ * runs the cartesian product of all lists, one forked process per run and up
+ * to -j runs at a time (default: all online CPUs). Each child starts from the
+ * untouched parent, so runs never share core state. Rows come out in grid
+ * order whatever the completion order, and carry the compiled-in core
+ * thresholds so CSVs from differently built binaries can be concatenated.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "defines.h"
+#include "sim.h"
+
+#define MAX_VALUES 32
+
+typedef struct {
+    const char *name;
+    const char *help;
+    size_t offset;
+    double values[MAX_VALUES];
+    int count;
+} param_axis_t;
+
+static param_axis_t axes[] = {
+#define SIM_PARAM_AXIS(name, def, help) {#name, help, offsetof(sim_config_t, name), {def}, 1},
+    SIM_PARAMS(SIM_PARAM_AXIS)
+#undef SIM_PARAM_AXIS
+};
+#define AXIS_COUNT ((int)(sizeof(axes) / sizeof(axes[0])))
+
+typedef struct {
+    sim_result_t result;
+    int status; // 0 = not run, 1 = ok, -1 = failed
+} run_slot_t;
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--param v1,v2,...]... [-j jobs] [-o out.csv]\n\nparameters:\n", argv0);
+    for (int i = 0; i < AXIS_COUNT; i++) {
+        fprintf(stderr, "  --%-12s %-8g %s\n", axes[i].name, axes[i].values[0], axes[i].help);
+    }
+}
+
+static bool parse_list(param_axis_t *axis, const char *text) {
+    char *copy = strdup(text);
+    char *save = NULL;
+    axis->count = 0;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *end;
+        double v = strtod(tok, &end);
+        if (*end != '\0' || axis->count == MAX_VALUES) {
+            free(copy);
+            return false;
+        }
+        axis->values[axis->count++] = v;
+    }
+    free(copy);
+    return axis->count > 0;
+}
+
+// Grid point index -> configuration, last axis varies fastest
+static void config_at(long index, sim_config_t *config) {
+    for (int i = AXIS_COUNT - 1; i >= 0; i--) {
+        *(double *)((char *)config + axes[i].offset) = axes[i].values[index % axes[i].count];
+        index /= axes[i].count;
+    }
+}
+
+static void write_csv(FILE *out, const run_slot_t *slots, long points) {
+    for (int i = 0; i < AXIS_COUNT; i++) {
+        fprintf(out, "%s,", axes[i].name);
+    }
+    fprintf(out, "rssi_threshold,rssi_hysteresis,peer_detection,peer_miss,overseer_detection,overseer_miss,continuous_scan,"
+                 "discovery_pct,ttc_mean_ms,ttc_p90_ms,ttc_samples,ttc_missed,false_toggles_per_hour,"
+                 "collision_pct,reports_per_s,telemetry_reports,telemetry_peers_max,telemetry_probe_max,wall_s\n");
+    for (long p = 0; p < points; p++) {
+        sim_config_t config;
+        config_at(p, &config);
+        for (int i = 0; i < AXIS_COUNT; i++) {
+            fprintf(out, "%g,", *(double *)((char *)&config + axes[i].offset));
+        }
+        fprintf(out, "%d,%d,%d,%d,%d,%d,%d,", RSSI_THRESHOLD, RSSI_HYSTERESIS_DB, PEER_DETECTION_THRESHOLD, PEER_MISS_THRESHOLD,
+                OVERSEER_DETECTION_THRESHOLD, OVERSEER_MISS_THRESHOLD, CONTINUOUS_SCAN);
+        const sim_result_t *r = &slots[p].result;
+        if (slots[p].status != 1) {
+            fprintf(out, ",,,,,,,,,,,\n"); // Failed run: empty metrics
+            continue;
+        }
+        fprintf(out, "%.2f,%.0f,%.0f,%u,%u,%.2f,%.2f,%.0f,%u,%u,%u,%.1f\n", r->discovery_pct, r->ttc_mean_ms,
+                r->ttc_p90_ms, r->ttc_samples, r->ttc_missed, r->false_toggles_per_hour, r->collision_pct,
+                r->reports_per_s, r->telemetry_reports, r->telemetry_peers_max, r->telemetry_probe_max,
+                r->wall_s);
+    }
+}
+
+int main(int argc, char **argv) {
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *out_path = NULL;
+
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "-j") && a + 1 < argc) {
+            jobs = atol(argv[++a]);
+            continue;
+        }
+        if (!strcmp(argv[a], "-o") && a + 1 < argc) {
+            out_path = argv[++a];
+            continue;
+        }
+        int i = 0;
+        while (i < AXIS_COUNT && (strncmp(argv[a], "--", 2) || strcmp(argv[a] + 2, axes[i].name))) {
+            i++;
+        }
+        if (i == AXIS_COUNT || a + 1 >= argc || !parse_list(&axes[i], argv[++a])) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    }
+
+    long points = 1;
+    for (int i = 0; i < AXIS_COUNT; i++) {
+        points *= axes[i].count;
+    }
+    run_slot_t *slots = mmap(NULL, points * sizeof(*slots), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (slots == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    long next = 0;
+    long running = 0;
+    long done = 0;
+    while (done < points) {
+        while (running < jobs && next < points) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            if (pid == 0) {
+                sim_config_t config;
+                config_at(next, &config);
+                slots[next].status = sim_run(&config, &slots[next].result) ? 1 : -1;
+                _exit(0);
+            }
+            next++;
+            running++;
+        }
+        int status;
+        if (wait(&status) > 0) {
+            running--;
+            done++;
+            fprintf(stderr, "\r%ld/%ld runs", done, points);
+        }
+    }
+    fprintf(stderr, "\n");
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+    write_csv(out, slots, points);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    int failed = 0;
+    for (long p = 0; p < points; p++) {
+        failed += slots[p].status != 1;
+    }
+    return failed ? 1 : 0;
+}
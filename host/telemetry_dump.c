@@ -0,0 +1,212 @@
+/* telemetry_dump.c - Decoder for TELEMETRY adverts captured by a sniffer */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Reads captured scan reports, one per line:
+ *
+ *   <mac> <AD structures in hex>      e.g. C0:FF:EE:00:00:01 06FFCEFA111000 15FFD1A911...
+ *
+ * (spaces inside the hex are ignored, '#' starts a comment) and prints every
+ * TELEMETRY report found, with the report and RSSI-reject counts as deltas
+ * against the previous report of the same node, so the 16-bit wrap does not
+ * matter. At the end one line per node, busiest peer table first: the nodes
+ * at the top sit in the hotspots of the hall. Profile reports (answers to a
+ * TELEMETRY_REQUEST_PROFILE) are printed as median and maximum per profiler
+ * probe, as upper bounds of their log2 buckets in microseconds. Provision
+ * reports (unrequested from a provisioner) are printed as queue progress.
+ *
+ * Usage: telemetry_dump [capture_file...]   (stdin if none)
+ * Exit status is non-zero if no report was decoded.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "profiler.h"
+#include "defines.h"
+
+#define MAX_NODES 1024
+#define MAX_LINE 256
+#define AD_MAX 31
+
+typedef struct {
+    char mac[18];
+    telemetry_t last;
+    unsigned reports; // Telemetry reports decoded from this node
+} node_t;
+
+static node_t nodes[MAX_NODES];
+static int node_count;
+
+static const char *mode_names[] = {"none", "aura", "device", "token", "overseer", "provisioner"};
+
+static const char *mode_name(uint8_t mode) {
+    return mode < sizeof(mode_names) / sizeof(mode_names[0]) ? mode_names[mode] : "?";
+}
+
+static node_t *node_for(const char *mac) {
+    for (int i = 0; i < node_count; i++) {
+        if (!strcmp(nodes[i].mac, mac)) {
+            return &nodes[i];
+        }
+    }
+    if (node_count == MAX_NODES) {
+        return NULL;
+    }
+    node_t *node = &nodes[node_count++];
+    snprintf(node->mac, sizeof(node->mac), "%s", mac);
+    return node;
+}
+
+// Hex digits of s into data, whitespace skipped. Returns the byte count or -1.
+static int parse_hex(const char *s, uint8_t *data, int max) {
+    int len = 0;
+    int high = -1;
+    for (; *s && *s != '#'; s++) {
+        if (isspace((unsigned char)*s)) {
+            continue;
+        }
+        if (!isxdigit((unsigned char)*s)) {
+            return -1;
+        }
+        int nibble = isdigit((unsigned char)*s) ? *s - '0' : (tolower((unsigned char)*s) - 'a' + 10);
+        if (high < 0) {
+            high = nibble;
+        } else {
+            if (len == max) {
+                return -1;
+            }
+            data[len++] = (uint8_t)(high << 4 | nibble);
+            high = -1;
+        }
+    }
+    return high < 0 ? len : -1;
+}
+
+static void print_report(const node_t *node, const telemetry_t *t, int first) {
+    printf("%s %-8s up=%umin peers=%u est=%u probe=%u refused=%u ring_drop=%u adv_fail=%u scan_fail=%u "
+           "overruns=%u err=%d",
+           node->mac, mode_name(t->mode), t->uptime_min, t->peers, t->established, t->max_probe, t->peers_refused,
+           t->ring_dropped, t->adv_start_failures, t->scan_start_failures, t->cycle_overruns, t->last_error);
+    if (first) {
+        printf(" reports=%u rejected=%u\n", t->reports_received, t->reports_rssi_rejected);
+        return;
+    }
+    uint16_t reports = (uint16_t)(t->reports_received - node->last.reports_received);
+    uint16_t rejected = (uint16_t)(t->reports_rssi_rejected - node->last.reports_rssi_rejected);
+    printf(" reports=+%u rejected=+%u (%.0f%%)\n", reports, rejected, reports ? 100.0 * rejected / reports : 0.0);
+}
+
+// Upper bound of a profiler bucket in microseconds
+static double bucket_us(uint8_t bucket, uint16_t clock_khz) {
+    return clock_khz ? (double)(1ul << bucket) * 1000.0 / clock_khz : 0.0;
+}
+
+static void print_profile(const char *mac, const telemetry_profile_t *p) {
+    printf("%s %-8s profile clock=%ukHz\n", mac, mode_name(p->mode), p->clock_khz);
+    for (int probe = 0; probe < TELEMETRY_PROFILE_PROBES; probe++) {
+        if (!p->max_bucket[probe]) {
+            continue; // No samples (or all zero)
+        }
+        printf("    %-13s p50<%.0fus max<%.0fus\n", prof_probe_name((prof_probe_t)probe),
+               bucket_us(p->p50_bucket[probe], p->clock_khz), bucket_us(p->max_bucket[probe], p->clock_khz));
+    }
+}
+
+static void print_provision(const char *mac, const telemetry_provision_t *p) {
+    printf("%s %-8s provision confirmed=%u/%u active=%u attempts=%u deferred=%u\n", mac, mode_name(p->mode),
+           p->stats.confirmed, p->stats.queued, p->active, p->stats.attempts, p->stats.deferred);
+}
+
+// Returns the number of reports decoded, -1 on a malformed line
+static int dump(FILE *in, const char *name) {
+    char line[MAX_LINE];
+    int decoded = 0;
+    int line_no = 0;
+    while (fgets(line, sizeof(line), in)) {
+        char mac[18];
+        int used;
+        uint8_t data[AD_MAX];
+        telemetry_t t;
+        telemetry_profile_t profile;
+        telemetry_provision_t provision;
+        uint8_t payload_len;
+        line_no++;
+        const char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        int len;
+        if (sscanf(p, "%17s%n", mac, &used) != 1 || (len = parse_hex(p + used, data, sizeof(data))) < 0) {
+            fprintf(stderr, "%s:%d: malformed line\n", name, line_no);
+            return -1;
+        }
+        const uint8_t *payload = adv_telemetry_payload(data, (uint16_t)len, &payload_len);
+        if (payload && adv_telemetry_profile_decode(payload, payload_len, &profile)) {
+            print_profile(mac, &profile);
+            decoded++;
+            continue;
+        }
+        if (payload && adv_telemetry_provision_decode(payload, payload_len, &provision)) {
+            print_provision(mac, &provision);
+            decoded++;
+            continue;
+        }
+        if (!payload || !adv_telemetry_decode(payload, payload_len, &t)) {
+            continue; // MESH/OVERSEER only, a request, or someone else's advert
+        }
+        node_t *node = node_for(mac);
+        if (!node) {
+            fprintf(stderr, "%s:%d: more than %d nodes\n", name, line_no, MAX_NODES);
+            return -1;
+        }
+        print_report(node, &t, node->reports == 0);
+        node->last = t;
+        node->reports++;
+        decoded++;
+    }
+    return decoded;
+}
+
+static int by_peers(const void *a, const void *b) {
+    const node_t *x = a, *y = b;
+    return (int)y->last.peers - (int)x->last.peers;
+}
+
+int main(int argc, char **argv) {
+    int decoded = 0;
+    if (argc < 2) {
+        decoded = dump(stdin, "stdin");
+    }
+    for (int i = 1; i < argc && decoded >= 0; i++) {
+        FILE *in = fopen(argv[i], "r");
+        if (!in) {
+            perror(argv[i]);
+            return 1;
+        }
+        int n = dump(in, argv[i]);
+        fclose(in);
+        decoded = n < 0 ? -1 : decoded + n;
+    }
+    if (decoded <= 0) {
+        fprintf(stderr, decoded < 0 ? "aborted\n" : "no telemetry reports\n");
+        return 1;
+    }
+
+    qsort(nodes, (size_t)node_count, sizeof(nodes[0]), by_peers);
+    printf("\n%d reports from %d nodes, busiest first:\n", decoded, node_count);
+    for (int i = 0; i < node_count; i++) {
+        const telemetry_t *t = &nodes[i].last;
+        printf("%s %-8s peers=%u est=%u probe=%u refused=%u ring_drop=%u overruns=%u err=%d\n", nodes[i].mac,
+               mode_name(t->mode), t->peers, t->established, t->max_probe, t->peers_refused, t->ring_dropped,
+               t->cycle_overruns, t->last_error);
+    }
+    return 0;
+}
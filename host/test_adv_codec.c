@@ -0,0 +1,364 @@
+/* test_adv_codec.c - Round-trip tests and decode benchmark for adv_codec.h */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Encodes every valid (mode, affinity, level, state, threshold) combination,
+ * checks the bytes against the documented wire layout written out by hand, and
+ * decodes them back. MASTER (unicast and group), OVERSEER (legacy, V2 and summary) and TELEMETRY are
+ * round-tripped the same way. Afterwards the MESH decode is timed on a shuffled advert mix.
+ *
+ * Usage: test_adv_codec [bench_iterations]
+ * Exit status is non-zero if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "platform_host.h"
+
+#define CHECK_PRINT_LIMIT 20 // The exhaustive loops print their first failures only
+#include "test_check.h"
+
+// Levels a device of this affinity can carry in device_info_t
+static int level_count(uint8_t affinity) {
+    return affinity == AFFINITY_UNITY ? 16 : HOSTILE_ENVIRONMENT_LEVEL + 1;
+}
+
+static uint8_t level_at(uint8_t affinity, int index) {
+    if (affinity == AFFINITY_UNITY) {
+        return (uint8_t)(((index >> 2) << 4) | (index & 0x03)); // magic<<4|techno, both 0-3
+    }
+    return (uint8_t)index;
+}
+
+static void test_mesh(void) {
+    uint8_t buf[16];
+    for (uint8_t mode = MODE_NONE; mode <= MODE_PROVISIONER; mode++) {
+        for (uint8_t affinity = AFFINITY_UNITY; affinity <= AFFINITY_TECHNO; affinity++) {
+            for (int li = 0; li < level_count(affinity); li++) {
+                uint8_t level = level_at(affinity, li);
+                for (uint8_t state = 0; state < 16; state++) {
+                    for (int threshold = -128; threshold <= 127; threshold++) {
+                        device_info_t in = {mode, affinity, level, (int8_t)threshold, 0, 0};
+                        uint8_t len = adv_mesh_encode(buf, &in, state);
+
+                        // Expected wire bytes, independent of the layout tables
+                        uint8_t wire_level = affinity == AFFINITY_UNITY ?
+                            (uint8_t)(((level >> 4) << 2) | (level & 0x03)) : level;
+                        CHECK(len == MESH_ADV_LEN, "mesh len %u", len);
+                        CHECK(buf[0] == 0xCE && buf[1] == 0xFA, "mesh magic");
+                        CHECK(buf[2] == (uint8_t)((mode << 4) | affinity), "mesh byte2 %02x", buf[2]);
+                        CHECK(buf[3] == (uint8_t)((wire_level << 4) | state), "mesh byte3 %02x level %02x", buf[3], level);
+                        CHECK(buf[4] == (uint8_t)threshold, "mesh byte4 %02x", buf[4]);
+                        CHECK(adv_kind(buf) == ADV_KIND_MESH, "mesh kind");
+
+                        device_info_t out;
+                        uint8_t out_state;
+                        CHECK(adv_mesh_decode(buf, len, &out, &out_state), "mesh decode failed");
+                        CHECK(out.mode == mode && out.affinity == affinity && out.level == level &&
+                              out.dynamic_rssi_threshold == (int8_t)threshold && out_state == state,
+                              "mesh round trip mode %u affinity %u level %02x -> %02x state %u",
+                              mode, affinity, level, out.level, state);
+                    }
+                }
+            }
+        }
+    }
+    device_info_t out;
+    uint8_t out_state;
+    CHECK(!adv_mesh_decode(buf, MESH_ADV_LEN - 1, &out, &out_state), "short mesh accepted");
+}
+
+static void test_master(void) {
+    static const uint8_t target[MAC_LEN] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+    uint8_t buf[16];
+    for (uint8_t mode = MODE_NONE; mode <= MODE_PROVISIONER; mode++) {
+        for (uint8_t affinity = AFFINITY_UNITY; affinity <= AFFINITY_TECHNO; affinity++) {
+            for (int li = 0; li < level_count(affinity); li++) {
+                for (int threshold = -128; threshold <= 127; threshold += 5) {
+                    for (int tail = 0; tail <= 2; tail++) { // Nothing, zone, zone and group
+                        bool with_zone = tail >= 1;
+                        bool with_group = tail == 2;
+                        device_info_t in = {mode, affinity, level_at(affinity, li), (int8_t)threshold, 0x5A, 0x3C};
+                        uint8_t len = adv_master_encode(buf, target, &in, with_zone, with_group);
+                        CHECK(len == (with_group ? MASTER_GROUP_ADV_LEN : with_zone ? MASTER_ZONE_ADV_LEN : MASTER_ADV_LEN),
+                              "master len %u", len);
+                        CHECK(len <= ADV_RECORD_MAX_DATA, "master len %u", len);
+                        CHECK(buf[0] == 0xAB && buf[1] == 0xAC, "master magic");
+                        CHECK(memcmp(&buf[2], target, MAC_LEN) == 0, "master target");
+                        CHECK(buf[8] == mode && buf[9] == affinity && buf[10] == in.level &&
+                              buf[11] == (uint8_t)threshold, "master fields");
+                        CHECK(adv_kind(buf) == ADV_KIND_MASTER, "master kind");
+
+                        const uint8_t *out_target;
+                        device_info_t out = {0, 0, 0, 0, 0x77, 0x11};
+                        bool has_zone;
+                        CHECK(adv_master_decode(buf, len, &out_target, &out, &has_zone), "master decode failed");
+                        CHECK(out_target == &buf[2], "master target pointer");
+                        CHECK(has_zone == with_zone, "master zone flag");
+                        CHECK(out.mode == mode && out.affinity == affinity && out.level == in.level &&
+                              out.dynamic_rssi_threshold == in.dynamic_rssi_threshold &&
+                              out.zone == (with_zone ? 0x5A : 0x77) && out.group == (with_group ? 0x3C : 0x11),
+                              "master round trip");
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void test_group_master(void) {
+    uint8_t buf[16];
+    for (int group = 0; group < 256; group++) {
+        for (int with_zone = 0; with_zone <= 1; with_zone++) {
+            device_info_t in = {MODE_AURA, AFFINITY_UNITY, 0x23, -66, 0x5A, 0x3C};
+            uint8_t len = adv_group_master_encode(buf, (uint8_t)group, &in, with_zone);
+            CHECK(len == (with_zone ? GROUP_MASTER_ZONE_ADV_LEN : GROUP_MASTER_ADV_LEN), "group master len %u", len);
+            CHECK(buf[0] == 0xAB && buf[1] == 0xAD && buf[2] == group, "group master header");
+            CHECK(buf[3] == MODE_AURA && buf[4] == AFFINITY_UNITY && buf[5] == 0x23 && buf[6] == (uint8_t)-66,
+                  "group master fields");
+            CHECK(adv_kind(buf) == ADV_KIND_GROUP_MASTER, "group master kind");
+
+            uint8_t out_group;
+            device_info_t out = {0, 0, 0, 0, 0x77, 0x11};
+            bool has_zone;
+            CHECK(adv_group_master_decode(buf, len, &out_group, &out, &has_zone), "group master decode failed");
+            CHECK(out_group == group && has_zone == with_zone, "group master group/zone flag");
+            CHECK(out.mode == in.mode && out.affinity == in.affinity && out.level == in.level &&
+                  out.dynamic_rssi_threshold == in.dynamic_rssi_threshold &&
+                  out.zone == (with_zone ? 0x5A : 0x77) && out.group == 0x11, "group master round trip");
+            CHECK(!adv_group_master_decode(buf, GROUP_MASTER_ADV_LEN - 1, &out_group, &out, &has_zone),
+                  "short group master accepted");
+        }
+    }
+}
+
+static void test_overseer(void) {
+    uint8_t buf[16];
+    for (int states = 0; states < 256; states++) {
+        // Legacy: one byte per (affinity, level), drives zone 0 only
+        uint8_t len = adv_overseer_legacy_encode(buf, (uint8_t)states);
+        uint8_t out;
+        CHECK(len == OVERSEER_ADV_LEN && adv_kind(buf) == ADV_KIND_OVERSEER, "legacy len/kind");
+        CHECK(adv_overseer_pack_levels(&buf[2]) == states, "legacy pack");
+        CHECK(adv_overseer_zone_states(buf, len, 0, &out) && out == states, "legacy zone 0");
+        CHECK(!adv_overseer_zone_states(buf, len, 1, &out), "legacy matched zone 1");
+
+        for (uint8_t affinity = AFFINITY_UNITY; affinity <= AFFINITY_TECHNO; affinity++) {
+            for (uint8_t level = 0; level <= 3; level++) {
+                uint8_t magic = buf[2 + level];
+                uint8_t techno = buf[6 + level];
+                uint8_t expected = affinity == AFFINITY_MAGIC ? magic :
+                                   affinity == AFFINITY_TECHNO ? techno : (magic | techno);
+                CHECK(adv_overseer_state_for((uint8_t)states, affinity, level) == expected,
+                      "state_for states %02x affinity %u level %u", states, affinity, level);
+            }
+        }
+
+        // V2 with 1..OVERSEER_V2_MAX_ZONES zones
+        for (uint8_t zones = 1; zones <= OVERSEER_V2_MAX_ZONES; zones++) {
+            uint8_t ids[OVERSEER_V2_MAX_ZONES];
+            uint8_t vectors[OVERSEER_V2_MAX_ZONES];
+            for (uint8_t z = 0; z < zones; z++) {
+                ids[z] = (uint8_t)(z * 37 + states);
+                vectors[z] = (uint8_t)(states ^ (z * 0x55));
+            }
+            if (zones > 1 && ids[0] == ids[1]) {
+                continue; // Duplicate zone IDs: first match wins, nothing to check
+            }
+            len = adv_overseer_v2_encode(buf, ids, vectors, zones);
+            CHECK(len == OVERSEER_V2_LEN(zones) && len <= ADV_RECORD_MAX_DATA, "v2 len %u", len);
+            CHECK(adv_overseer_is_v2(buf, len), "v2 not recognised");
+            CHECK(!adv_overseer_is_v2(buf, len - 1), "truncated v2 accepted");
+            for (uint8_t z = 0; z < zones; z++) {
+                CHECK(adv_overseer_zone_states(buf, len, ids[z], &out) && out == vectors[z],
+                      "v2 zone %u of %u", z, zones);
+            }
+        }
+    }
+}
+
+static void test_overseer_summary(void) {
+    uint8_t buf[OVERSEER_SUMMARY_LEN];
+    uint8_t states;
+    uint32_t seed = 4242;
+
+    for (int i = 0; i < 1000; i++) {
+        overseer_summary_t in = { .origin = (i * 2654435761u) & 0xFFFFFF };
+        overseer_summary_t out;
+        for (int level = 0; level < OVERSEER_SUMMARY_LEVELS; level++) {
+            seed = seed * 1103515245u + 12345u;
+            in.counts[MAGIC_AURAS_IDX][level] = (uint8_t)(seed >> 16);
+            in.counts[TECHNO_AURAS_IDX][level] = (uint8_t)(seed >> 24);
+        }
+        uint8_t hops = (uint8_t)(i % 16);
+        uint8_t len = adv_overseer_summary_encode(buf, &in, hops);
+        CHECK(len == OVERSEER_SUMMARY_LEN && len <= ADV_RECORD_MAX_DATA, "summary len %u", len);
+        CHECK(adv_kind(buf) == ADV_KIND_OVERSEER, "summary kind");
+        CHECK(adv_overseer_summary_decode(buf, len, &out), "summary %d not decoded", i);
+        CHECK(out.origin == in.origin && out.hops == hops && !memcmp(out.counts, in.counts, sizeof(in.counts)),
+              "summary %d round trip", i);
+        CHECK(!adv_overseer_summary_decode(buf, len - 1, &out), "truncated summary accepted");
+        // Devices must not take a summary for states, legacy or V2
+        CHECK(!adv_overseer_is_v2(buf, len), "summary read as v2");
+        CHECK(!adv_overseer_zone_states(buf, len, 0, &states), "summary read as states");
+    }
+}
+
+static int telemetry_equal(const telemetry_t *a, const telemetry_t *b) {
+    return a->mode == b->mode && a->uptime_min == b->uptime_min && a->reports_received == b->reports_received &&
+           a->reports_rssi_rejected == b->reports_rssi_rejected && a->peers == b->peers &&
+           a->established == b->established && a->max_probe == b->max_probe &&
+           a->peers_refused == b->peers_refused && a->ring_dropped == b->ring_dropped &&
+           a->adv_start_failures == b->adv_start_failures && a->scan_start_failures == b->scan_start_failures &&
+           a->cycle_overruns == b->cycle_overruns && a->last_error == b->last_error;
+}
+
+static void test_telemetry(void) {
+    static const uint8_t own[MAC_LEN] = {1, 2, 3, 4, 5, 6};
+    static const uint8_t other[MAC_LEN] = {1, 2, 3, 4, 5, 7};
+    static const uint8_t everyone[MAC_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t buf[TELEMETRY_ADV_LEN];
+    uint32_t seed = 777;
+
+    for (int i = 0; i < 1000; i++) {
+        telemetry_t in, out;
+        seed = seed * 1103515245u + 12345u;
+        in.mode = (uint8_t)(i % (MODE_PROVISIONER + 1));
+        in.uptime_min = (uint16_t)seed;
+        in.reports_received = (uint16_t)(seed >> 16);
+        in.reports_rssi_rejected = (uint16_t)(seed >> 8);
+        in.peers = (uint16_t)(i % (MAX_PEERS + 1));
+        in.established = (uint16_t)(in.peers / 2);
+        in.max_probe = (uint8_t)(seed % PEER_MAX_PROBE_LENGTH);
+        in.peers_refused = adv_saturate8(seed >> 20);
+        in.ring_dropped = (uint8_t)(seed >> 3);
+        in.adv_start_failures = (uint8_t)(seed >> 5);
+        in.scan_start_failures = (uint8_t)(seed >> 7);
+        in.cycle_overruns = (uint8_t)(seed >> 11);
+        in.last_error = (int8_t)-(i % 8);
+
+        uint8_t len = adv_telemetry_encode(buf, &in);
+        CHECK(len == TELEMETRY_ADV_LEN && adv_kind(buf) == ADV_KIND_TELEMETRY, "telemetry len/kind");
+        CHECK(buf[2] == ((TELEMETRY_VERSION_REPORT << 4) | in.mode), "telemetry header %02x", buf[2]);
+        CHECK(buf[3] == (uint8_t)in.uptime_min && buf[4] == (uint8_t)(in.uptime_min >> 8), "uptime not LE");
+        CHECK(adv_telemetry_decode(buf, len, &out) && telemetry_equal(&in, &out), "telemetry round trip %d", i);
+        CHECK(!adv_telemetry_decode(buf, len - 1, &out), "truncated telemetry accepted");
+        CHECK(!adv_telemetry_request_for(buf, len, everyone), "report taken for a request");
+
+        // Behind a MESH payload, as the firmware sends it
+        uint8_t report[2 + MESH_ADV_LEN + 2 + TELEMETRY_ADV_LEN];
+        device_info_t info = {MODE_AURA, AFFINITY_MAGIC, 1, 0, 0, 0};
+        report[0] = 1 + MESH_ADV_LEN;
+        report[1] = BT_DATA_MANUFACTURER_DATA;
+        adv_mesh_encode(&report[2], &info, 1);
+        report[2 + MESH_ADV_LEN] = 1 + TELEMETRY_ADV_LEN;
+        report[3 + MESH_ADV_LEN] = BT_DATA_MANUFACTURER_DATA;
+        memcpy(&report[4 + MESH_ADV_LEN], buf, len);
+        CHECK(adv_telemetry_find(report, sizeof(report), &out) && telemetry_equal(&in, &out), "find %d", i);
+        CHECK(!adv_telemetry_find(report, sizeof(report) - 1, &out), "truncated AD accepted");
+        const uint8_t *payload;
+        uint8_t payload_len;
+        CHECK(adv_parse(report, sizeof(report), &payload, &payload_len) == ADV_KIND_MESH, "telemetry hid MESH");
+    }
+
+    uint8_t len = adv_telemetry_request_encode(buf, own, TELEMETRY_REQUEST_COUNTERS);
+    CHECK(len == TELEMETRY_REQUEST_LEN && adv_kind(buf) == ADV_KIND_TELEMETRY, "request len/kind");
+    CHECK(adv_telemetry_request_for(buf, len, own), "request not for own");
+    CHECK(!adv_telemetry_request_for(buf, len, other), "request for other");
+    CHECK(!adv_telemetry_request_for(buf, len - 1, own), "truncated request accepted");
+    telemetry_t out_counters;
+    CHECK(!adv_telemetry_decode(buf, len, &out_counters), "request decoded as report");
+    len = adv_telemetry_request_encode(buf, everyone, TELEMETRY_REQUEST_PROFILE);
+    CHECK(adv_telemetry_request_for(buf, len, other), "broadcast request not for other");
+    CHECK(adv_telemetry_request_what(buf) == TELEMETRY_REQUEST_PROFILE, "request what");
+
+    // Profile reports: median within 7 buckets of the max is exact, further down it saturates
+    for (int i = 0; i < 1000; i++) {
+        telemetry_profile_t in, out;
+        seed = seed * 1103515245u + 12345u;
+        in.mode = (uint8_t)(i % (MODE_PROVISIONER + 1));
+        in.clock_khz = (uint16_t)(seed >> 8);
+        for (int p = 0; p < TELEMETRY_PROFILE_PROBES; p++) {
+            seed = seed * 1103515245u + 12345u;
+            in.max_bucket[p] = (uint8_t)((seed >> 16) % PROF_BUCKETS);
+            in.p50_bucket[p] = (uint8_t)((seed >> 8) % (in.max_bucket[p] + 1));
+        }
+        len = adv_telemetry_profile_encode(buf, &in);
+        CHECK(len == TELEMETRY_PROFILE_LEN && len <= TELEMETRY_ADV_LEN && adv_kind(buf) == ADV_KIND_TELEMETRY,
+              "profile len/kind");
+        CHECK(buf[2] == ((TELEMETRY_VERSION_PROFILE << 4) | in.mode), "profile header %02x", buf[2]);
+        CHECK(adv_telemetry_profile_decode(buf, len, &out) && out.mode == in.mode && out.clock_khz == in.clock_khz,
+              "profile round trip %d", i);
+        for (int p = 0; p < TELEMETRY_PROFILE_PROBES; p++) {
+            uint8_t expected = in.max_bucket[p] - in.p50_bucket[p] > 7 ? in.max_bucket[p] - 7 : in.p50_bucket[p];
+            CHECK(out.max_bucket[p] == in.max_bucket[p] && out.p50_bucket[p] == expected, "profile probe %d", p);
+        }
+        CHECK(!adv_telemetry_profile_decode(buf, len - 1, &out), "truncated profile accepted");
+        CHECK(!adv_telemetry_decode(buf, len, &out_counters), "profile decoded as counters");
+    }
+
+    // Provision reports
+    telemetry_provision_t in_provision = {MODE_PROVISIONER, {256, 0x1234, 0xFEDC, 7}, PROVISION_SLOTS};
+    telemetry_provision_t out_provision;
+    telemetry_profile_t out_profile;
+    len = adv_telemetry_provision_encode(buf, &in_provision);
+    CHECK(len == TELEMETRY_PROVISION_LEN && len <= TELEMETRY_ADV_LEN && adv_kind(buf) == ADV_KIND_TELEMETRY,
+          "provision len/kind");
+    CHECK(buf[2] == ((TELEMETRY_VERSION_PROVISION << 4) | MODE_PROVISIONER), "provision header %02x", buf[2]);
+    CHECK(adv_telemetry_provision_decode(buf, len, &out_provision) && out_provision.mode == in_provision.mode &&
+          out_provision.active == in_provision.active && out_provision.stats.queued == in_provision.stats.queued &&
+          out_provision.stats.confirmed == in_provision.stats.confirmed &&
+          out_provision.stats.attempts == in_provision.stats.attempts &&
+          out_provision.stats.deferred == in_provision.stats.deferred, "provision round trip");
+    CHECK(!adv_telemetry_provision_decode(buf, len - 1, &out_provision), "truncated provision accepted");
+    CHECK(!adv_telemetry_decode(buf, len, &out_counters), "provision decoded as counters");
+    CHECK(!adv_telemetry_profile_decode(buf, len, &out_profile), "provision decoded as profile");
+}
+
+// Time MESH decodes over a shuffled mix of valid adverts
+static void bench_decode(long iterations) {
+    enum { SAMPLES = 4096 };
+    static uint8_t adverts[SAMPLES][MESH_ADV_LEN];
+    uint32_t seed = 12345;
+    for (int i = 0; i < SAMPLES; i++) {
+        seed = seed * 1103515245u + 12345u;
+        device_info_t info = {MODE_AURA, (uint8_t)((seed >> 8) % 3), 0, (int8_t)(seed >> 16), 0, 0};
+        info.level = level_at(info.affinity, (int)((seed >> 24) % level_count(info.affinity)));
+        adv_mesh_encode(adverts[i], &info, (seed >> 4) & 1);
+    }
+
+    volatile uint32_t sink = 0;
+    uint64_t start = host_time_ns();
+    for (long n = 0; n < iterations; n++) {
+        const uint8_t *advert = adverts[n & (SAMPLES - 1)];
+        device_info_t info;
+        uint8_t state;
+        if (adv_kind(advert) == ADV_KIND_MESH && adv_mesh_decode(advert, MESH_ADV_LEN, &info, &state)) {
+            sink += info.level + info.affinity + state;
+        }
+    }
+    uint64_t elapsed = host_time_ns() - start;
+    printf("mesh decode: %ld adverts, %.2f ns/advert\n", iterations,
+           iterations ? (double)elapsed / (double)iterations : 0.0);
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 10000000;
+
+    test_mesh();
+    test_master();
+    test_group_master();
+    test_overseer();
+    test_overseer_summary();
+    test_telemetry();
+    int status = check_report();
+    bench_decode(iterations);
+    return status;
+}
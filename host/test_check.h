@@ -0,0 +1,56 @@
+/* test_check.h - Check counters and helpers shared by the host unit tests */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Each test program includes this once. CHECK counts every check and prints
+ * the failing ones (the first CHECK_PRINT_LIMIT, defined before the include
+ * to cap long loops); main ends with return check_report().
+ */
+
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <stdio.h>
+
+#include "adv_codec.h"
+#include "mesh_core.h"
+
+#ifndef CHECK_PRINT_LIMIT
+#define CHECK_PRINT_LIMIT (~0ul)
+#endif
+
+static unsigned long checks;
+static unsigned long failures;
+
+#define CHECK(cond, ...) do { \
+    checks++; \
+    if (!(cond)) { \
+        if (failures++ < CHECK_PRINT_LIMIT) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } \
+} while (0)
+
+// Print the totals, returns the exit status
+static inline int check_report(void) {
+    printf("%lu checks, %lu failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
+
+// MAC of test aura id, unique in the first byte
+#define TEST_AURA_MAC(id) {(uint8_t)(id), 0x00, 0x00, 0xEE, 0xFF, 0xC0}
+
+// One MESH advert of an aura with its output on, through the scan path
+static inline void aura_advertise(const uint8_t *mac, uint8_t affinity, uint8_t level, int8_t rssi) {
+    device_info_t aura = {.mode = MODE_AURA, .affinity = affinity, .level = level};
+    uint8_t buf[16];
+    mesh_core_process_payload(mac, rssi, buf, adv_mesh_encode(buf, &aura, 1));
+}
+
+#endif /* TEST_CHECK_H */
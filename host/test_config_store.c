@@ -0,0 +1,199 @@
+/* test_config_store.c - Checks for the deferred config store on RAM flash pages */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Runs config_store.c against RAM pages that behave like NOR flash (writes
+ * can only clear bits, erase sets a page to 0xFF). Checks that empty pages
+ * load nothing, that requests are coalesced and identical values never reach
+ * flash, that a reload finds the newest record, that a full page continues on
+ * the other one (also across generation wrap-around), that a reset between
+ * that erase and the first write on the new page keeps the previous record,
+ * and that a torn last record falls back to the one before.
+ *
+ * Exit status is non-zero if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config_store.h"
+#include "test_check.h"
+
+#define PAGE_SIZE 1024
+#define SLOTS (PAGE_SIZE / CONFIG_RECORD_LEN)
+
+static uint8_t page[CONFIG_STORE_PAGES * PAGE_SIZE];
+static unsigned reads;
+static unsigned writes;
+static bool power_cut; // Writes are lost and fail (reset after an erase)
+
+static int ram_read(uint16_t offset, void *data, uint16_t len) {
+    reads++;
+    memcpy(data, &page[offset], len);
+    return 0;
+}
+
+static int ram_write(uint16_t offset, const void *data, uint16_t len) {
+    const uint8_t *bytes = data;
+    if (power_cut) {
+        return -5;
+    }
+    writes++;
+    for (uint16_t i = 0; i < len; i++) {
+        page[offset + i] &= bytes[i];
+    }
+    return 0;
+}
+
+static int ram_erase(uint8_t index) {
+    memset(&page[index * PAGE_SIZE], 0xFF, PAGE_SIZE);
+    return 0;
+}
+
+static void erase_all(void) {
+    memset(page, 0xFF, sizeof(page));
+}
+
+static const config_flash_t flash = {ram_read, ram_write, ram_erase, PAGE_SIZE};
+
+static device_info_t info(uint8_t mode, uint8_t level) {
+    device_info_t i = {mode, AFFINITY_MAGIC, level, -60, 2, 7};
+    return i;
+}
+
+// Simulates a reboot: forget the RAM state and load from the page
+static int reboot(device_info_t *loaded) {
+    config_store_reset();
+    reads = 0;
+    return config_store_load(&flash, loaded);
+}
+
+static void test_empty_and_reload(void) {
+    device_info_t loaded = info(0, 0);
+    erase_all();
+    CHECK(!reboot(&loaded), "empty page loaded a record");
+    CHECK(loaded.mode == 0, "empty page touched info");
+
+    device_info_t a = info(MODE_AURA, 2);
+    config_store_request(&a);
+    CHECK(config_store_pending(), "request not pending");
+    CHECK(config_store_commit(&flash) == 0 && !config_store_pending(), "commit");
+    CHECK(reboot(&loaded) && !memcmp(&loaded, &a, sizeof(a)), "reload");
+    CHECK(reads < 24, "load took %u reads", reads);
+}
+
+static void test_coalesce_and_skip(void) {
+    device_info_t loaded;
+    device_info_t a = info(MODE_DEVICE, 1);
+    device_info_t b = info(MODE_DEVICE, 3);
+    erase_all();
+    reboot(&loaded);
+
+    writes = 0;
+    for (int i = 0; i < 20; i++) { // A lingering master advert
+        config_store_request(i & 1 ? &b : &a);
+    }
+    config_store_commit(&flash);
+    CHECK(writes == 1, "%u writes for 20 requests", writes);
+    CHECK(config_store_stats()->coalesced == 19, "coalesced %u", config_store_stats()->coalesced);
+    CHECK(reboot(&loaded) && loaded.level == 3, "newest request lost");
+
+    writes = 0;
+    config_store_request(&b);
+    CHECK(!config_store_pending() && config_store_stats()->skipped == 1, "identical value pending");
+    config_store_request(&a);
+    config_store_request(&b); // Changed back before the commit
+    CHECK(!config_store_pending(), "reverted value pending");
+    CHECK(config_store_commit(&flash) == 0 && writes == 0, "identical value written");
+}
+
+static void test_page_full(void) {
+    device_info_t loaded;
+    erase_all();
+    reboot(&loaded);
+
+    for (int i = 0; i < SLOTS + 3; i++) {
+        device_info_t v = info(MODE_AURA, (uint8_t)(i & 3));
+        v.zone = (uint8_t)i;
+        config_store_request(&v);
+        CHECK(config_store_commit(&flash) == 0, "commit %d", i);
+    }
+    CHECK(config_store_stats()->erases == 1, "%u erases", config_store_stats()->erases);
+    CHECK(reboot(&loaded) && loaded.zone == (uint8_t)(SLOTS + 2), "after switch zone %u", loaded.zone);
+    CHECK(page[PAGE_SIZE + 3 * CONFIG_RECORD_LEN] == 0xFF, "writing did not continue at the other page start");
+    CHECK(page[(SLOTS - 1) * CONFIG_RECORD_LEN] != 0xFF, "full page erased before it was needed");
+
+    // Generations wrap around mod 4, every reload must still pick the newer page
+    for (int i = SLOTS + 3; i < 6 * SLOTS; i++) {
+        device_info_t v = info(MODE_DEVICE, 1);
+        v.zone = (uint8_t)i;
+        config_store_request(&v);
+        config_store_commit(&flash);
+        if (i % SLOTS < 2) {
+            CHECK(reboot(&loaded) && loaded.zone == (uint8_t)i, "record %d lost, zone %u", i, loaded.zone);
+        }
+    }
+}
+
+static void test_reset_during_switch(void) {
+    device_info_t loaded;
+    erase_all();
+    reboot(&loaded);
+    for (int i = 0; i < SLOTS; i++) {
+        device_info_t v = info(MODE_AURA, 1);
+        v.zone = (uint8_t)i;
+        config_store_request(&v);
+        config_store_commit(&flash);
+    }
+    memset(&page[PAGE_SIZE], 0x00, PAGE_SIZE); // Stale records from long ago on the other page
+
+    device_info_t next = info(MODE_DEVICE, 3);
+    config_store_request(&next);
+    power_cut = true; // The other page gets erased, then the power goes
+    CHECK(config_store_commit(&flash) != 0, "commit without power");
+    power_cut = false;
+    CHECK(reboot(&loaded) && loaded.mode == MODE_AURA && loaded.zone == (uint8_t)(SLOTS - 1),
+          "previous record lost, mode %u zone %u", loaded.mode, loaded.zone);
+
+    config_store_request(&next);
+    CHECK(config_store_commit(&flash) == 0, "commit after the reset");
+    CHECK(reboot(&loaded) && loaded.mode == MODE_DEVICE, "record after the reset");
+}
+
+static void test_torn_record(void) {
+    device_info_t loaded;
+    device_info_t a = info(MODE_OVERSEER, 0);
+    device_info_t b = info(MODE_AURA, 1);
+    erase_all();
+    reboot(&loaded);
+    config_store_request(&a);
+    config_store_commit(&flash);
+    config_store_request(&b);
+    config_store_commit(&flash);
+
+    page[CONFIG_RECORD_LEN + 4] = 0x00; // Reset in the middle of the second write
+    CHECK(reboot(&loaded) && loaded.mode == MODE_OVERSEER, "torn record not skipped");
+
+    config_store_request(&b); // Lands behind the torn slot
+    CHECK(config_store_commit(&flash) == 0, "commit after torn record");
+    CHECK(reboot(&loaded) && loaded.mode == MODE_AURA, "record after torn slot");
+
+    uint8_t record[CONFIG_RECORD_LEN];
+    config_record_encode(record, &b);
+    CHECK(config_record_decode(record, &loaded), "decode");
+    record[2] ^= 1;
+    CHECK(!config_record_decode(record, &loaded), "crc missed a flipped bit");
+}
+
+int main(void) {
+    test_empty_and_reload();
+    test_coalesce_and_skip();
+    test_page_full();
+    test_reset_during_switch();
+    test_torn_record();
+    return check_report();
+}
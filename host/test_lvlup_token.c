@@ -0,0 +1,167 @@
+/* test_lvlup_token.c - Checks for the level-up token hand-over */
+
+/*
+ * Runs the core as a Magic level 2 token among auras held against it. Checks
+ * that the strongest qualifying aura of a burst gets the master advert at the
+ * fast interval (not the first one heard, not a stronger one that does not
+ * qualify), that the token only discharges once the target advertises its
+ * new level, that a target that never does leaves the token charged after
+ * LVLUP_TOKEN_CONFIRM_CYCLES, and that a level 1 token stays charged.
+ *
+ * Exit status is non-zero if any check fails.
+ */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "mesh_core.h"
+#include "platform_host.h"
+#include "test_check.h"
+
+typedef struct {
+    uint8_t mac[MAC_LEN];
+    device_info_t info;
+    int8_t rssi;
+} aura_t;
+
+enum { NEAR, NEAREST, WRONG_LEVEL, HOSTILE, AURAS };
+
+static aura_t auras[AURAS] = {
+    {TEST_AURA_MAC(0x01), {MODE_AURA, AFFINITY_MAGIC, 1, 0, 0, 0}, -44},
+    {TEST_AURA_MAC(0x02), {MODE_AURA, AFFINITY_MAGIC, 1, 0, 0, 0}, -35},
+    {TEST_AURA_MAC(0x03), {MODE_AURA, AFFINITY_MAGIC, 2, 0, 0, 0}, -30},
+    {TEST_AURA_MAC(0x04), {MODE_AURA, AFFINITY_TECHNO, 1, 0, 0, 0}, -30},
+};
+
+static void auras_advertise(void) {
+    for (int i = 0; i < AURAS; i++) {
+        aura_advertise(auras[i].mac, auras[i].info.affinity, auras[i].info.level, auras[i].rssi);
+    }
+}
+
+static void start_token(uint8_t level) {
+    static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+    device_info = (device_info_t){MODE_LVLUP_TOKEN, AFFINITY_MAGIC, level, 0, 0, 0};
+    mesh_core_init(own_mac);
+    set_mode(MODE_LVLUP_TOKEN);
+}
+
+// The aura the token's master advert addresses, NULL if it sends none
+static aura_t *master_target(device_info_t *info) {
+    const mesh_adv_t *adv = mesh_core_adv();
+    const uint8_t *mac;
+    bool has_zone;
+    if (adv_kind(adv->data) != ADV_KIND_MASTER || !adv_master_decode(adv->data, adv->len, &mac, info, &has_zone)) {
+        return NULL;
+    }
+    for (int i = 0; i < AURAS; i++) {
+        if (!memcmp(mac, auras[i].mac, MAC_LEN)) {
+            return &auras[i];
+        }
+    }
+    return NULL;
+}
+
+// MESH state of the token, 0xFF for a master advert; *announced = target MAC after the state
+static uint8_t token_state(const aura_t **announced) {
+    const mesh_adv_t *adv = mesh_core_adv();
+    device_info_t info;
+    uint8_t state;
+    *announced = NULL;
+    if (!adv_mesh_decode(adv->data, adv->len, &info, &state)) {
+        return 0xFF;
+    }
+    for (int i = 0; adv->len == MESH_ADV_LEN + MAC_LEN && i < AURAS; i++) {
+        if (!memcmp(&adv->data[MESH_ADV_LEN], auras[i].mac, MAC_LEN)) {
+            *announced = &auras[i];
+        }
+    }
+    return state;
+}
+
+static void test_hand_over(void) {
+    const aura_t *announced;
+    device_info_t grant;
+    start_token(2);
+
+    auras_advertise();
+    mesh_core_end_of_cycle();
+    aura_t *target = master_target(&grant);
+    CHECK(target == &auras[NEAREST], "master for aura %d", target ? (int)(target - auras) : -1);
+    CHECK(grant.mode == MODE_AURA && grant.affinity == AFFINITY_MAGIC && grant.level == 2, "grant");
+    CHECK(mesh_core_adv()->len == MASTER_ADV_LEN, "master with zone");
+    CHECK(mesh_core_adv()->interval_max <= ADV_FAST_INT_MAX_2, "master not at the fast interval");
+
+    // The target misses the first bursts, the token keeps asking
+    for (int cycle = 0; cycle < 3; cycle++) {
+        auras_advertise();
+        mesh_core_end_of_cycle();
+        CHECK(master_target(&grant) == &auras[NEAREST], "master stopped before confirmation");
+    }
+    auras[NEAREST].info = grant;
+    auras_advertise();
+    mesh_core_end_of_cycle();
+    CHECK(token_state(&announced) == 0 && announced == &auras[NEAREST], "not discharged after confirmation");
+    CHECK(host_platform.leds[GREEN_LED_PIN] == LED_OFF, "discharged LED");
+
+    // Used up: another qualifying aura gets nothing
+    for (int cycle = 0; cycle < 3; cycle++) {
+        auras_advertise();
+        mesh_core_end_of_cycle();
+        CHECK(!master_target(&grant), "discharged token sent a master advert");
+    }
+    auras[NEAREST].info.level = 1;
+}
+
+static void test_unconfirmed(void) {
+    const aura_t *announced;
+    device_info_t grant;
+    start_token(2);
+    auras_advertise();
+    mesh_core_end_of_cycle();
+    CHECK(master_target(&grant) == &auras[NEAREST], "no master advert");
+
+    int cycles = 0;
+    while (master_target(&grant) && cycles < 3 * LVLUP_TOKEN_CONFIRM_CYCLES) {
+        auras_advertise(); // Still level 1
+        mesh_core_end_of_cycle();
+        cycles++;
+    }
+    CHECK(cycles == LVLUP_TOKEN_CONFIRM_CYCLES, "gave up after %d cycles", cycles);
+    CHECK(token_state(&announced) == 1 && !announced, "charge lost without confirmation");
+    CHECK(host_platform.leds[RED_LED_PIN] == LED_BLINK_ONCE, "failure not shown");
+
+    // Next burst: a new attempt
+    auras_advertise();
+    mesh_core_end_of_cycle();
+    CHECK(master_target(&grant) == &auras[NEAREST], "no retry");
+}
+
+static void test_level_1(void) {
+    const aura_t *announced;
+    device_info_t grant;
+    aura_t *fresh = &auras[NEAR];
+    fresh->info.level = 0;
+    start_token(1);
+    auras_advertise();
+    mesh_core_end_of_cycle();
+    CHECK(master_target(&grant) == fresh && grant.level == 1, "level 1 grant");
+    fresh->info = grant;
+    auras_advertise();
+    mesh_core_end_of_cycle();
+    CHECK(token_state(&announced) == 1 && announced == fresh, "level 1 token discharged");
+    fresh->info.level = 1;
+}
+
+int main(void) {
+    test_hand_over();
+    test_unconfirmed();
+    test_level_1();
+    return check_report();
+}
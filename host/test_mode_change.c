@@ -0,0 +1,90 @@
+/* test_mode_change.c - Checks for mode changes that keep the peer table */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Establishes a few auras around a device, then reconfigures it with master
+ * adverts the way main_loop does (mesh_core_mode_changed, set_mode). Checks
+ * that a device that changes affinity shows the right output as soon as
+ * set_mode returns, with a single write of the output pin, that an overseer
+ * made from the device broadcasts states from the same auras at once, and
+ * that a mode without the peer table in between starts the count over.
+ *
+ * Exit status is non-zero if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "mesh_core.h"
+#include "platform_host.h"
+#include "test_check.h"
+
+static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+
+// Three Magic and one Techno aura, all level 1
+static void auras_advertise(void) {
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t mac[MAC_LEN] = TEST_AURA_MAC(i);
+        aura_advertise(mac, i < 3 ? AFFINITY_MAGIC : AFFINITY_TECHNO, 1, -50);
+    }
+}
+
+// A master advert for this device, applied as main_loop applies it
+static void reconfigure(uint8_t mode, uint8_t affinity) {
+    static const uint8_t master_mac[MAC_LEN] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+    device_info_t info = {mode, affinity, 1, 0, 0, 0};
+    uint8_t buf[16];
+    mesh_core_process_payload(master_mac, -50, buf, adv_master_encode(buf, own_mac, &info, false, false));
+    CHECK(mesh_core_mode_changed(), "master advert ignored");
+    set_mode(device_info.mode);
+}
+
+static bool overseer_magic_level1_on(void) {
+    const mesh_adv_t *adv = mesh_core_adv();
+    uint8_t states;
+    return adv_overseer_zone_states(adv->data, adv->len, 0, &states) &&
+           adv_overseer_state_for(states, AFFINITY_MAGIC, 1);
+}
+
+static void test_mode_changes(void) {
+    device_info = (device_info_t){MODE_DEVICE, AFFINITY_MAGIC, 1, 0, 0, 0};
+    mesh_core_init(own_mac);
+    set_mode(MODE_DEVICE);
+    for (int cycle = 0; cycle < 6; cycle++) {
+        auras_advertise();
+        mesh_core_end_of_cycle();
+    }
+    CHECK(host_platform.output_pin, "magic device off among magic auras");
+
+    // Now outnumbered, without another cycle
+    uint32_t writes = host_platform.output_pin_writes;
+    reconfigure(MODE_DEVICE, AFFINITY_TECHNO);
+    CHECK(!host_platform.output_pin && host_platform.leds[RED_LED_PIN] == LED_ON, "techno device not suppressed");
+    CHECK(host_platform.output_pin_writes == writes + 1, "%u output pin writes in set_mode",
+          host_platform.output_pin_writes - writes);
+    auras_advertise();
+    mesh_core_end_of_cycle();
+    CHECK(!host_platform.output_pin && host_platform.output_pin_writes == writes + 1, "output toggled after set_mode");
+
+    reconfigure(MODE_OVERSEER, AFFINITY_UNITY);
+    CHECK(overseer_magic_level1_on(), "overseer lost the auras");
+
+    reconfigure(MODE_AURA, AFFINITY_MAGIC);
+    reconfigure(MODE_DEVICE, AFFINITY_MAGIC);
+    CHECK(!host_platform.output_pin, "peer table survived aura mode");
+    for (int cycle = 0; cycle < 6; cycle++) {
+        auras_advertise();
+        mesh_core_end_of_cycle();
+    }
+    CHECK(host_platform.output_pin, "auras not counted again");
+}
+
+int main(void) {
+    test_mode_changes();
+    return check_report();
+}
@@ -0,0 +1,203 @@
+/* test_overseer.c - Checks for devices following an overseer and for pooled overseer counts */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Runs the core as a Magic level 1 device outnumbered by Techno auras, with
+ * an overseer that commands Magic level 1 ON. Checks that the device keeps
+ * its own decision until it has heard the overseer for
+ * OVERSEER_DETECTION_THRESHOLD cycles, then follows it, and goes back to its
+ * own decision once the overseer is missed for OVERSEER_MISS_THRESHOLD cycles,
+ * and that a stronger overseer taking over the zone is followed at once.
+ *
+ * Then runs the core as an overseer next to others that send summaries.
+ * Checks that an aura weak at two overseers adds up to one aura, that a
+ * neighbour using our summary origin is counted and makes us change origin,
+ * and that a summary no longer heard stops counting after
+ * OVERSEER_SUMMARY_MAX_AGE cycles. Last, checks that an overseer holding no
+ * summary decides from whole auras.
+ *
+ * Exit status is non-zero if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "mesh_core.h"
+#include "platform_host.h"
+#include "test_check.h"
+
+static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+static const uint8_t overseer_mac[MAC_LEN] = {0x0A, 0x00, 0x00, 0xEE, 0xFF, 0xC0};
+
+// Two Techno level 1 auras
+static void auras_advertise(void) {
+    for (uint8_t i = 0; i < 2; i++) {
+        uint8_t mac[MAC_LEN] = TEST_AURA_MAC(0x20 + i);
+        aura_advertise(mac, AFFINITY_TECHNO, 1, -50);
+    }
+}
+
+// Zone 0 states: Magic levels 0-1 ON, Techno OFF
+static void overseer_advertise(void) {
+    const uint8_t levels[8] = {1, 1, 0, 0, 0, 0, 0, 0};
+    uint8_t zone = 0, states = adv_overseer_pack_levels(levels);
+    uint8_t buf[16];
+    mesh_core_process_payload(overseer_mac, -60, buf, adv_overseer_v2_encode(buf, &zone, &states, 1));
+}
+
+static void test_follow_overseer(void) {
+    device_info = (device_info_t){MODE_DEVICE, AFFINITY_MAGIC, 1, 0, 0, 0};
+    mesh_core_init(own_mac);
+    set_mode(MODE_DEVICE);
+    for (int cycle = 0; cycle < 6; cycle++) {
+        auras_advertise();
+        mesh_core_end_of_cycle();
+    }
+    CHECK(!host_platform.output_pin, "outnumbered device on");
+
+    for (int cycle = 1; cycle <= OVERSEER_DETECTION_THRESHOLD; cycle++) {
+        auras_advertise();
+        overseer_advertise();
+        mesh_core_end_of_cycle();
+        CHECK(host_platform.output_pin == (cycle == OVERSEER_DETECTION_THRESHOLD),
+              "output %d after hearing the overseer for %d cycles", host_platform.output_pin, cycle);
+    }
+
+    for (int cycle = 1; cycle <= OVERSEER_MISS_THRESHOLD; cycle++) {
+        auras_advertise();
+        mesh_core_end_of_cycle();
+        CHECK(host_platform.output_pin == (cycle < OVERSEER_MISS_THRESHOLD),
+              "output %d after missing the overseer for %d cycles", host_platform.output_pin, cycle);
+    }
+}
+
+// tests/bsim overseer_handover without the radio: overseer A commands Magic level 1 ON in zone 1,
+// then goes silent while a stronger B commands it OFF
+static void test_overseer_handover(void) {
+    static const uint8_t a_mac[MAC_LEN] = {0x0C, 0x00, 0x00, 0xEE, 0xFF, 0xC0};
+    static const uint8_t b_mac[MAC_LEN] = {0x0D, 0x00, 0x00, 0xEE, 0xFF, 0xC0};
+    const uint8_t levels[8] = {0, 1, 0, 0, 0, 0, 0, 0};
+    uint8_t zone = 1, on = adv_overseer_pack_levels(levels), off = 0;
+    uint8_t buf[16];
+    device_info = (device_info_t){MODE_DEVICE, AFFINITY_MAGIC, 1, 0, 1, 0};
+    mesh_core_init(own_mac);
+    set_mode(MODE_DEVICE);
+    mesh_core_end_of_cycle();
+    CHECK(!host_platform.output_pin, "device on without auras");
+
+    for (int cycle = 1; cycle <= OVERSEER_DETECTION_THRESHOLD; cycle++) {
+        mesh_core_process_payload(a_mac, -52, buf, adv_overseer_v2_encode(buf, &zone, &on, 1));
+        mesh_core_end_of_cycle();
+    }
+    CHECK(host_platform.output_pin, "overseer A not adopted after %d cycles", OVERSEER_DETECTION_THRESHOLD);
+
+    mesh_core_process_payload(b_mac, -46, buf, adv_overseer_v2_encode(buf, &zone, &off, 1));
+    mesh_core_end_of_cycle();
+    CHECK(!host_platform.output_pin, "stronger overseer B not followed in its first cycle");
+}
+
+// --- Overseer summaries ---
+
+static const uint8_t neighbour_mac[MAC_LEN] = {0x0B, 0x00, 0x00, 0xEE, 0xFF, 0xC0};
+static overseer_summary_t neighbour; // Sent every cycle while neighbour.age is set
+
+// Two Magic level 1 auras: one at the edge of our range (1 half), one up close (2 halves)
+static void overseer_cycle(void) {
+    static const uint8_t edge_mac[MAC_LEN] = TEST_AURA_MAC(0x30);
+    static const uint8_t near_mac[MAC_LEN] = TEST_AURA_MAC(0x31);
+    uint8_t buf[16];
+    aura_advertise(edge_mac, AFFINITY_MAGIC, 1, -66);
+    aura_advertise(near_mac, AFFINITY_MAGIC, 1, -50);
+    if (neighbour.age) {
+        mesh_core_process_payload(neighbour_mac, -65, buf, adv_overseer_summary_encode(buf, &neighbour, 0));
+    }
+    mesh_core_end_of_cycle();
+}
+
+// Zone 0 states of the first states advert after a decision made cycles from now
+static uint8_t overseer_states_after(int cycles) {
+    const mesh_adv_t *adv = mesh_core_adv();
+    uint8_t states = 0;
+    for (int cycle = 0; cycle < cycles || !adv_overseer_zone_states(adv->data, adv->len, 0, &states); cycle++) {
+        overseer_cycle();
+    }
+    return states;
+}
+
+// Our own summary from the next summary adverts
+static bool own_summary(overseer_summary_t *own) {
+    const mesh_adv_t *adv = mesh_core_adv();
+    for (int cycle = 0; cycle < 4 * OVERSEER_SUMMARY_INTERVAL; cycle++) {
+        overseer_cycle();
+        if (adv_overseer_summary_decode(adv->data, adv->len, own) && own->hops == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_pooled_counts(void) {
+    overseer_summary_t own;
+    device_info = (device_info_t){MODE_OVERSEER, AFFINITY_UNITY, 0, 0, 0, 0};
+    mesh_core_init(own_mac);
+    set_mode(MODE_OVERSEER);
+
+    // The neighbour hears our edge aura weakly too, and two Techno auras of its own up close:
+    // 1 + 2 + 1 halves of Magic against 4 of Techno
+    neighbour = (overseer_summary_t){.origin = 0xB0B0B0, .age = 1};
+    neighbour.counts[MAGIC_AURAS_IDX][0] = 1;
+    neighbour.counts[TECHNO_AURAS_IDX][0] = 4;
+    uint8_t states = overseer_states_after(OVERSEER_BROADCAST_COUNTDOWN);
+    CHECK(adv_overseer_state_for(states, AFFINITY_MAGIC, 1) && adv_overseer_state_for(states, AFFINITY_TECHNO, 1),
+          "shared aura counted twice: states %02X", states);
+    CHECK(own_summary(&own) && own.counts[MAGIC_AURAS_IDX][0] == 3 && own.counts[TECHNO_AURAS_IDX][0] == 0,
+          "own summary: magic %u techno %u", own.counts[MAGIC_AURAS_IDX][0], own.counts[TECHNO_AURAS_IDX][0]);
+
+    // Another overseer with the same low MAC bytes
+    uint32_t origin = own.origin;
+    CHECK(origin == (uint32_t)(own_mac[0] | (own_mac[1] << 8) | (own_mac[2] << 16)), "origin %06X", origin);
+    neighbour = (overseer_summary_t){.origin = origin, .age = 1};
+    neighbour.counts[TECHNO_AURAS_IDX][2] = 4;
+    states = overseer_states_after(OVERSEER_BROADCAST_COUNTDOWN);
+    CHECK(adv_overseer_state_for(states, AFFINITY_TECHNO, 3) && !adv_overseer_state_for(states, AFFINITY_MAGIC, 1),
+          "colliding neighbour dropped: states %02X", states);
+    CHECK(own_summary(&own) && own.origin != origin && own.origin <= 0xFFFFFF, "origin kept after a collision");
+
+    // The neighbour goes quiet
+    neighbour.age = 0;
+    states = overseer_states_after(OVERSEER_SUMMARY_MAX_AGE + OVERSEER_BROADCAST_COUNTDOWN);
+    CHECK(adv_overseer_state_for(states, AFFINITY_MAGIC, 1) && !adv_overseer_state_for(states, AFFINITY_TECHNO, 1),
+          "stale summary still counted: states %02X", states);
+}
+
+// Alone, an overseer counts whole auras: a weak Magic aura ties with a Techno one up close
+static void test_standalone_counts(void) {
+    static const uint8_t weak_mac[MAC_LEN] = TEST_AURA_MAC(0x40);
+    static const uint8_t close_mac[MAC_LEN] = TEST_AURA_MAC(0x41);
+    const mesh_adv_t *adv = mesh_core_adv();
+    uint8_t states = 0;
+    device_info = (device_info_t){MODE_OVERSEER, AFFINITY_UNITY, 0, 0, 0, 0};
+    mesh_core_init(own_mac);
+    set_mode(MODE_OVERSEER);
+    for (int cycle = 0; cycle < OVERSEER_BROADCAST_COUNTDOWN || !adv_overseer_zone_states(adv->data, adv->len, 0, &states);
+         cycle++) {
+        aura_advertise(weak_mac, AFFINITY_MAGIC, 1, -66);
+        aura_advertise(close_mac, AFFINITY_TECHNO, 1, -50);
+        mesh_core_end_of_cycle();
+    }
+    CHECK(adv_overseer_state_for(states, AFFINITY_MAGIC, 1) && adv_overseer_state_for(states, AFFINITY_TECHNO, 1),
+          "standalone overseer weighted its auras: states %02X", states);
+}
+
+int main(void) {
+    test_follow_overseer();
+    test_overseer_handover();
+    test_pooled_counts();
+    test_standalone_counts();
+    return check_report();
+}
@@ -0,0 +1,111 @@
+/* test_profiler.c - Checks for the cycle profiler and its telemetry report */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Built with CYCLE_PROFILER=1 and its own copy of the core. Checks the log2
+ * bucket boundaries, bucket saturation and the percentiles, then asks the
+ * core for a profile over the telemetry path: a TELEMETRY request with
+ * TELEMETRY_REQUEST_PROFILE must put a profile report on air at the next end
+ * of cycle, carrying the set_mode, age_peers and end-of-cycle samples, and a
+ * counters request must still get the counters.
+ *
+ * Exit status is non-zero if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "mesh_core.h"
+#include "platform_host.h"
+#include "profiler.h"
+#include "test_check.h"
+
+static void test_buckets(void) {
+    static const struct {
+        uint32_t cycles;
+        uint8_t bucket;
+    } cases[] = {
+        {0, 0}, {1, 1}, {2, 2}, {3, 2}, {4, 3}, {1000, 10}, {1023, 10}, {1024, 11},
+        {0x7FFFFFFFu, 31}, {0x80000000u, 31}, {0xFFFFFFFFu, 31}, // Top bucket also takes 2^31 and up
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        prof_reset();
+        prof_record(PROF_SCAN_CB, cases[i].cycles);
+        const prof_histogram_t *h = prof_histogram(PROF_SCAN_CB);
+        CHECK(h->buckets[cases[i].bucket] == 1 && h->count == 1 && h->max == cases[i].cycles,
+              "%u cycles not in bucket %u", cases[i].cycles, cases[i].bucket);
+    }
+
+    // 90 short samples, 10 long: median in the short bucket, p95 and max in the long one
+    prof_reset();
+    for (int i = 0; i < 100; i++) {
+        prof_record(PROF_AGE_PEERS, i < 90 ? 100 : 100000);
+    }
+    CHECK(prof_percentile_bucket(PROF_AGE_PEERS, 50) == 7, "p50 bucket");
+    CHECK(prof_percentile_bucket(PROF_AGE_PEERS, 90) == 7, "p90 bucket");
+    CHECK(prof_percentile_bucket(PROF_AGE_PEERS, 95) == 17, "p95 bucket");
+    CHECK(prof_percentile_bucket(PROF_AGE_PEERS, 100) == 17, "max bucket");
+    CHECK(prof_percentile_bucket(PROF_SET_MODE, 50) == 0, "empty probe");
+
+    // Bucket counts saturate, the total keeps counting
+    prof_reset();
+    for (uint32_t i = 0; i < UINT16_MAX + 10u; i++) {
+        prof_record(PROF_SCAN_CB, 5);
+    }
+    CHECK(prof_histogram(PROF_SCAN_CB)->buckets[3] == UINT16_MAX, "bucket did not saturate");
+    CHECK(prof_histogram(PROF_SCAN_CB)->count == UINT16_MAX + 10u, "count");
+}
+
+static void request(const uint8_t *mac, uint8_t what) {
+    static const uint8_t everyone[MAC_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t buf[TELEMETRY_REQUEST_LEN];
+    uint8_t len = adv_telemetry_request_encode(buf, everyone, what);
+    mesh_core_process_payload(mac, -50, buf, len);
+}
+
+static void test_telemetry_path(void) {
+    static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+    static const uint8_t sniffer[MAC_LEN] = {0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+    telemetry_profile_t profile = {0};
+    telemetry_t counters;
+
+    prof_reset();
+    device_info.mode = MODE_DEVICE;
+    device_info.affinity = AFFINITY_MAGIC;
+    mesh_core_init(own_mac);
+    set_mode(MODE_DEVICE);
+    mesh_core_end_of_cycle();
+    CHECK(mesh_core_adv()->telemetry_len == 0, "telemetry without request");
+
+    request(sniffer, TELEMETRY_REQUEST_PROFILE);
+    mesh_core_end_of_cycle();
+    const mesh_adv_t *adv = mesh_core_adv();
+    CHECK(adv->telemetry_len == TELEMETRY_PROFILE_LEN, "no profile report");
+    CHECK(adv_telemetry_profile_decode(adv->telemetry, adv->telemetry_len, &profile), "profile decode");
+    CHECK(profile.mode == MODE_DEVICE && profile.clock_khz == UINT16_MAX, "profile header"); // 1 GHz saturates
+    for (int probe = PROF_END_OF_CYCLE; probe <= PROF_SET_MODE; probe++) {
+        uint8_t expected = prof_percentile_bucket((prof_probe_t)probe, 100);
+        CHECK(prof_histogram((prof_probe_t)probe)->count > 0, "%s has no samples", prof_probe_name(probe));
+        CHECK(profile.max_bucket[probe] == expected, "%s max bucket %u, expected %u", prof_probe_name(probe),
+              profile.max_bucket[probe], expected);
+    }
+
+    mesh_core_end_of_cycle();
+    CHECK(mesh_core_adv()->telemetry_len == 0, "profile stayed on air");
+
+    request(sniffer, TELEMETRY_REQUEST_COUNTERS);
+    mesh_core_end_of_cycle();
+    adv = mesh_core_adv();
+    CHECK(adv_telemetry_decode(adv->telemetry, adv->telemetry_len, &counters), "counters after a profile");
+}
+
+int main(void) {
+    test_buckets();
+    test_telemetry_path();
+    return check_report();
+}
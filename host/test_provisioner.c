@@ -0,0 +1,199 @@
+/* test_provisioner.c - Checks for MODE_PROVISIONER against simulated targets */
+
+/*
+ * Runs the core as a provisioner over a queue in "flash" (host_platform) and
+ * plays the targets: a target answers the master advert addressed to it by
+ * advertising its new configuration one cycle later. Checks that a target
+ * that already has its configuration is confirmed without a master advert,
+ * that only the configuration itself confirms an entry (not the old one, not
+ * another target), that overseer targets are confirmed by their OVERSEER
+ * advert, that a silent target is retried with a growing wait and deferred
+ * after PROVISION_MAX_ATTEMPTS, and that the provision telemetry report
+ * carries the progress.
+ *
+ * Exit status is non-zero if any check fails.
+ */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "adv_codec.h"
+#include "config_store.h"
+#include "mesh_core.h"
+#include "platform_host.h"
+#include "test_check.h"
+
+#define TARGETS 6
+#define SILENT 4 // Never answers
+#define CONFIGURED 0 // Already has its configuration
+#define OVERSEER 5
+
+typedef struct {
+    uint8_t mac[MAC_LEN];
+    device_info_t want; // Queue entry
+    device_info_t has; // What it advertises
+    int masters; // Master adverts addressed to it
+    int last_master; // Cycle of the last one
+    int wait_before_last; // Cycles between the last two
+} target_t;
+
+static target_t targets[TARGETS];
+static uint8_t queue[(TARGETS + 1) * PROVISION_RECORD_LEN];
+
+static void make_queue(void) {
+    for (int i = 0; i < TARGETS; i++) {
+        target_t *t = &targets[i];
+        uint8_t mac[MAC_LEN] = {(uint8_t)(0x10 + i), 0x00, 0x00, 0xEE, 0xFF, 0xC0};
+        memcpy(t->mac, mac, MAC_LEN);
+        t->want = (device_info_t){MODE_AURA, AFFINITY_MAGIC, (uint8_t)(i % 4), 0, 1, 5};
+        t->has = (device_info_t){MODE_NONE, AFFINITY_UNITY, 0, 0, 0, 0};
+        provision_record_encode(&queue[i * PROVISION_RECORD_LEN], t->mac, &t->want);
+    }
+    targets[OVERSEER].want.mode = MODE_OVERSEER;
+    provision_record_encode(&queue[OVERSEER * PROVISION_RECORD_LEN], targets[OVERSEER].mac, &targets[OVERSEER].want);
+    targets[CONFIGURED].has = targets[CONFIGURED].want;
+    memset(&queue[TARGETS * PROVISION_RECORD_LEN], 0xFF, PROVISION_RECORD_LEN); // End of the queue
+    host_platform.provision_records = queue;
+    host_platform.provision_record_count = TARGETS + 1;
+}
+
+// Every target advertises what it has, as heard during one cycle
+static void targets_advertise(void) {
+    uint8_t buf[16];
+    for (int i = 0; i < TARGETS; i++) {
+        uint8_t len;
+        if (i == SILENT) {
+            continue;
+        }
+        if (targets[i].has.mode == MODE_OVERSEER) {
+            uint8_t zone = targets[i].has.zone, states = 0;
+            len = adv_overseer_v2_encode(buf, &zone, &states, 1);
+        } else {
+            len = adv_mesh_encode(buf, &targets[i].has, 1);
+        }
+        mesh_core_process_payload(targets[i].mac, -60, buf, len);
+    }
+}
+
+static void request_progress(void) {
+    static const uint8_t everyone[MAC_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t buf[16];
+    uint8_t len = adv_telemetry_request_encode(buf, everyone, TELEMETRY_REQUEST_PROVISION);
+    mesh_core_process_payload(everyone, -50, buf, len);
+}
+
+static void test_provisioning(void) {
+    static const uint8_t own_mac[MAC_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+    uint8_t wrong_mac[MAC_LEN] = {0x99, 0x00, 0x00, 0xEE, 0xFF, 0xC0};
+    uint8_t buf[16];
+
+    make_queue();
+    device_info.mode = MODE_PROVISIONER;
+    mesh_core_init(own_mac);
+    set_mode(MODE_PROVISIONER);
+
+    // A stranger advertising the wanted configuration confirms nothing
+    mesh_core_process_payload(wrong_mac, -60, buf, adv_mesh_encode(buf, &targets[1].want, 1));
+
+    int cycle;
+    telemetry_provision_t progress = {0};
+    for (cycle = 0; cycle < 400; cycle++) {
+        targets_advertise();
+        if (cycle == 5) {
+            request_progress();
+        }
+        mesh_core_end_of_cycle();
+
+        const mesh_adv_t *adv = mesh_core_adv();
+        const uint8_t *target_mac;
+        device_info_t info = {0};
+        bool has_zone;
+        if (cycle == 5) {
+            CHECK(adv_telemetry_provision_decode(adv->telemetry, adv->telemetry_len, &progress), "no progress report");
+            CHECK(progress.mode == MODE_PROVISIONER && progress.stats.queued == TARGETS, "progress header");
+            CHECK(progress.active > 0 && progress.stats.attempts > 0, "progress %u active %u attempts",
+                  progress.active, progress.stats.attempts);
+        }
+        if (adv_kind(adv->data) != ADV_KIND_MASTER) {
+            device_info_t own;
+            uint8_t state;
+            CHECK(adv_mesh_decode(adv->data, adv->len, &own, &state) && own.mode == MODE_PROVISIONER, "idle advert");
+            if (state == 1) {
+                break; // Queue done (not while the silent target is in it)
+            }
+            continue;
+        }
+        CHECK(adv->len == MASTER_GROUP_ADV_LEN, "master without zone and group");
+        if (!adv_master_decode(adv->data, adv->len, &target_mac, &info, &has_zone)) {
+            CHECK(false, "master decode");
+            continue;
+        }
+        for (int i = 0; i < TARGETS; i++) {
+            target_t *t = &targets[i];
+            if (memcmp(target_mac, t->mac, MAC_LEN)) {
+                continue;
+            }
+            CHECK(!memcmp(&info, &t->want, sizeof(info)), "target %d got the wrong configuration", i);
+            if (t->masters) {
+                t->wait_before_last = cycle - t->last_master;
+            }
+            t->last_master = cycle;
+            t->masters++;
+            if (i == 1 && t->masters == 1) {
+                continue; // Misses its first master advert
+            }
+            t->has = info;
+        }
+    }
+
+    CHECK(targets[CONFIGURED].masters == 0, "configured target got %d master adverts", targets[CONFIGURED].masters);
+    // One master advert per cycle: the retry can queue behind the other slots
+    CHECK(targets[1].masters == 2 && targets[1].wait_before_last >= PROVISION_RETRY_CYCLES &&
+              targets[1].wait_before_last < PROVISION_RETRY_CYCLES + PROVISION_SLOTS,
+          "missed master: %d adverts, retry after %d cycles", targets[1].masters, targets[1].wait_before_last);
+    for (int i = 1; i < TARGETS; i++) {
+        if (i != SILENT) {
+            CHECK(!memcmp(&targets[i].has, &targets[i].want, sizeof(device_info_t)), "target %d not configured", i);
+            CHECK(targets[i].masters <= 2, "target %d got %d master adverts", i, targets[i].masters);
+        }
+    }
+    CHECK(targets[OVERSEER].masters == 1, "overseer confirmed %d", targets[OVERSEER].masters);
+    // The silent target: PROVISION_MAX_ATTEMPTS per pass, the wait capped at PROVISION_MAX_BACKOFF
+    CHECK(targets[SILENT].masters >= 2 * PROVISION_MAX_ATTEMPTS, "silent target got %d master adverts",
+          targets[SILENT].masters);
+    CHECK(targets[SILENT].wait_before_last <= PROVISION_MAX_BACKOFF + PROVISION_SLOTS, "silent target waits %d cycles",
+          targets[SILENT].wait_before_last);
+
+    request_progress();
+    mesh_core_end_of_cycle();
+    CHECK(adv_telemetry_provision_decode(mesh_core_adv()->telemetry, mesh_core_adv()->telemetry_len, &progress),
+          "no final progress report");
+    CHECK(progress.stats.confirmed == TARGETS - 1, "confirmed %u", progress.stats.confirmed);
+    CHECK(progress.stats.deferred >= 2, "deferred %u", progress.stats.deferred);
+    CHECK(progress.active == 1, "active %u", progress.active);
+}
+
+static void test_empty_queue(void) {
+    uint8_t erased[PROVISION_RECORD_LEN];
+    uint8_t state;
+    device_info_t own;
+    memset(erased, 0xFF, sizeof(erased));
+    host_platform.provision_records = erased;
+    host_platform.provision_record_count = 1;
+    set_mode(MODE_PROVISIONER);
+    mesh_core_end_of_cycle();
+    CHECK(adv_mesh_decode(mesh_core_adv()->data, mesh_core_adv()->len, &own, &state) && state == 1,
+          "empty queue not done");
+    CHECK(host_platform.leds[GREEN_LED_PIN] == LED_ON, "empty queue LED");
+}
+
+int main(void) {
+    test_provisioning();
+    test_empty_queue();
+    return check_report();
+}
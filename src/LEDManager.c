@@ -1,4 +1,5 @@
 #include "LEDManager.h"
+#include "defines.h"
 #include <zephyr/kernel.h>
 #include <string.h>
 #include <stdlib.h>
@@ -8,6 +9,18 @@ static struct led_entry *leds = NULL;
 static int led_count = 0;
 static uint8_t led_brightness = 50; // Default 50% brightness
 
+// Overlay (play_led_overlay): the LEDs in overlay_mask show overlay_state for
+// overlay_ticks more ticks, states set meanwhile only show once it ends
+static uint8_t overlay_mask;
+static enum led_state overlay_state;
+static uint16_t overlay_ticks;
+static uint16_t overlay_phase;
+
+// Blinking is driven by its own delayable work item, independent of the
+// scan cycle; it only runs while at least one LED blinks.
+static void led_tick_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(led_tick_work, led_tick_handler);
+
 // Helper function to set PWM brightness
 static void set_pwm_for_led(const struct pwm_dt_spec *pwm, bool on, uint8_t brightness) {
     if (!pwm || !pwm->dev) {
@@ -20,6 +33,58 @@ static void set_pwm_for_led(const struct pwm_dt_spec *pwm, bool on, uint8_t brig
     pwm_set_dt(pwm, period, pulse);
 }
 
+static bool is_blinking(enum led_state state) {
+    return state == LED_BLINK_FAST || state == LED_BLINK_ONCE;
+}
+
+// Drive one LED according to its state (or the overlay) and the ticks elapsed since it was set
+static void apply_led(int led_idx) {
+    struct led_entry *led = &leds[led_idx];
+    bool overlaid = overlay_ticks && (overlay_mask & BIT(led_idx));
+    enum led_state state = overlaid ? overlay_state : led->state;
+    uint16_t phase = overlaid ? overlay_phase : led->phase;
+    bool on;
+    switch (state) {
+    case LED_ON:
+        on = true;
+        break;
+    case LED_BLINK_FAST:
+        on = (phase & 1) == 0; // Toggle every tick
+        break;
+    case LED_BLINK_ONCE:
+        on = (phase % (BLINK_ONCE_PERIOD_MS / BLINK_INTERVAL_MS)) == 0; // One tick per period
+        break;
+    case LED_OFF:
+    default:
+        on = false;
+        break;
+    }
+    set_pwm_for_led(led->pwm, on, on ? led_brightness : 0);
+}
+
+static void led_tick_handler(struct k_work *work)
+{
+    bool overlay = overlay_ticks > 0;
+    bool blinking = false;
+    if (overlay) {
+        overlay_ticks--;
+        overlay_phase++;
+        blinking = overlay_ticks > 0;
+    }
+    for (int i = 0; i < led_count; i++) {
+        if (is_blinking(leds[i].state)) {
+            leds[i].phase++;
+            blinking = true;
+        } else if (!overlay) {
+            continue; // Steady, already shown
+        }
+        apply_led(i); // Also shows the own state of every LED once the overlay ends
+    }
+    if (blinking) {
+        k_work_schedule(&led_tick_work, K_MSEC(BLINK_INTERVAL_MS));
+    }
+}
+
 int init_led_manager(struct led_entry *led_array, int count)
 {
     leds = led_array;
@@ -27,6 +92,7 @@ int init_led_manager(struct led_entry *led_array, int count)
     led_count = count;
     for (int i = 0; i < count; ++i) {
         leds[i].state = LED_OFF;
+        leds[i].phase = 0;
         
         if (!leds[i].pwm || !leds[i].pwm->dev) {
             return -2; // PWM is required
@@ -43,7 +109,29 @@ int init_led_manager(struct led_entry *led_array, int count)
 int set_led_state(int led_idx, enum led_state state)
 {
     if (led_idx < 0 || led_idx >= led_count) return -1;
+    if (leds[led_idx].state == state) {
+        return 0; // Keep the blink phase running
+    }
     leds[led_idx].state = state;
+    leds[led_idx].phase = 0;
+    apply_led(led_idx); // ON/OFF take effect now, blinks start with ON (after an overlay)
+    if (is_blinking(state)) {
+        // No-op if the tick is already scheduled
+        k_work_schedule(&led_tick_work, K_MSEC(BLINK_INTERVAL_MS));
+    }
+    return 0;
+}
+
+int play_led_overlay(uint8_t mask, enum led_state state, uint32_t duration_ms)
+{
+    overlay_mask = mask;
+    overlay_state = state;
+    overlay_phase = 0;
+    overlay_ticks = (uint16_t)(duration_ms / BLINK_INTERVAL_MS);
+    for (int i = 0; i < led_count; i++) {
+        apply_led(i);
+    }
+    k_work_schedule(&led_tick_work, K_MSEC(BLINK_INTERVAL_MS));
     return 0;
 }
 
@@ -66,37 +154,3 @@ int set_led_brightness(int led_idx, uint8_t brightness_percent)
     
     return 0;
 }
-
-// Operate LEDs for a total interval, toggling blinking LEDs at the given blink interval
-void operate_leds(int total_interval_ms, int blink_interval_ms)
-{
-    int elapsed = 0;
-    bool blink_state = false;
-    // Synchronize state to new_state once at the start
-    for (int i = 0; i < led_count; i++) {
-        // set ONs and OFFs immediately
-        if (leds[i].state == LED_ON) {
-            set_pwm_for_led(leds[i].pwm, true, led_brightness);
-        } else if (leds[i].state == LED_OFF) {
-            set_pwm_for_led(leds[i].pwm, false, 0);
-        }
-    }
-
-    while (elapsed < total_interval_ms) {
-        blink_state = !blink_state;
-        for (int i = 0; i < led_count; i++) {
-            if (leds[i].state == LED_BLINK_FAST) {
-                set_pwm_for_led(leds[i].pwm, blink_state, led_brightness);
-            }
-            if (leds[i].state == LED_BLINK_ONCE) {
-                if (elapsed == 0) {
-                    set_pwm_for_led(leds[i].pwm, true, led_brightness);
-                } else {
-                    set_pwm_for_led(leds[i].pwm, false, 0);
-                }
-            }
-        }
-        k_sleep(K_MSEC(blink_interval_ms));
-        elapsed += blink_interval_ms;
-    }
-}
@@ -5,18 +5,13 @@
 extern "C" {
 #endif
 #include <zephyr/drivers/pwm.h>
-
-enum led_state {
-    LED_OFF,
-    LED_ON,
-    LED_BLINK_FAST,
-    LED_BLINK_ONCE
-};
+#include "types.h"
 
 // Internal LED state struct
 struct led_entry {
     enum led_state state;
     const struct pwm_dt_spec *pwm;
+    uint16_t phase; // Blink ticks since the state was set (managed internally)
 };
 
 
@@ -24,10 +19,12 @@ struct led_entry {
 int init_led_manager(struct led_entry *led_array, int count);
 // Set state by index
 int set_led_state(int led_idx, enum led_state state);
+// Show state on the LEDs in mask (BIT(led_idx)) for duration_ms over their own states,
+// which keep changing underneath and show when it ends. Does not block.
+int play_led_overlay(uint8_t mask, enum led_state state, uint32_t duration_ms);
 // Set brightness (0-100%) - only works if PWM configured
 int set_led_brightness(int led_idx, uint8_t brightness_percent);
-
-void operate_leds(int total_interval_ms, int blink_interval_ms);
+// Blinking runs from a BLINK_INTERVAL_MS work item, nothing needs to be pumped
 
 #ifdef __cplusplus
 }
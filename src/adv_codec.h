@@ -0,0 +1,710 @@
+/* adv_codec.h - Encode/decode of the MESH, MASTER, OVERSEER and TELEMETRY advertisements */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ADV_CODEC_H
+#define ADV_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "types.h"
+#include "defines.h"
+
+// Every layout is described once, as a table of bit fields. The tables are
+// static const and only ever indexed with constants, so the compiler folds each
+// adv_get/adv_put into a single load/shift/mask on target.
+//
+// MESH:     [0xCE][0xFA][mode:4|affinity:4][level:4|state:4][dynamic_rssi_threshold:8]
+// MASTER:   [0xAB][0xAC][target_mac:6][mode][affinity][level][dynamic_rssi_threshold]([zone]([group]))
+//           group [0xAB][0xAD][group][mode][affinity][level][dynamic_rssi_threshold]([zone])
+// OVERSEER: legacy [0xDE][0xAD][state:8 bytes, one per (affinity, level)]
+//           V2     [0xDE][0xAD][0xA0|zones:4] + [zone][states] per zone
+//           summary [0xDE][0xAD][0xB0|hops:4][origin:24] + [count] per (affinity, level 1-4)
+// TELEMETRY: request [0xD1][0xA9][0x0:4|what:4][target_mac:6]
+//            report  [0xD1][0xA9][0x1:4|mode:4] + counters, see telemetry_layout
+//            profile [0xD1][0xA9][0x2:4|mode:4][clock_khz:16] + [max:5|max-p50:3] per profiler probe
+//            provision [0xD1][0xA9][0x3:4|mode:4][queued:16][confirmed:16][attempts:16][deferred:16][active:8]
+//
+// Unity levels are magic<<4|techno in device_info_t; in the MESH level nibble
+// they are squeezed to magic<<2|techno (both parts are 0-3).
+
+typedef struct {
+    uint8_t offset; // Byte offset in the manufacturer data
+    uint8_t shift; // Bit position of the field's LSB
+    uint8_t mask; // Field mask after shifting
+} adv_field_t;
+
+enum {
+    MESH_FIELD_MODE,
+    MESH_FIELD_AFFINITY,
+    MESH_FIELD_LEVEL,
+    MESH_FIELD_STATE,
+    MESH_FIELD_THRESHOLD,
+};
+
+static const adv_field_t mesh_layout[] = {
+    [MESH_FIELD_MODE] = {2, 4, 0x0F},
+    [MESH_FIELD_AFFINITY] = {2, 0, 0x0F},
+    [MESH_FIELD_LEVEL] = {3, 4, 0x0F},
+    [MESH_FIELD_STATE] = {3, 0, 0x0F},
+    [MESH_FIELD_THRESHOLD] = {4, 0, 0xFF},
+};
+
+enum {
+    MASTER_FIELD_MODE,
+    MASTER_FIELD_AFFINITY,
+    MASTER_FIELD_LEVEL,
+    MASTER_FIELD_THRESHOLD,
+    MASTER_FIELD_ZONE,
+    MASTER_FIELD_GROUP,
+};
+
+static const adv_field_t master_layout[] = {
+    [MASTER_FIELD_MODE] = {2 + MAC_LEN, 0, 0xFF},
+    [MASTER_FIELD_AFFINITY] = {3 + MAC_LEN, 0, 0xFF},
+    [MASTER_FIELD_LEVEL] = {4 + MAC_LEN, 0, 0xFF},
+    [MASTER_FIELD_THRESHOLD] = {5 + MAC_LEN, 0, 0xFF},
+    [MASTER_FIELD_ZONE] = {MASTER_ADV_LEN, 0, 0xFF},
+    [MASTER_FIELD_GROUP] = {MASTER_ZONE_ADV_LEN, 0, 0xFF},
+};
+
+// Group master: same fields as MASTER with the target MAC replaced by one group byte
+enum {
+    GROUP_MASTER_FIELD_GROUP,
+    GROUP_MASTER_FIELD_MODE,
+    GROUP_MASTER_FIELD_AFFINITY,
+    GROUP_MASTER_FIELD_LEVEL,
+    GROUP_MASTER_FIELD_THRESHOLD,
+    GROUP_MASTER_FIELD_ZONE,
+};
+
+static const adv_field_t group_master_layout[] = {
+    [GROUP_MASTER_FIELD_GROUP] = {2, 0, 0xFF},
+    [GROUP_MASTER_FIELD_MODE] = {3, 0, 0xFF},
+    [GROUP_MASTER_FIELD_AFFINITY] = {4, 0, 0xFF},
+    [GROUP_MASTER_FIELD_LEVEL] = {5, 0, 0xFF},
+    [GROUP_MASTER_FIELD_THRESHOLD] = {6, 0, 0xFF},
+    [GROUP_MASTER_FIELD_ZONE] = {GROUP_MASTER_ADV_LEN, 0, 0xFF},
+};
+
+static const adv_field_t overseer_v2_header = {2, 0, 0x0F}; // Zone count under OVERSEER_V2_TAG
+static const adv_field_t overseer_summary_hops = {2, 0, 0x0F}; // Relays so far, under OVERSEER_SUMMARY_TAG
+static const adv_field_t overseer_summary_origin = {3, 0, 0xFF}; // 24-bit
+#define OVERSEER_SUMMARY_COUNTS 6 // Offset of the counts, magic levels 1-4 then techno
+
+enum {
+    TELEMETRY_FIELD_VERSION,
+    TELEMETRY_FIELD_MODE,
+    TELEMETRY_FIELD_UPTIME, // 16-bit fields are little-endian, the table holds the low byte
+    TELEMETRY_FIELD_REPORTS,
+    TELEMETRY_FIELD_RSSI_REJECTED,
+    TELEMETRY_FIELD_PEERS,
+    TELEMETRY_FIELD_ESTABLISHED,
+    TELEMETRY_FIELD_MAX_PROBE,
+    TELEMETRY_FIELD_PEERS_REFUSED,
+    TELEMETRY_FIELD_RING_DROPPED,
+    TELEMETRY_FIELD_ADV_FAILURES,
+    TELEMETRY_FIELD_SCAN_FAILURES,
+    TELEMETRY_FIELD_OVERRUNS,
+    TELEMETRY_FIELD_LAST_ERROR,
+};
+
+static const adv_field_t telemetry_layout[] = {
+    [TELEMETRY_FIELD_VERSION] = {2, 4, 0x0F},
+    [TELEMETRY_FIELD_MODE] = {2, 0, 0x0F},
+    [TELEMETRY_FIELD_UPTIME] = {3, 0, 0xFF},
+    [TELEMETRY_FIELD_REPORTS] = {5, 0, 0xFF},
+    [TELEMETRY_FIELD_RSSI_REJECTED] = {7, 0, 0xFF},
+    [TELEMETRY_FIELD_PEERS] = {9, 0, 0xFF},
+    [TELEMETRY_FIELD_ESTABLISHED] = {11, 0, 0xFF},
+    [TELEMETRY_FIELD_MAX_PROBE] = {13, 0, 0xFF},
+    [TELEMETRY_FIELD_PEERS_REFUSED] = {14, 0, 0xFF},
+    [TELEMETRY_FIELD_RING_DROPPED] = {15, 0, 0xFF},
+    [TELEMETRY_FIELD_ADV_FAILURES] = {16, 0, 0xFF},
+    [TELEMETRY_FIELD_SCAN_FAILURES] = {17, 0, 0xFF},
+    [TELEMETRY_FIELD_OVERRUNS] = {18, 0, 0xFF},
+    [TELEMETRY_FIELD_LAST_ERROR] = {19, 0, 0xFF},
+};
+
+#define TELEMETRY_VERSION_REQUEST 0
+#define TELEMETRY_VERSION_REPORT 1
+#define TELEMETRY_VERSION_PROFILE 2
+#define TELEMETRY_VERSION_PROVISION 3
+// What a request asks for, in the mode field
+#define TELEMETRY_REQUEST_COUNTERS 0
+#define TELEMETRY_REQUEST_PROFILE 1 // Answered with counters if the node has no CYCLE_PROFILER
+#define TELEMETRY_REQUEST_PROVISION 2 // Answered with counters by anything but a provisioner
+
+// Profile report: the clock, then per probe the log2 bucket of its longest sample
+// and how many buckets below that its median sits (saturating at 7)
+static const adv_field_t telemetry_profile_clock = {3, 0, 0xFF}; // 16-bit, kHz
+static const adv_field_t telemetry_profile_max = {5, 3, 0x1F}; // offset + probe index
+static const adv_field_t telemetry_profile_p50_below = {5, 0, 0x07}; // offset + probe index
+
+// Provision report: provision_stats_t and the assignments in progress
+enum {
+    TELEMETRY_PROVISION_QUEUED, // 16-bit
+    TELEMETRY_PROVISION_CONFIRMED, // 16-bit
+    TELEMETRY_PROVISION_ATTEMPTS, // 16-bit
+    TELEMETRY_PROVISION_DEFERRED, // 16-bit
+    TELEMETRY_PROVISION_ACTIVE,
+};
+
+static const adv_field_t telemetry_provision_layout[] = {
+    [TELEMETRY_PROVISION_QUEUED] = {3, 0, 0xFF},
+    [TELEMETRY_PROVISION_CONFIRMED] = {5, 0, 0xFF},
+    [TELEMETRY_PROVISION_ATTEMPTS] = {7, 0, 0xFF},
+    [TELEMETRY_PROVISION_DEFERRED] = {9, 0, 0xFF},
+    [TELEMETRY_PROVISION_ACTIVE] = {11, 0, 0xFF},
+};
+
+// Advertisement kinds, from the two magic bytes
+typedef enum {
+    ADV_KIND_NONE,
+    ADV_KIND_MESH, // 0xCE 0xFA
+    ADV_KIND_MASTER, // 0xAB 0xAC
+    ADV_KIND_GROUP_MASTER, // 0xAB 0xAD
+    ADV_KIND_OVERSEER, // 0xDE 0xAD
+    ADV_KIND_TELEMETRY, // 0xD1 0xA9
+} adv_kind_t;
+
+static inline uint8_t adv_get(const uint8_t *buf, adv_field_t field) {
+    return (uint8_t)((buf[field.offset] >> field.shift) & field.mask);
+}
+
+static inline void adv_put(uint8_t *buf, adv_field_t field, uint8_t value) {
+    buf[field.offset] = (uint8_t)((buf[field.offset] & ~(field.mask << field.shift)) |
+                                  ((value & field.mask) << field.shift));
+}
+
+// Little-endian 16-bit field, the table entry describes its low byte
+static inline void adv_put16(uint8_t *buf, adv_field_t field, uint16_t value) {
+    buf[field.offset] = (uint8_t)value;
+    buf[field.offset + 1] = (uint8_t)(value >> 8);
+}
+
+static inline uint16_t adv_get16(const uint8_t *buf, adv_field_t field) {
+    return (uint16_t)(buf[field.offset] | (buf[field.offset + 1] << 8));
+}
+
+static inline void adv_put24(uint8_t *buf, adv_field_t field, uint32_t value) {
+    adv_put16(buf, field, (uint16_t)value);
+    buf[field.offset + 2] = (uint8_t)(value >> 16);
+}
+
+static inline uint32_t adv_get24(const uint8_t *buf, adv_field_t field) {
+    return adv_get16(buf, field) | ((uint32_t)buf[field.offset + 2] << 16);
+}
+
+// Classify a manufacturer data payload by its magic bytes (len must be >= 2)
+static inline adv_kind_t adv_kind(const uint8_t *buf) {
+    switch ((buf[0] << 8) | buf[1]) {
+    case 0xCEFA: return ADV_KIND_MESH;
+    case 0xABAC: return ADV_KIND_MASTER;
+    case 0xABAD: return ADV_KIND_GROUP_MASTER;
+    case 0xDEAD: return ADV_KIND_OVERSEER;
+    case 0xD1A9: return ADV_KIND_TELEMETRY;
+    default: return ADV_KIND_NONE;
+    }
+}
+
+// Shortest payload of each kind that the decoders below accept
+static inline uint8_t adv_min_len(adv_kind_t kind) {
+    switch (kind) {
+    case ADV_KIND_MESH: return MESH_ADV_LEN;
+    case ADV_KIND_MASTER: return MASTER_ADV_LEN;
+    case ADV_KIND_GROUP_MASTER: return GROUP_MASTER_ADV_LEN;
+    case ADV_KIND_OVERSEER: return OVERSEER_V2_LEN(1);
+    case ADV_KIND_TELEMETRY: return TELEMETRY_REQUEST_LEN;
+    default: return 0xFF;
+    }
+}
+
+// --- Raw report parser ---
+
+#ifndef BT_DATA_MANUFACTURER_DATA
+#define BT_DATA_MANUFACTURER_DATA 0xff // AD type, same value as in Zephyr's gap.h
+#endif
+
+// Smallest report that can hold a mesh payload: [len][0xFF] + MESH_ADV_LEN
+#define ADV_REPORT_MIN_LEN (2 + MESH_ADV_LEN)
+
+// Find the mesh payload in the AD structures of a scan report, without copying.
+// Only the first manufacturer data structure is considered: foreign reports are
+// rejected on its company ID (our magic) or as soon as too few bytes remain to
+// hold a mesh payload, so a phone's Apple/Microsoft/Google structure costs one
+// compare. Truncated structures and payloads too short for their kind are
+// rejected here, so decoders only ever see complete payloads. On success
+// *payload points into data and *payload_len is clamped to ADV_RECORD_MAX_DATA.
+static inline adv_kind_t adv_parse(const uint8_t *data, uint16_t len, const uint8_t **payload, uint8_t *payload_len) {
+    while (len >= ADV_REPORT_MIN_LEN) {
+        uint8_t length = data[0]; // Type + data
+        if (length == 0 || length >= len) {
+            return ADV_KIND_NONE; // End of significant part, or truncated structure
+        }
+        if (data[1] == BT_DATA_MANUFACTURER_DATA) {
+            uint8_t mfg_len = length - 1;
+            adv_kind_t kind = mfg_len >= 2 ? adv_kind(&data[2]) : ADV_KIND_NONE;
+            if (kind == ADV_KIND_NONE || mfg_len < adv_min_len(kind)) {
+                return ADV_KIND_NONE;
+            }
+            *payload = &data[2];
+            *payload_len = mfg_len > ADV_RECORD_MAX_DATA ? ADV_RECORD_MAX_DATA : mfg_len;
+            return kind;
+        }
+        data += 1 + length;
+        len -= 1 + length;
+    }
+    return ADV_KIND_NONE;
+}
+
+// device_info_t level -> MESH level nibble
+static inline uint8_t adv_level_to_wire(uint8_t level, uint8_t affinity) {
+    if (affinity == AFFINITY_UNITY) {
+        return (uint8_t)((((level >> 4) & 0x03) << 2) | (level & 0x03));
+    }
+    return level & 0x0F;
+}
+
+// MESH level nibble -> device_info_t level
+static inline uint8_t adv_level_from_wire(uint8_t wire, uint8_t affinity) {
+    if (affinity == AFFINITY_UNITY) {
+        return (uint8_t)(((wire >> 2) & 0x03) << 4 | (wire & 0x03));
+    }
+    return wire;
+}
+
+// --- MESH ---
+
+static inline uint8_t adv_mesh_encode(uint8_t *buf, const device_info_t *info, uint8_t state) {
+    buf[0] = 0xCE;
+    buf[1] = 0xFA;
+    buf[2] = buf[3] = 0;
+    adv_put(buf, mesh_layout[MESH_FIELD_MODE], info->mode);
+    adv_put(buf, mesh_layout[MESH_FIELD_AFFINITY], info->affinity);
+    adv_put(buf, mesh_layout[MESH_FIELD_LEVEL], adv_level_to_wire(info->level, info->affinity));
+    adv_put(buf, mesh_layout[MESH_FIELD_STATE], state);
+    adv_put(buf, mesh_layout[MESH_FIELD_THRESHOLD], (uint8_t)info->dynamic_rssi_threshold);
+    return MESH_ADV_LEN;
+}
+
+// Decode a MESH payload whose magic bytes were already checked
+static inline bool adv_mesh_decode(const uint8_t *buf, uint8_t len, device_info_t *info, uint8_t *state) {
+    if (len < MESH_ADV_LEN) {
+        return false;
+    }
+    info->mode = adv_get(buf, mesh_layout[MESH_FIELD_MODE]);
+    info->affinity = adv_get(buf, mesh_layout[MESH_FIELD_AFFINITY]);
+    info->level = adv_level_from_wire(adv_get(buf, mesh_layout[MESH_FIELD_LEVEL]), info->affinity);
+    info->dynamic_rssi_threshold = (int8_t)adv_get(buf, mesh_layout[MESH_FIELD_THRESHOLD]);
+    info->zone = 0;
+    info->group = 0;
+    *state = adv_get(buf, mesh_layout[MESH_FIELD_STATE]);
+    return true;
+}
+
+// --- MASTER ---
+
+// Encode a MASTER advert for target_mac; with_zone appends info->zone, with_group
+// (which implies the zone) also info->group
+static inline uint8_t adv_master_encode(uint8_t *buf, const uint8_t *target_mac, const device_info_t *info,
+                                        bool with_zone, bool with_group) {
+    buf[0] = 0xAB;
+    buf[1] = 0xAC;
+    memcpy(&buf[2], target_mac, MAC_LEN);
+    adv_put(buf, master_layout[MASTER_FIELD_MODE], info->mode);
+    adv_put(buf, master_layout[MASTER_FIELD_AFFINITY], info->affinity);
+    adv_put(buf, master_layout[MASTER_FIELD_LEVEL], info->level);
+    adv_put(buf, master_layout[MASTER_FIELD_THRESHOLD], (uint8_t)info->dynamic_rssi_threshold);
+    if (!with_zone && !with_group) {
+        return MASTER_ADV_LEN;
+    }
+    adv_put(buf, master_layout[MASTER_FIELD_ZONE], info->zone);
+    if (!with_group) {
+        return MASTER_ZONE_ADV_LEN;
+    }
+    adv_put(buf, master_layout[MASTER_FIELD_GROUP], info->group);
+    return MASTER_GROUP_ADV_LEN;
+}
+
+// Decode a MASTER payload whose magic bytes were already checked. Without the
+// optional zone byte info->zone is left untouched (*has_zone = false), and so is
+// info->group without the group byte.
+static inline bool adv_master_decode(const uint8_t *buf, uint8_t len, const uint8_t **target_mac,
+                                     device_info_t *info, bool *has_zone) {
+    if (len < MASTER_ADV_LEN) {
+        return false;
+    }
+    *target_mac = &buf[2];
+    info->mode = adv_get(buf, master_layout[MASTER_FIELD_MODE]);
+    info->affinity = adv_get(buf, master_layout[MASTER_FIELD_AFFINITY]);
+    info->level = adv_get(buf, master_layout[MASTER_FIELD_LEVEL]);
+    info->dynamic_rssi_threshold = (int8_t)adv_get(buf, master_layout[MASTER_FIELD_THRESHOLD]);
+    *has_zone = len >= MASTER_ZONE_ADV_LEN;
+    if (*has_zone) {
+        info->zone = adv_get(buf, master_layout[MASTER_FIELD_ZONE]);
+    }
+    if (len >= MASTER_GROUP_ADV_LEN) {
+        info->group = adv_get(buf, master_layout[MASTER_FIELD_GROUP]);
+    }
+    return true;
+}
+
+// Encode a group MASTER advert for every device of a group; with_zone appends info->zone
+static inline uint8_t adv_group_master_encode(uint8_t *buf, uint8_t group, const device_info_t *info, bool with_zone) {
+    buf[0] = 0xAB;
+    buf[1] = 0xAD;
+    adv_put(buf, group_master_layout[GROUP_MASTER_FIELD_GROUP], group);
+    adv_put(buf, group_master_layout[GROUP_MASTER_FIELD_MODE], info->mode);
+    adv_put(buf, group_master_layout[GROUP_MASTER_FIELD_AFFINITY], info->affinity);
+    adv_put(buf, group_master_layout[GROUP_MASTER_FIELD_LEVEL], info->level);
+    adv_put(buf, group_master_layout[GROUP_MASTER_FIELD_THRESHOLD], (uint8_t)info->dynamic_rssi_threshold);
+    if (!with_zone) {
+        return GROUP_MASTER_ADV_LEN;
+    }
+    adv_put(buf, group_master_layout[GROUP_MASTER_FIELD_ZONE], info->zone);
+    return GROUP_MASTER_ZONE_ADV_LEN;
+}
+
+// Decode a group MASTER payload whose magic bytes were already checked. Like
+// adv_master_decode, info->zone is left untouched without the zone byte; the
+// group never changes info->group.
+static inline bool adv_group_master_decode(const uint8_t *buf, uint8_t len, uint8_t *group, device_info_t *info,
+                                           bool *has_zone) {
+    if (len < GROUP_MASTER_ADV_LEN) {
+        return false;
+    }
+    *group = adv_get(buf, group_master_layout[GROUP_MASTER_FIELD_GROUP]);
+    info->mode = adv_get(buf, group_master_layout[GROUP_MASTER_FIELD_MODE]);
+    info->affinity = adv_get(buf, group_master_layout[GROUP_MASTER_FIELD_AFFINITY]);
+    info->level = adv_get(buf, group_master_layout[GROUP_MASTER_FIELD_LEVEL]);
+    info->dynamic_rssi_threshold = (int8_t)adv_get(buf, group_master_layout[GROUP_MASTER_FIELD_THRESHOLD]);
+    *has_zone = len >= GROUP_MASTER_ZONE_ADV_LEN;
+    if (*has_zone) {
+        info->zone = adv_get(buf, group_master_layout[GROUP_MASTER_FIELD_ZONE]);
+    }
+    return true;
+}
+
+// --- OVERSEER ---
+
+// Pack one-byte-per-(affinity, level) commands into the V2 states byte
+static inline uint8_t adv_overseer_pack_levels(const uint8_t levels[8]) {
+    uint8_t states = 0;
+    for (int i = 0; i < 8; i++) {
+        states |= (uint8_t)((levels[i] ? 1 : 0) << i);
+    }
+    return states;
+}
+
+// Commanded state for a device of the given affinity and level (0-3) from a states byte
+static inline uint8_t adv_overseer_state_for(uint8_t states, uint8_t affinity, uint8_t level) {
+    if (level > 3) {
+        return 0;
+    }
+    uint8_t magic_state = (states >> level) & 1; // Magic levels in bits 0-3
+    uint8_t techno_state = (states >> (level + 4)) & 1; // Techno levels in bits 4-7
+    if (affinity == AFFINITY_MAGIC) {
+        return magic_state;
+    } else if (affinity == AFFINITY_TECHNO) {
+        return techno_state;
+    } else if (affinity == AFFINITY_UNITY) {
+        return magic_state | techno_state; // Unity follows the better of both
+    }
+    return 0;
+}
+
+static inline uint8_t adv_overseer_legacy_encode(uint8_t *buf, uint8_t states) {
+    buf[0] = 0xDE;
+    buf[1] = 0xAD;
+    for (int i = 0; i < 8; i++) {
+        buf[2 + i] = (states >> i) & 1;
+    }
+    return OVERSEER_ADV_LEN;
+}
+
+// Encode a V2 advert from (zone, states) pairs, own zone first
+static inline uint8_t adv_overseer_v2_encode(uint8_t *buf, const uint8_t *zone_ids, const uint8_t *zone_states, uint8_t zones) {
+    buf[0] = 0xDE;
+    buf[1] = 0xAD;
+    buf[2] = OVERSEER_V2_TAG;
+    adv_put(buf, overseer_v2_header, zones);
+    for (uint8_t i = 0; i < zones; i++) {
+        buf[3 + 2 * i] = zone_ids[i];
+        buf[4 + 2 * i] = zone_states[i];
+    }
+    return OVERSEER_V2_LEN(zones);
+}
+
+static inline bool adv_overseer_is_v2(const uint8_t *buf, uint8_t len) {
+    return len >= OVERSEER_V2_LEN(1) && (buf[2] & OVERSEER_V2_TAG_MASK) == OVERSEER_V2_TAG &&
+        adv_get(buf, overseer_v2_header) > 0 && len >= OVERSEER_V2_LEN(adv_get(buf, overseer_v2_header));
+}
+
+// Find the states byte for zone in an OVERSEER payload (legacy or V2).
+// Legacy adverts carry no zone and drive zone 0. Returns false if the zone is absent.
+static inline bool adv_overseer_zone_states(const uint8_t *buf, uint8_t len, uint8_t zone, uint8_t *states) {
+    if (len >= OVERSEER_ADV_LEN && buf[2] <= 1) {
+        // Legacy: one byte per (affinity, level)
+        if (zone != 0) {
+            return false;
+        }
+        *states = adv_overseer_pack_levels(&buf[2]);
+        return true;
+    }
+    if (!adv_overseer_is_v2(buf, len)) {
+        return false;
+    }
+    uint8_t zones = adv_get(buf, overseer_v2_header);
+    for (uint8_t i = 0; i < zones; i++) {
+        if (buf[3 + 2 * i] == zone) {
+            *states = buf[4 + 2 * i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool adv_overseer_is_summary(const uint8_t *buf, uint8_t len) {
+    return len >= OVERSEER_SUMMARY_LEN && (buf[2] & OVERSEER_V2_TAG_MASK) == OVERSEER_SUMMARY_TAG;
+}
+
+// Encode a summary; hops is how many overseers relayed it before us (0 = our own counts)
+static inline uint8_t adv_overseer_summary_encode(uint8_t *buf, const overseer_summary_t *s, uint8_t hops) {
+    buf[0] = 0xDE;
+    buf[1] = 0xAD;
+    buf[2] = OVERSEER_SUMMARY_TAG;
+    adv_put(buf, overseer_summary_hops, hops);
+    adv_put24(buf, overseer_summary_origin, s->origin);
+    memcpy(&buf[OVERSEER_SUMMARY_COUNTS], s->counts, 2 * OVERSEER_SUMMARY_LEVELS);
+    return OVERSEER_SUMMARY_LEN;
+}
+
+// Decode an OVERSEER payload whose magic bytes were already checked, false unless a summary.
+// s->hops is the on-air relay count, s->age is left untouched.
+static inline bool adv_overseer_summary_decode(const uint8_t *buf, uint8_t len, overseer_summary_t *s) {
+    if (!adv_overseer_is_summary(buf, len)) {
+        return false;
+    }
+    s->hops = adv_get(buf, overseer_summary_hops);
+    s->origin = adv_get24(buf, overseer_summary_origin);
+    memcpy(s->counts, &buf[OVERSEER_SUMMARY_COUNTS], 2 * OVERSEER_SUMMARY_LEVELS);
+    return true;
+}
+
+// --- TELEMETRY ---
+
+// Decoded telemetry report. reports_received and reports_rssi_rejected wrap at 16 bits:
+// a sniffer takes the difference between two reports. The one-byte counters saturate.
+typedef struct {
+    uint8_t mode; // operation_mode_t
+    uint16_t uptime_min; // Minutes since boot
+    uint16_t reports_received; // Scan reports seen by scan_cb
+    uint16_t reports_rssi_rejected; // ... of which below RSSI_SCAN_GATE
+    uint16_t peers; // Peers in the table
+    uint16_t established; // Established peers at the last end of cycle
+    uint8_t max_probe; // Longest peer table probe since boot
+    uint8_t peers_refused; // New peers refused, table full
+    uint8_t ring_dropped; // Adverts lost because the scan_cb ring was full
+    uint8_t adv_start_failures;
+    uint8_t scan_start_failures;
+    uint8_t cycle_overruns;
+    int8_t last_error; // ERROR_* code (errors.h)
+} telemetry_t;
+
+static inline uint8_t adv_saturate8(uint32_t value) {
+    return value > 0xFF ? 0xFF : (uint8_t)value;
+}
+
+static inline uint8_t adv_telemetry_encode(uint8_t *buf, const telemetry_t *t) {
+    buf[0] = 0xD1;
+    buf[1] = 0xA9;
+    buf[2] = 0;
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_VERSION], TELEMETRY_VERSION_REPORT);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_MODE], t->mode);
+    adv_put16(buf, telemetry_layout[TELEMETRY_FIELD_UPTIME], t->uptime_min);
+    adv_put16(buf, telemetry_layout[TELEMETRY_FIELD_REPORTS], t->reports_received);
+    adv_put16(buf, telemetry_layout[TELEMETRY_FIELD_RSSI_REJECTED], t->reports_rssi_rejected);
+    adv_put16(buf, telemetry_layout[TELEMETRY_FIELD_PEERS], t->peers);
+    adv_put16(buf, telemetry_layout[TELEMETRY_FIELD_ESTABLISHED], t->established);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_MAX_PROBE], t->max_probe);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_PEERS_REFUSED], t->peers_refused);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_RING_DROPPED], t->ring_dropped);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_ADV_FAILURES], t->adv_start_failures);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_SCAN_FAILURES], t->scan_start_failures);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_OVERRUNS], t->cycle_overruns);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_LAST_ERROR], (uint8_t)t->last_error);
+    return TELEMETRY_ADV_LEN;
+}
+
+// Decode a TELEMETRY payload whose magic bytes were already checked, false for requests
+static inline bool adv_telemetry_decode(const uint8_t *buf, uint8_t len, telemetry_t *t) {
+    if (len < TELEMETRY_ADV_LEN || adv_get(buf, telemetry_layout[TELEMETRY_FIELD_VERSION]) != TELEMETRY_VERSION_REPORT) {
+        return false;
+    }
+    t->mode = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_MODE]);
+    t->uptime_min = adv_get16(buf, telemetry_layout[TELEMETRY_FIELD_UPTIME]);
+    t->reports_received = adv_get16(buf, telemetry_layout[TELEMETRY_FIELD_REPORTS]);
+    t->reports_rssi_rejected = adv_get16(buf, telemetry_layout[TELEMETRY_FIELD_RSSI_REJECTED]);
+    t->peers = adv_get16(buf, telemetry_layout[TELEMETRY_FIELD_PEERS]);
+    t->established = adv_get16(buf, telemetry_layout[TELEMETRY_FIELD_ESTABLISHED]);
+    t->max_probe = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_MAX_PROBE]);
+    t->peers_refused = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_PEERS_REFUSED]);
+    t->ring_dropped = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_RING_DROPPED]);
+    t->adv_start_failures = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_ADV_FAILURES]);
+    t->scan_start_failures = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_SCAN_FAILURES]);
+    t->cycle_overruns = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_OVERRUNS]);
+    t->last_error = (int8_t)adv_get(buf, telemetry_layout[TELEMETRY_FIELD_LAST_ERROR]);
+    return true;
+}
+
+// Decoded profile report, buckets as in profiler.h
+typedef struct {
+    uint8_t mode; // operation_mode_t
+    uint16_t clock_khz; // platform_cycles() rate
+    uint8_t max_bucket[TELEMETRY_PROFILE_PROBES]; // By prof_probe_t
+    uint8_t p50_bucket[TELEMETRY_PROFILE_PROBES];
+} telemetry_profile_t;
+
+static inline uint8_t adv_telemetry_profile_encode(uint8_t *buf, const telemetry_profile_t *p) {
+    buf[0] = 0xD1;
+    buf[1] = 0xA9;
+    buf[2] = 0;
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_VERSION], TELEMETRY_VERSION_PROFILE);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_MODE], p->mode);
+    adv_put16(buf, telemetry_profile_clock, p->clock_khz);
+    for (uint8_t i = 0; i < TELEMETRY_PROFILE_PROBES; i++) {
+        adv_field_t max = telemetry_profile_max;
+        adv_field_t below = telemetry_profile_p50_below;
+        max.offset += i;
+        below.offset += i;
+        uint8_t gap = p->max_bucket[i] - p->p50_bucket[i];
+        buf[max.offset] = 0;
+        adv_put(buf, max, p->max_bucket[i]);
+        adv_put(buf, below, gap > 7 ? 7 : gap);
+    }
+    return TELEMETRY_PROFILE_LEN;
+}
+
+// Decode a TELEMETRY payload whose magic bytes were already checked, false unless a profile report
+static inline bool adv_telemetry_profile_decode(const uint8_t *buf, uint8_t len, telemetry_profile_t *p) {
+    if (len < TELEMETRY_PROFILE_LEN ||
+        adv_get(buf, telemetry_layout[TELEMETRY_FIELD_VERSION]) != TELEMETRY_VERSION_PROFILE) {
+        return false;
+    }
+    p->mode = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_MODE]);
+    p->clock_khz = adv_get16(buf, telemetry_profile_clock);
+    for (uint8_t i = 0; i < TELEMETRY_PROFILE_PROBES; i++) {
+        adv_field_t max = telemetry_profile_max;
+        adv_field_t below = telemetry_profile_p50_below;
+        max.offset += i;
+        below.offset += i;
+        p->max_bucket[i] = adv_get(buf, max);
+        uint8_t gap = adv_get(buf, below);
+        p->p50_bucket[i] = gap > p->max_bucket[i] ? 0 : p->max_bucket[i] - gap;
+    }
+    return true;
+}
+
+// Decoded provision report
+typedef struct {
+    uint8_t mode; // operation_mode_t, always MODE_PROVISIONER
+    provision_stats_t stats;
+    uint8_t active; // Assignments in progress
+} telemetry_provision_t;
+
+static inline uint8_t adv_telemetry_provision_encode(uint8_t *buf, const telemetry_provision_t *p) {
+    buf[0] = 0xD1;
+    buf[1] = 0xA9;
+    buf[2] = 0;
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_VERSION], TELEMETRY_VERSION_PROVISION);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_MODE], p->mode);
+    adv_put16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_QUEUED], p->stats.queued);
+    adv_put16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_CONFIRMED], p->stats.confirmed);
+    adv_put16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_ATTEMPTS], p->stats.attempts);
+    adv_put16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_DEFERRED], p->stats.deferred);
+    adv_put(buf, telemetry_provision_layout[TELEMETRY_PROVISION_ACTIVE], p->active);
+    return TELEMETRY_PROVISION_LEN;
+}
+
+// Decode a TELEMETRY payload whose magic bytes were already checked, false unless a provision report
+static inline bool adv_telemetry_provision_decode(const uint8_t *buf, uint8_t len, telemetry_provision_t *p) {
+    if (len < TELEMETRY_PROVISION_LEN ||
+        adv_get(buf, telemetry_layout[TELEMETRY_FIELD_VERSION]) != TELEMETRY_VERSION_PROVISION) {
+        return false;
+    }
+    p->mode = adv_get(buf, telemetry_layout[TELEMETRY_FIELD_MODE]);
+    p->stats.queued = adv_get16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_QUEUED]);
+    p->stats.confirmed = adv_get16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_CONFIRMED]);
+    p->stats.attempts = adv_get16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_ATTEMPTS]);
+    p->stats.deferred = adv_get16(buf, telemetry_provision_layout[TELEMETRY_PROVISION_DEFERRED]);
+    p->active = adv_get(buf, telemetry_provision_layout[TELEMETRY_PROVISION_ACTIVE]);
+    return true;
+}
+
+// Encode a request for telemetry from target_mac (all FF = every node that hears it),
+// what = TELEMETRY_REQUEST_COUNTERS, _PROFILE or _PROVISION
+static inline uint8_t adv_telemetry_request_encode(uint8_t *buf, const uint8_t *target_mac, uint8_t what) {
+    buf[0] = 0xD1;
+    buf[1] = 0xA9;
+    buf[2] = 0;
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_VERSION], TELEMETRY_VERSION_REQUEST);
+    adv_put(buf, telemetry_layout[TELEMETRY_FIELD_MODE], what);
+    memcpy(&buf[3], target_mac, MAC_LEN);
+    return TELEMETRY_REQUEST_LEN;
+}
+
+// True if a TELEMETRY payload is a request addressed to own_mac or to everyone
+static inline bool adv_telemetry_request_for(const uint8_t *buf, uint8_t len, const uint8_t *own_mac) {
+    static const uint8_t everyone[MAC_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (len < TELEMETRY_REQUEST_LEN ||
+        adv_get(buf, telemetry_layout[TELEMETRY_FIELD_VERSION]) != TELEMETRY_VERSION_REQUEST) {
+        return false;
+    }
+    return !memcmp(&buf[3], own_mac, MAC_LEN) || !memcmp(&buf[3], everyone, MAC_LEN);
+}
+
+// TELEMETRY_REQUEST_* of a request accepted by adv_telemetry_request_for
+static inline uint8_t adv_telemetry_request_what(const uint8_t *buf) {
+    return adv_get(buf, telemetry_layout[TELEMETRY_FIELD_MODE]);
+}
+
+// Find the TELEMETRY payload (report, profile or request) in the AD structures of a
+// scan report. Unlike adv_parse() every manufacturer data structure is visited: the
+// report travels behind the node's MESH/OVERSEER payload. For sniffers and host tools.
+static inline const uint8_t *adv_telemetry_payload(const uint8_t *data, uint16_t len, uint8_t *payload_len) {
+    while (len >= 2) {
+        uint8_t length = data[0];
+        if (length == 0 || length >= len) {
+            return NULL;
+        }
+        if (data[1] == BT_DATA_MANUFACTURER_DATA && length - 1 >= 2 && adv_kind(&data[2]) == ADV_KIND_TELEMETRY) {
+            *payload_len = length - 1;
+            return &data[2];
+        }
+        data += 1 + length;
+        len -= 1 + length;
+    }
+    return NULL;
+}
+
+// Find and decode a telemetry counters report in a scan report
+static inline bool adv_telemetry_find(const uint8_t *data, uint16_t len, telemetry_t *t) {
+    uint8_t payload_len;
+    const uint8_t *payload = adv_telemetry_payload(data, len, &payload_len);
+    return payload && adv_telemetry_decode(payload, payload_len, t);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADV_CODEC_H */
@@ -0,0 +1,65 @@
+/* adv_ring.c - Single-producer/single-consumer ring of received adverts */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "adv_ring.h"
+
+#if (ADV_RING_SIZE & (ADV_RING_SIZE - 1)) != 0 || ADV_RING_SIZE > 128
+#error "ADV_RING_SIZE must be a power of two no larger than 128"
+#endif
+
+static adv_record_t records[ADV_RING_SIZE];
+static uint8_t head; // Written by the producer only
+static uint8_t tail; // Written by the consumer only
+static adv_ring_stats_t stats;
+
+bool adv_ring_push(const uint8_t *mac, int8_t rssi, const uint8_t *data, uint8_t len) {
+    uint8_t h = head;
+    uint8_t fill = (uint8_t)(h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE));
+
+    if (fill >= ADV_RING_SIZE) {
+        stats.dropped++;
+        return false;
+    }
+
+    adv_record_t *record = &records[h & (ADV_RING_SIZE - 1)];
+    memcpy(record->mac, mac, MAC_LEN);
+    record->rssi = rssi;
+    record->len = len > ADV_RECORD_MAX_DATA ? ADV_RECORD_MAX_DATA : len;
+    memcpy(record->data, data, record->len);
+    __atomic_store_n(&head, (uint8_t)(h + 1), __ATOMIC_RELEASE);
+
+    stats.pushed++;
+    if (fill + 1 > stats.high_watermark) {
+        stats.high_watermark = fill + 1;
+    }
+    return true;
+}
+
+bool adv_ring_pop(adv_record_t *record) {
+    uint8_t t = tail;
+
+    if (t == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *record = records[t & (ADV_RING_SIZE - 1)];
+    __atomic_store_n(&tail, (uint8_t)(t + 1), __ATOMIC_RELEASE);
+    return true;
+}
+
+uint8_t adv_ring_count(void) {
+    return (uint8_t)(__atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE));
+}
+
+const adv_ring_stats_t *adv_ring_stats(void) {
+    return &stats;
+}
+
+void adv_ring_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
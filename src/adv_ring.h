@@ -0,0 +1,50 @@
+/* adv_ring.h - Single-producer/single-consumer ring of received adverts */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ADV_RING_H
+#define ADV_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "defines.h"
+
+// scan_cb (BT RX context) is the only producer, the advert worker the only
+// consumer. Indices are free-running 8-bit counters published with
+// release/acquire ordering, so no lock or interrupt masking is needed.
+
+typedef struct {
+    uint8_t mac[MAC_LEN]; // Advertiser address
+    int8_t rssi; // Received signal strength
+    uint8_t len; // Payload length (starts at the 2-byte magic)
+    uint8_t data[ADV_RECORD_MAX_DATA]; // Manufacturer data payload
+} adv_record_t;
+
+typedef struct {
+    uint32_t pushed; // Records accepted
+    uint32_t dropped; // Records lost because the ring was full
+    uint8_t high_watermark; // Highest fill level seen
+} adv_ring_stats_t;
+
+// Producer side: copy one payload into the ring, false if full (counted as dropped)
+bool adv_ring_push(const uint8_t *mac, int8_t rssi, const uint8_t *data, uint8_t len);
+// Consumer side: take the oldest record, false if empty
+bool adv_ring_pop(adv_record_t *record);
+// Records waiting to be processed
+uint8_t adv_ring_count(void);
+
+const adv_ring_stats_t *adv_ring_stats(void);
+void adv_ring_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADV_RING_H */
@@ -0,0 +1,267 @@
+/* config_store.c - Deferred device_info writes and the fast-boot config pages */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "config_store.h"
+
+static device_info_t committed; // Newest value on flash (valid if has_committed)
+static device_info_t pending;
+static bool has_committed;
+static bool has_pending;
+static bool page_known; // active_page and next_slot were found by config_store_load
+static uint8_t active_page; // Page of the newest record
+static uint8_t generation; // Of the records on active_page
+static uint16_t next_slot; // First erased record slot of active_page
+static config_store_stats_t stats;
+
+static uint8_t crc8(const uint8_t *data, uint8_t len) {
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)(crc << 1 ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void encode_record(uint8_t *record, const device_info_t *info, uint8_t record_generation) {
+    record[0] = CONFIG_RECORD_MAGIC | (record_generation & ~CONFIG_RECORD_MAGIC_MASK);
+    record[1] = info->mode;
+    record[2] = info->affinity;
+    record[3] = info->level;
+    record[4] = (uint8_t)info->dynamic_rssi_threshold;
+    record[5] = info->zone;
+    record[6] = info->group;
+    record[7] = crc8(record, CONFIG_RECORD_LEN - 1);
+}
+
+void config_record_encode(uint8_t *record, const device_info_t *info) {
+    encode_record(record, info, 0);
+}
+
+bool config_record_decode(const uint8_t *record, device_info_t *info) {
+    if ((record[0] & CONFIG_RECORD_MAGIC_MASK) != CONFIG_RECORD_MAGIC ||
+        record[CONFIG_RECORD_LEN - 1] != crc8(record, CONFIG_RECORD_LEN - 1)) {
+        return false;
+    }
+    info->mode = record[1];
+    info->affinity = record[2];
+    info->level = record[3];
+    info->dynamic_rssi_threshold = (int8_t)record[4];
+    info->zone = record[5];
+    info->group = record[6];
+    return true;
+}
+
+void provision_record_encode(uint8_t *record, const uint8_t *mac, const device_info_t *info) {
+    memcpy(record, mac, MAC_LEN);
+    config_record_encode(&record[MAC_LEN], info);
+    memset(&record[MAC_LEN + CONFIG_RECORD_LEN], 0xFF, PROVISION_RECORD_LEN - MAC_LEN - CONFIG_RECORD_LEN);
+}
+
+bool provision_record_decode(const uint8_t *record, uint8_t *mac, device_info_t *info) {
+    if (!config_record_decode(&record[MAC_LEN], info)) {
+        return false;
+    }
+    memcpy(mac, record, MAC_LEN);
+    return true;
+}
+
+static bool erased(const uint8_t *data, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool provision_record_erased(const uint8_t *record) {
+    return erased(record, PROVISION_RECORD_LEN);
+}
+
+static uint16_t slot_offset(const config_flash_t *flash, uint8_t page, uint16_t slot) {
+    return (uint16_t)(page * flash->page_size + slot * CONFIG_RECORD_LEN);
+}
+
+static bool slot_erased(const config_flash_t *flash, uint8_t page, uint16_t slot) {
+    uint8_t record[CONFIG_RECORD_LEN];
+    if (flash->read(slot_offset(flash, page, slot), record, sizeof(record))) {
+        return false;
+    }
+    return erased(record, sizeof(record));
+}
+
+typedef struct {
+    uint16_t next_slot; // First erased slot
+    bool valid; // Holds a valid record (the newest one is in info)
+    uint8_t generation;
+    device_info_t info;
+} page_scan_t;
+
+static void scan_page(const config_flash_t *flash, uint8_t page, page_scan_t *scan) {
+    uint16_t slots = flash->page_size / CONFIG_RECORD_LEN;
+    uint8_t record[CONFIG_RECORD_LEN];
+
+    // Slots below the first erased one are all written: binary search for it
+    uint16_t low = 0;
+    uint16_t high = slots;
+    while (low < high) {
+        uint16_t mid = (uint16_t)(low + (high - low) / 2);
+        if (slot_erased(flash, page, mid)) {
+            high = mid;
+        } else {
+            low = (uint16_t)(mid + 1);
+        }
+    }
+    scan->next_slot = low;
+
+    // The last record can be torn by a reset during the write, fall back to the one before
+    scan->valid = false;
+    for (uint16_t slot = low; slot-- > 0;) {
+        if (!flash->read(slot_offset(flash, page, slot), record, sizeof(record)) &&
+            config_record_decode(record, &scan->info)) {
+            scan->valid = true;
+            scan->generation = record[0] & ~CONFIG_RECORD_MAGIC_MASK;
+            break;
+        }
+    }
+}
+
+static bool info_equal(const device_info_t *a, const device_info_t *b) {
+    return a->mode == b->mode && a->affinity == b->affinity && a->level == b->level &&
+           a->dynamic_rssi_threshold == b->dynamic_rssi_threshold && a->zone == b->zone && a->group == b->group;
+}
+
+bool config_store_load(const config_flash_t *flash, device_info_t *info) {
+    page_scan_t pages[CONFIG_STORE_PAGES];
+    for (uint8_t page = 0; page < CONFIG_STORE_PAGES; page++) {
+        scan_page(flash, page, &pages[page]);
+    }
+
+    // Both pages hold records after a reset between the first write to a new page and
+    // the next switch: the newer one is a generation ahead
+    active_page = 0;
+    if (pages[1].valid && (!pages[0].valid || ((pages[1].generation - pages[0].generation) & 3) == 1)) {
+        active_page = 1;
+    }
+    const page_scan_t *active = &pages[active_page];
+    next_slot = active->next_slot;
+    generation = active->valid ? active->generation : 0;
+    page_known = true;
+
+    has_committed = active->valid;
+    if (has_committed) {
+        committed = active->info;
+        *info = committed;
+    }
+    return has_committed;
+}
+
+void config_store_request(const device_info_t *info) {
+    if (has_committed && info_equal(info, &committed)) {
+        if (has_pending) {
+            stats.coalesced++; // Back to the committed value before the write happened
+        }
+        has_pending = false;
+        stats.skipped++;
+        return;
+    }
+    if (has_pending) {
+        stats.coalesced++;
+    }
+    pending = *info;
+    has_pending = true;
+}
+
+bool config_store_pending(void) {
+    return has_pending;
+}
+
+static int write_record(const config_flash_t *flash, uint8_t page, uint16_t slot, const uint8_t *record) {
+    uint8_t check[CONFIG_RECORD_LEN];
+    int err = flash->write(slot_offset(flash, page, slot), record, CONFIG_RECORD_LEN);
+    if (!err) {
+        err = flash->read(slot_offset(flash, page, slot), check, sizeof(check));
+    }
+    if (!err && memcmp(check, record, CONFIG_RECORD_LEN)) {
+        err = -5; // -EIO
+    }
+    return err;
+}
+
+// Erase the other page and write the record to its first slot, a generation up.
+// The active page keeps the previous record until the next switch.
+static int switch_page(const config_flash_t *flash) {
+    uint8_t page = (uint8_t)((active_page + 1) % CONFIG_STORE_PAGES);
+    uint8_t record[CONFIG_RECORD_LEN];
+    int err = flash->erase(page);
+    if (err) {
+        return err;
+    }
+    stats.erases++;
+    encode_record(record, &pending, (uint8_t)(generation + 1));
+    if ((err = write_record(flash, page, 0, record))) {
+        return err;
+    }
+    active_page = page;
+    generation = (uint8_t)((generation + 1) & ~CONFIG_RECORD_MAGIC_MASK);
+    next_slot = 0;
+    return 0;
+}
+
+int config_store_commit(const config_flash_t *flash) {
+    uint8_t record[CONFIG_RECORD_LEN];
+    int err;
+
+    if (!has_pending) {
+        return 0;
+    }
+    if (!page_known) {
+        device_info_t ignored;
+        config_store_load(flash, &ignored);
+        if (has_committed && info_equal(&pending, &committed)) {
+            has_pending = false;
+            stats.skipped++;
+            return 0;
+        }
+    }
+    err = -28; // -ENOSPC
+    if (next_slot < flash->page_size / CONFIG_RECORD_LEN) {
+        encode_record(record, &pending, generation);
+        err = write_record(flash, active_page, next_slot, record);
+    }
+    if (err) {
+        // Page full, or a bad slot (or one written behind our back): continue on the other page
+        if ((err = switch_page(flash))) {
+            page_known = false;
+            return err;
+        }
+    }
+    next_slot++;
+    committed = pending;
+    has_committed = true;
+    has_pending = false;
+    stats.commits++;
+    return 0;
+}
+
+const config_store_stats_t *config_store_stats(void) {
+    return &stats;
+}
+
+void config_store_reset(void) {
+    has_committed = false;
+    has_pending = false;
+    page_known = false;
+    active_page = 0;
+    generation = 0;
+    next_slot = 0;
+    memset(&stats, 0, sizeof(stats));
+}
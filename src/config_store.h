@@ -0,0 +1,82 @@
+/* config_store.h - Deferred device_info writes and the fast-boot config pages */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+#include "defines.h"
+
+// The committed device_info_t lives in CONFIG_STORE_PAGES flash pages of its own, as
+// an append-only log of CONFIG_RECORD_LEN-byte records (erased flash reads 0xFF).
+// Records fill the active page front to back, so the newest one is found by a binary
+// search for the first erased slot: a handful of reads at boot instead of mounting NVS.
+// When the active page is full the other page is erased and the record goes to its
+// first slot, one generation up. The page holding the newest record is never erased,
+// so a reset at any point leaves a valid configuration on flash.
+//
+// Writes are deferred: config_store_request() just remembers the value, a newer
+// request replaces it and one equal to the committed value cancels it. The platform
+// calls config_store_commit() when the radio is stopped.
+
+// Record: [CONFIG_RECORD_MAGIC|generation:2][mode][affinity][level][threshold][zone][group][crc8 of bytes 0-6]
+// The generation (mod 4) tells which page is newer when both hold records.
+#define CONFIG_RECORD_MAGIC 0xC4
+#define CONFIG_RECORD_MAGIC_MASK 0xFC
+#define CONFIG_STORE_PAGES 2
+
+// Flash access supplied by the platform, offsets relative to the start of the first
+// config page. Functions return 0 or a negative error.
+typedef struct {
+    int (*read)(uint16_t offset, void *data, uint16_t len);
+    int (*write)(uint16_t offset, const void *data, uint16_t len);
+    int (*erase)(uint8_t page); // One whole page, 0 to CONFIG_STORE_PAGES - 1
+    uint16_t page_size;
+} config_flash_t;
+
+typedef struct {
+    uint32_t commits; // Records written
+    uint32_t erases; // Page erases
+    uint32_t coalesced; // Requests replaced before they were written
+    uint32_t skipped; // Requests equal to the committed value
+} config_store_stats_t;
+
+// Read the newest valid record into info. False if no page holds one (info untouched).
+bool config_store_load(const config_flash_t *flash, device_info_t *info);
+// Remember info for the next commit
+void config_store_request(const device_info_t *info);
+bool config_store_pending(void);
+// Write the pending value, if any. On error it stays pending for the next call.
+int config_store_commit(const config_flash_t *flash);
+
+const config_store_stats_t *config_store_stats(void);
+// Forget the loaded page and the pending value (host tests)
+void config_store_reset(void);
+
+// Records of generation 0 (also the provisioner queue), the store sets its own
+void config_record_encode(uint8_t *record, const device_info_t *info);
+bool config_record_decode(const uint8_t *record, device_info_t *info);
+
+// Provisioner queue entries (PROVISION_RECORD_LEN bytes): the target MAC, then its
+// configuration as a config record. Written to flash before the game by
+// host/provision_hex, read back with platform_read_provision_record().
+void provision_record_encode(uint8_t *record, const uint8_t *mac, const device_info_t *info);
+bool provision_record_decode(const uint8_t *record, uint8_t *mac, device_info_t *info);
+// True for erased flash, the end of the queue
+bool provision_record_erased(const uint8_t *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_STORE_H */
@@ -4,13 +4,24 @@
 // Flash
 #define NVS_ID_DEVICE_INFO 1 // Device info ID in NVS
 #define NVS_ID_STATIC_ADDR 2
+#define CONFIG_RECORD_LEN 8 // config_store.h record, a multiple of the flash write block
+#define PROVISION_RECORD_LEN 16 // Provisioner queue entry: [target_mac:6][config record:8][0xFF][0xFF]
 
 // BLE/peer
 #define MAC_LEN 6
-#define MAX_PEERS 255  // Maximize peer capacity within RAM constraints
-#define HASH_PROBE_STEP 7  // Prime number for linear probing step
+#define PEER_TABLE_SIZE 512  // Hash table slots, must be a power of two
+#define PEER_TABLE_MASK (PEER_TABLE_SIZE - 1)
+#define MAX_PEERS 448  // Peer capacity, kept below PEER_TABLE_SIZE so probes always hit an empty slot
+#define PEER_MAX_PROBE_LENGTH 32  // Hard bound on slots visited by any lookup
 
+#ifndef RSSI_THRESHOLD // Thresholds marked #ifndef can be overridden for simulator builds (host/sim)
 #define RSSI_THRESHOLD -70 // RSSI threshold for peer discovery
+#endif
+#ifndef RSSI_HYSTERESIS_DB
+#define RSSI_HYSTERESIS_DB 6 // Counted peers leave only once their smoothed RSSI drops this far below the threshold
+#endif
+#define RSSI_SCAN_GATE (RSSI_THRESHOLD - RSSI_HYSTERESIS_DB) // Reports below are dropped in scan_cb
+#define PEER_RSSI_EWMA_SHIFT 2 // Smoothed peer RSSI follows 1/4 of each new report
 #define LVLUP_TOKEN_RSSI_THRESHOLD -45 // RSSI threshold for level-up token discovery (really close)
 
 // Dynamic RSSI threshold feature:
@@ -19,40 +30,166 @@
 // - Value 0 = disabled (use default RSSI_THRESHOLD)
 // - If set higher than RSSI_THRESHOLD, effectively no additional filtering
 // - Applied to aura and overseer advertisements in device mode, extensible to other modes
+// - For auras it is the entry threshold of the RSSI hysteresis (see count_peer)
 
 // Peer tracking thresholds
+#ifndef PEER_DETECTION_THRESHOLD
 #define PEER_DETECTION_THRESHOLD 2  // Consecutive detections needed to include peer in calculations
+#endif
+#ifndef PEER_MISS_THRESHOLD
 #define PEER_MISS_THRESHOLD 2       // Consecutive misses before excluding peer from calculations
+#endif
+#ifndef OVERSEER_DETECTION_THRESHOLD
 #define OVERSEER_DETECTION_THRESHOLD 3  // Consecutive detections needed to trust overseer
+#endif
+#ifndef OVERSEER_MISS_THRESHOLD
 #define OVERSEER_MISS_THRESHOLD 6       // Consecutive misses before ignoring overseer
+#endif
 
-// --- Bit-packing Helper Macros ---
-// Advertisement data is nibble-packed to reduce air time and RF congestion
-#define PACK_MODE_AFFINITY(mode, affinity) (((mode) << 4) | ((affinity) & 0x0F))
-#define PACK_LEVEL_STATE(level, state) (((level) << 4) | ((state) & 0x0F) )
-#define PACK_AURA_LEVEL_STATE(level, state, affinity) ((affinity != AFFINITY_UNITY ?  ((level) << 4) | ((state) & 0x0F) : (((level & 0x03) << 4) | ((level & 0x30) << 2))) | ((state) & 0x0F))
-#define UNPACK_MODE(byte) (((byte) >> 4) & 0x0F)
-#define UNPACK_AFFINITY(byte) ((byte) & 0x0F)
-#define UNPACK_LEVEL(byte, affinity) (affinity != AFFINITY_UNITY ? ((byte) >> 4) & 0x0F : (((byte) >> 4) & 0x03) || (((byte) >> 2) & 0x30) )
-#define UNPACK_STATE(byte) ((byte) & 0x0F)
+// Continuous scanning: the radio never stops for end of cycle; peers carry a last-seen
+// tick and are established/evicted by a periodic evaluator over a sliding time window.
+// The 5-bit ticks share peer_track with the stability counter, so it costs no table RAM.
+#ifndef CONTINUOUS_SCAN
+#define CONTINUOUS_SCAN 0 // 1 = scan continuously, 0 = stop the radio every CYCLE_DURATION_MS
+#endif
+#define PEER_EVAL_INTERVAL_MS 500 // Evaluator period: peer aging and device state decisions
+#define PEER_SEEN_WINDOW_MS 7000 // Evict peers not heard for this long (two cycles)
+#define PEER_ESTABLISH_SIGHTINGS 3 // Evaluator periods with a sighting before a peer counts (max 3)
+#define PEER_SEEN_WINDOW_TICKS (PEER_SEEN_WINDOW_MS / PEER_EVAL_INTERVAL_MS)
+#define PEER_CYCLE_TICKS (CYCLE_DURATION_MS / PEER_EVAL_INTERVAL_MS) // Evaluator periods per logical cycle
+
+// Advertisement layouts and their encode/decode live in adv_codec.h
 
 // --- Protocol/Format Length Defines ---
 #define MESH_ADV_LEN 5 // Optimized: [header:2][mode|affinity:1][level|state:1][dynamic_rssi:1]
-#define MASTER_ADV_LEN (2 + MAC_LEN + sizeof(device_info_t)) // 2 prefix + MAC + device_info_t structure
-#define OVERSEER_ADV_LEN 10 // 2 prefix + 8 bytes for state data (4 levels × 2 affinities)
+#define DEVICE_INFO_ADV_LEN 4 // mode, affinity, level, dynamic_rssi_threshold
+#define MASTER_ADV_LEN (2 + MAC_LEN + DEVICE_INFO_ADV_LEN) // 2 prefix + MAC + device_info_t fields
+#define MASTER_ZONE_ADV_LEN (MASTER_ADV_LEN + 1) // Optional trailing zone ID
+#define MASTER_GROUP_ADV_LEN (MASTER_ZONE_ADV_LEN + 1) // Optional group ID behind the zone, assigns the device's group
+// Group master: [0xAB][0xAD][group][device_info_t:4]([zone]), configures every device of a group
+// at once. Group 0 is "no group" and never matches.
+#define GROUP_MASTER_ADV_LEN (3 + DEVICE_INFO_ADV_LEN)
+#define GROUP_MASTER_ZONE_ADV_LEN (GROUP_MASTER_ADV_LEN + 1)
+#define OVERSEER_ADV_LEN 10 // Legacy: 2 prefix + 8 bytes for state data (4 levels × 2 affinities)
+// Overseer V2: [0xDE][0xAD][0xA0|zone_count] then per zone [zone_id][states], states packed 1 bit
+// per level (see overseer_zone_t). The tag byte is never 0/1, so it cannot be read as legacy.
+#define OVERSEER_V2_TAG 0xA0
+#define OVERSEER_V2_TAG_MASK 0xF0
+#define OVERSEER_V2_MAX_ZONES 4 // Own zone + 3 relayed, 11 bytes
+#define OVERSEER_V2_LEN(zones) (3 + 2 * (zones))
+#define OVERSEER_V2_RELAY_CYCLES OVERSEER_MISS_THRESHOLD // Drop relayed zones not heard for this long
+#define OVERSEER_LEGACY_ADV 0 // 1 = broadcast the legacy 10-byte format for old devices
+// Overseer summary: [0xDE][0xAD][0xB0|hops:4][origin:3] + established aura counts for levels 1-4,
+// magic then techno (level 0 never decides). Overseers decide from their own counts plus the
+// summaries of overseers up to OVERSEER_SUMMARY_MAX_HOPS away, so neighbours agree at their borders.
+#define OVERSEER_SUMMARY_TAG 0xB0
+#define OVERSEER_SUMMARY_LEVELS 4
+#define OVERSEER_SUMMARY_LEN (6 + 2 * OVERSEER_SUMMARY_LEVELS) // 14 bytes
+// Pooled counts are in half auras: an aura at or above this smoothed RSSI counts 2, a weaker one 1.
+// An aura between two overseers is weak at both and counts 1 + 1 wherever the counts are pooled.
+// Overseers must stand far enough apart that no aura is above it at two of them.
+#ifndef OVERSEER_SUMMARY_CORE_RSSI
+#define OVERSEER_SUMMARY_CORE_RSSI -60
+#endif
+#ifndef OVERSEER_SUMMARY_INTERVAL
+#define OVERSEER_SUMMARY_INTERVAL 5 // Every Nth overseer cycle advertises a summary instead of the states, 0 = off
+#endif
+#define OVERSEER_SUMMARY_MAX_HOPS 2 // Summaries are relayed until they are this many overseers from their origin
+#define OVERSEER_SUMMARY_SLOTS 6 // Other overseers' summaries kept (mode_overseer_state_t)
+#define OVERSEER_SUMMARY_MAX_AGE 30 // Forget summaries not heard for this many cycles (~1.75 min, 3 own-summary periods)
+// Telemetry: [0xD1][0xA9][version:4|mode:4] + counters (see adv_codec.h). Sent as a second
+// manufacturer data structure behind the MESH/OVERSEER payload, so peers never see it.
+#define TELEMETRY_ADV_LEN 20 // Version 1 report
+#define TELEMETRY_REQUEST_LEN (3 + MAC_LEN) // Version 0: [0xD1][0xA9][0x00][target_mac], FF:FF:FF:FF:FF:FF = everyone
+#define TELEMETRY_INTERVAL_CYCLES 100 // Unrequested report every N cycles (~6 min), 0 = on request only
+#define CYCLE_OVERRUN_SLACK_MS 100 // A cycle (or evaluator tick) this much later than planned is an overrun
+#define TELEMETRY_PROFILE_PROBES 10 // PROF_PROBE_COUNT (profiler.h)
+#define TELEMETRY_PROFILE_LEN (5 + TELEMETRY_PROFILE_PROBES) // Version 2: clock + one byte per profiler probe
+#define TELEMETRY_PROVISION_LEN 12 // Version 3: provisioner progress
+#define ADV_DATA_MAX_LEN 31 // Legacy advertising data: every AD structure is 2 bytes + payload
+
+// Cycle profiler (profiler.h): log2 histograms of cycle phases, end-of-cycle work and scan_cb,
+// in platform_cycles() units. Read through a profile telemetry request or from host builds.
+#ifndef CYCLE_PROFILER
+#define CYCLE_PROFILER 0 // 1 = record, costs PROF_PROBE_COUNT * 72 bytes of RAM
+#endif
+#define PROF_BUCKETS 32 // Bucket b holds [2^(b-1), 2^b) cycles
+
+// Controller duplicate filtering: with it the host sees about one report per peer per cycle.
+// The filter is reset whenever scanning restarts, i.e. at every cycle boundary and, if
+// SCAN_DUP_FILTER_REARM_MS is non-zero, that often inside the scan window so payload
+// changes (state toggles) still reach the host within that delay. Modes that must see
+// every payload change (level-up token) scan unfiltered.
+// One report per cycle also leaves the RSSI EWMA (PEER_RSSI_EWMA_SHIFT) one sample per
+// cycle, so it then takes about four cycles to follow a moving peer.
+// Off by default. Build with west build -- -DSCAN_FILTER_DUPLICATES=1, which also applies
+// dup_filter.conf for the controller's filter size.
+#ifndef SCAN_FILTER_DUPLICATES
+#define SCAN_FILTER_DUPLICATES 0 // 1 = the controller drops repeated adverts within a scan
+#endif
+#define SCAN_DUP_FILTER_REARM_MS 0 // Mid-window filter reset interval, 0 = cycle boundary only
+
+// Deferred advert processing (scan_cb -> ring -> worker thread)
+#define ADV_RING_SIZE 16 // Records in the scan_cb ring, power of two (check adv_ring_stats() high watermark)
+#define ADV_RECORD_MAX_DATA 14 // Largest payload kept per record (OVERSEER_SUMMARY_LEN, MASTER_GROUP_ADV_LEN)
+#define ADV_WORKER_BATCH 8 // Records processed per core lock hold
+#define ADV_WORKER_PRIORITY 5 // Preemptible, below the BT RX thread
+// Deepest adv_worker path: about 350 bytes from -fstack-usage (README, adv_worker Stack).
+// Not measured on target yet: the rest is headroom until a stack_report.conf build does.
+#define ADV_WORKER_STACK_SIZE 640
+#define ADV_WORKER_STACK_LOW 96 // ERROR_STACK_LOW in telemetry once less than this was never used
 
 // Timings - Optimized for 120-130 peer density with responsive device state changes
-#define STARTUP_DELAY_MS 5000 // 5 seconds for startup timeout
+#define STARTUP_DELAY_MS 5000 // Mode-change LED animation, plays while the radio keeps running
 #define CYCLE_DURATION_MS 3500 // 3.5 second cycle duration - balanced responsiveness/discovery
 #define BLINK_INTERVAL_MS 250 // 250ms blink interval for LEDs
+#define BLINK_ONCE_PERIOD_MS CYCLE_DURATION_MS // LED_BLINK_ONCE flashes for one interval per period
+#define CYCLE_DRAIN_MS 100 // Pause after scan/adv stop to let pending operations complete
 #define SCAN_INTERVAL_MS 701  // prime number, ~0.7s
 #define ADV_INTERVAL_MS 307   // prime number, ~0.3s
 #define SCAN_JITTER_MS 50     // up to +/-50ms random jitter
 #define ADV_JITTER_MS 30      // up to +/-30ms random jitter
 #define PEER_DISCOVERY_JITTER_MS 120 // Optimal jitter for 120-130 peers (reduced from 200ms)
-#define LVLUP_TOKEN_BROADCAST_COUNTDOWN 3 // Broadcast countdown for level-up token
+#define LVLUP_TOKEN_CONFIRM_CYCLES 8 // Level-up token: bursts to wait for the target's new level before keeping the charge
 #define OVERSEER_BROADCAST_COUNTDOWN 10 // Broadcast countdown for overseer mode
 
+// Provisioner: works through a queue of (MAC, device_info_t) assignments in flash, a few at a
+// time, one master advert per cycle. An assignment is retired only when the target's own
+// advert shows the new configuration.
+#define PROVISION_QUEUE_MAX 256 // Queue entries considered, one "confirmed" bit each
+#define PROVISION_SLOTS 4 // Assignments in progress (mode_provisioner_state_t)
+#define PROVISION_RETRY_CYCLES 3 // Cycles to wait for the confirmation after the first master advert
+#define PROVISION_MAX_BACKOFF 24 // Wait cap in cycles, it doubles with each unconfirmed attempt
+#define PROVISION_MAX_ATTEMPTS 5 // Then the slot goes to the next entry, this one waits for the next pass
+
+// Advertising intervals in 0.625ms units (same values as BT_GAP_ADV_*, kept here so the core builds without Zephyr)
+#define ADV_SLOW_INT_MIN 0x0640 // 1s
+#define ADV_SLOW_INT_MAX 0x0780 // 1.2s
+#define ADV_FAST_INT_MIN_2 0x00a0 // 100ms
+#define ADV_FAST_INT_MAX_2 0x00f0 // 150ms
+
+// Density-adaptive advertising: interval_min follows the neighborhood size, bounded and with hysteresis
+#define ADV_ADAPT_UNITS_PER_PEER 12 // 7.5ms of interval per neighbor: 128 peers -> 0x0600 (~1s)
+#define ADV_ADAPT_MIN_INT 0x0320 // 500ms, sparse halls advertise faster
+#define ADV_ADAPT_MAX_INT 0x0960 // 1.5s, still ~2 adverts per scan cycle
+#define ADV_ADAPT_SPAN 0x0140 // interval_max = interval_min + 200ms
+#define ADV_ADAPT_HYSTERESIS_SHIFT 3 // Only move when the target differs by more than 1/8
+#define ADV_SKETCH_BITS 256 // Distinct-sender bitmap per cycle, power of two (32 bytes)
+#define ADV_DENSITY_EWMA_SHIFT 2 // Density estimate follows 1/4 of each new sample
+#define ADV_SIGHTING_MIN_PEERS 8 // Established peers needed before the sighting rate is trusted
+#define ADV_SIGHTING_LOW_PCT 80 // Below this, back off by 1/8 (collisions suspected)
+#define ADV_SIGHTING_HIGH_PCT 95 // Above this, relax the back-off by 1/8
+#define ADV_SIGHTING_MAX_BACKOFF 4 // Back-off limit in eighths (+50%)
+
+// Scan profiles, interval/window in 0.625ms units (window == interval scans continuously)
+#define SCAN_FULL_INTERVAL 0x0030 // 30ms (BT_GAP_SCAN_FAST_INTERVAL_MIN)
+#define SCAN_FULL_WINDOW 0x0030 // 30ms, 100% duty: devices and overseers count every peer
+#define SCAN_LOW_INTERVAL 0x0090 // 90ms
+#define SCAN_LOW_WINDOW 0x0030 // 30ms, 33% duty: auras only need the occasional hostile beacon
+#define SCAN_IDLE_INTERVAL 0x0180 // 240ms
+#define SCAN_IDLE_WINDOW 0x0030 // 30ms, 12.5% duty: unconfigured devices only wait for a master
+#define SCAN_BURST_DURATION_MS 1200 // Level-up token: short full-duty cycles for quick hand-offs
+
 // --- Aura levels and stuff ---
 #define HOSTILE_AURAS_IDX 0 // Index for hostile auras in aura_level_count
 #define FRIENDLY_AURAS_IDX 1 // Index for Unity auras in aura_level_count
@@ -21,5 +21,8 @@
 #define ERROR_SCAN_START                   -7
 #define ERROR_LED_INIT                     -8
 #define ERROR_GPIO_NOT_READY               -9
+#define ERROR_CONFIG_WRITE                 -10
+#define ERROR_NVS_DELETE                   -11
+#define ERROR_STACK_LOW                    -12
 
 #endif /* ERRORS_H */
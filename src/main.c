@@ -16,11 +16,17 @@
  *   - mode/affinity/level/state packed in nibbles (4 bits each)
  *   - dynamic_rssi_threshold as signed byte (-128 to +127)
  * 
- * MASTER (12 bytes): [0xAB][0xAC][target_mac:6][device_info_t:4]
+ * MASTER (12-14 bytes): [0xAB][0xAC][target_mac:6][device_info_t:4][zone (optional)][group (optional)]
  *   - Used for remote device configuration
+ *   - Group variant (7-8 bytes): [0xAB][0xAD][group][device_info_t:4][zone (optional)]
  * 
- * OVERSEER (10 bytes): [0xDE][0xAD][state_data:8]
- *   - Broadcasts calculated states for all device levels/affinities
+ * OVERSEER V2 (5-11 bytes): [0xDE][0xAD][0xA0|zones] + [zone][states] per zone
+ *   - Calculated states for all device levels/affinities, one bit each
+ *   - Legacy 10-byte [0xDE][0xAD][state_data:8] is still decoded (zone 0)
+ *
+ * TELEMETRY (12-20 bytes): [0xD1][0xA9][version|mode] + counters, profile or provisioner progress
+ *   - Second manufacturer data structure, on air for one cycle on request
+ *     ([0xD1][0xA9][0x00][target_mac:6]) or every TELEMETRY_INTERVAL_CYCLES
  */
 
 #include <zephyr/types.h>
@@ -39,6 +45,11 @@
 #include <zephyr/sys/reboot.h>
 
 #include "LEDManager.h"
+#include "adv_ring.h"
+#include "config_store.h"
+#include "mesh_core.h"
+#include "platform.h"
+#include "profiler.h"
 #include "types.h"
 #include "defines.h"
 #include "errors.h"
@@ -56,23 +67,26 @@ static const struct pwm_dt_spec pwm_led_g = PWM_DT_SPEC_GET(PWM_LED_G_NODE);
 
 /******* Global Variables **************/
 
-// Persistent storage for device state
+// Persistent storage for device state: the CONFIG_STORE_PAGES config pages (config_store.h)
+// are the last pages of storage_partition, behind the NVS sectors that older firmware wrote to.
+// The pages in between hold the provisioner queue (host/provision_hex).
 static struct nvs_fs fs;
 const struct device *flash_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_flash_controller));
-
-// Peer discovery and management
-// Use a matrix for level counters: [hostile/friendly][level]
-static uint8_t aura_level_count[2][LEVELS_PER_AFFINITY] = {{0}};
-static peer_t peers[MAX_PEERS];
-static uint8_t peer_count = 0; // Number of discovered peers
-
+static off_t config_offset;
+static off_t provision_offset;
+static size_t provision_size;
+static int config_read(uint16_t offset, void *data, uint16_t len);
+static int config_write(uint16_t offset, const void *data, uint16_t len);
+static int config_erase(uint8_t page);
+static config_flash_t config_flash = {config_read, config_write, config_erase, 0};
 
 /* Custom advertising parameters */
 static bt_addr_le_t static_addr;
-static uint8_t adv_data[16]; // Buffer for dynamic advertisement data
 static struct bt_data dynamic_ad[] = {
-    BT_DATA(BT_DATA_MANUFACTURER_DATA, adv_data, MESH_ADV_LEN),
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, NULL, 0), // Points at mesh_core_adv() before each start
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, NULL, 0), // Telemetry, only while the core has some
 };
+static size_t dynamic_ad_count = 1;
 static struct bt_le_adv_param adv_params = {
     .options = BT_LE_ADV_OPT_USE_IDENTITY, 
     .interval_min = BT_GAP_ADV_SLOW_INT_MIN,
@@ -83,23 +97,53 @@ static struct bt_le_adv_param adv_params = {
 static struct bt_le_scan_param scan_param = {
     .type = BT_LE_SCAN_TYPE_PASSIVE,
     .options = BT_LE_SCAN_OPT_NONE,
-    .interval = BT_GAP_SCAN_FAST_INTERVAL_MIN,
+    .interval = BT_GAP_SCAN_FAST_INTERVAL_MIN, // Replaced by the mode's scan profile
     .window = BT_GAP_SCAN_FAST_WINDOW,
 };
 
-// Device information structures
-
-static mode_state_t mode_state;
-static bool mode_changed = false;
-device_info_t device_info = {
-    .mode = MODE_NONE,
-    .affinity = AFFINITY_UNITY,
-    .level = 0,
-    .dynamic_rssi_threshold = 0 // 0 = disabled, use default RSSI_THRESHOLD
-};
-
 // Global error tracking variable
 static int last_error = ERROR_SUCCESS;
+// Radio failures and late cycles, reported in telemetry adverts
+static uint16_t adv_start_failures;
+static uint16_t scan_start_failures;
+static uint16_t cycle_overruns;
+// Written by scan_cb only
+static uint32_t reports_received;
+static uint32_t reports_rssi_rejected;
+
+// Adverts are queued by scan_cb and decoded by adv_worker; the core is not
+// thread-safe, so the worker and the main loop serialize on core_lock.
+static K_MUTEX_DEFINE(core_lock);
+static K_SEM_DEFINE(adv_ready, 0, 1);
+
+static void cycle_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(cycle_work, cycle_handler);
+static struct k_work_sync cycle_sync;
+#if CONTINUOUS_SCAN
+static int eval_ticks; // Evaluations since the last end of cycle
+static int64_t eval_due_ms; // When the current evaluator tick was due
+#else
+// Cycle phases, run in order from cycle_work (see cycle_handler)
+enum cycle_phase {
+    CYCLE_ADV_START,
+    CYCLE_SCAN_START,
+    CYCLE_SCAN_STOP,
+    CYCLE_END,
+};
+static enum cycle_phase cycle_phase;
+static int scan_remaining_ms; // Scan time left in the current cycle
+static int scan_duration_ms = CYCLE_DURATION_MS; // Scan time per cycle for the current mode
+static int64_t cycle_start_ms; // When CYCLE_ADV_START of the current cycle ran
+static uint32_t prof_phase_mark; // Profiler: end of CYCLE_ADV_START, then scan start
+static bool prof_jitter_pending; // Profiler: the next CYCLE_SCAN_START ends the jitter
+#endif
+static uint32_t prof_cycle_mark; // Profiler: start of the current cycle (evaluator tick), 0 = first after start_cycle
+static K_SEM_DEFINE(mode_change_sem, 0, 1);
+
+// Advertisement currently on air, copied from the core so adv_worker can keep
+// updating the core's buffer while the controller reads this one
+static mesh_adv_t loaded_adv;
+static bool adv_running; // Advertising is on air with loaded_adv
 
 // LED Management (2 PWM LEDs for visual feedback)
 static struct led_entry led_array[3] = {
@@ -108,1019 +152,494 @@ static struct led_entry led_array[3] = {
     { .state = LED_OFF, .pwm = &pwm_led_g }
 };
 
-// Direct output pin control (active high)
-static void set_output_pin(bool state) {
-    gpio_pin_set_dt(&pinOut, state);
-}  
-
 /******* Functions Declarations **************/
-// --- Hash Table Functions ---
-static uint8_t hash_mac(const uint8_t *mac);
-static void count_peer(const uint8_t *mac, device_info_t *peer_info);
-static bool peer_exists(const uint8_t *mac);
-static void clear_peer_table(void);
-static void age_peers(void);
-static void age_overseer(void);
-static void track_overseer(void);
-static bool is_peer_valid_for_calculation(const peer_t *peer);
-static void count_stable_peers_for_calculations(void);
-
-// --- Utility and Helper Functions ---
-static void prepare_mesh_adv_data(uint8_t state);
-static void prepare_aura_mesh_adv_data(uint8_t state);
-static void prepare_overseer_adv_data(void);
-static bool check_dynamic_rssi_threshold(int8_t rssi);
-
-static void count_stable_peers_for_calculations(void);
-static void count_stable_peers_for_overseer_calculations(void);
-static uint8_t split_unity_level(uint8_t level, affinity_t target_affinity);
-#define TO_UNITY_LEVEL(magic_level, techno_level) \
-    ((magic_level << 4) | (techno_level & 0x0F))
-
-// --- Mode-specific initialization function declarations ---
-static void init_mode_aura(void);
-static void init_mode_device(void);
-static void init_mode_lvlup_token(void);
-static void init_mode_overseer(void);
-static void init_mode_none(void);
-
-// --- BLE Advertisement/Scan Handlers ---
-static void handle_master_adv(const bt_addr_le_t *addr, const uint8_t *target_mac, uint8_t mode, uint8_t affinity, uint8_t level, int8_t dynamic_threshold, int8_t rssi);
-static void handle_zephyr_device(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi);
-static void handle_zephyr_aura(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi);
-static void handle_zephyr_none(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi);
-static void handle_zephyr_lvlup_token(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi);
-static void handle_zephyr_overseer(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi);
-static void handle_overseer_adv(const bt_addr_le_t *addr, const uint8_t *data, int8_t rssi);
-
-// --- End-of-Cycle Handlers ---
-static void end_of_cycle_aura(void);
-static void end_of_cycle_device(void);
-static void end_of_cycle_lvlup_token(void);
-static void end_of_cycle_overseer(void);
-static void end_of_cycle_none(void);
-
-// --- Mode/State Management ---
-static void set_mode(operation_mode_t mode);
 
 // --- BLE/Flash Initialization ---
 static int init_flash(void);
 static void system_restart(void);
 
-// --- Main Loop and Entry Point ---
+// --- Cycle Scheduler, Main Loop and Entry Point ---
+static void refresh_adv(void);
+static void stop_cycle(void);
+static void start_cycle(void);
 static void main_loop(void);
 int main(void);
 
-// --- BLE Scan Callback ---
+// --- BLE Scan Callback and advert worker ---
 static void scan_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t adv_type, struct net_buf_simple *buf);
+static void drain_adv_ring(int max_records);
+static void adv_worker(void *p1, void *p2, void *p3);
+extern const k_tid_t adv_worker_tid; // K_THREAD_DEFINE below
 
 /******* End Functions Declarations **************/
 
+// --- Platform shim used by the core (see platform.h) ---
 
-// Function pointer types for mode-specific handlers
-// Update zephyr_adv_handler_t typedef to include rssi
-typedef void (*zephyr_adv_handler_t)(const bt_addr_le_t *, device_info_t*, uint8_t, int8_t);
-typedef void (*end_of_cycle_handler_t)(void);
-
-// Function pointers for current mode
-static zephyr_adv_handler_t current_zephyr_handler = handle_zephyr_none;
-static end_of_cycle_handler_t current_end_of_cycle = end_of_cycle_none;
-
-// --- Hash Table Implementation ---
+// Direct output pin control (active high)
+void platform_set_output_pin(bool state) {
+    gpio_pin_set_dt(&pinOut, state);
+}
 
-// XOR + shift hash function optimized for nRF51822
-static uint8_t hash_mac(const uint8_t *mac) {
-    uint8_t hash = 0;
-    for (int i = 0; i < MAC_LEN; i++) {
-        hash ^= mac[i];
-        hash = (hash << 1) | (hash >> 7); // Rotate left by 1
-    }
-    return hash; // Use full 8-bit range for 256 slots
+void platform_set_led_state(int led_idx, enum led_state state) {
+    set_led_state(led_idx, state);
 }
 
-// Count peer and store its information into the hash table
-// This function is called by the zephyr handlers to count unique peers and store their information
-static void count_peer(const uint8_t *mac, device_info_t *peer_info) {
-    if (peer_count >= MAX_PEERS) {
-        return; // Peer table is full, ignore this advertisement
-    }
-    uint8_t slot = hash_mac(mac);
-    uint8_t original_slot = slot;
-    uint8_t first_deleted = MAX_PEERS;
-    
-    do {
-        if (peers[slot].state == PEER_SLOT_EMPTY) {
-            // Use empty slot or first deleted slot if available
-            uint8_t target_slot = (first_deleted < MAX_PEERS) ? first_deleted : slot;
-            peers[target_slot].state = PEER_SLOT_OCCUPIED;
-            memcpy(peers[target_slot].mac, mac, MAC_LEN);
-            peers[target_slot].affinity = peer_info->affinity;
-            peers[target_slot].level = peer_info->level;
-            peers[target_slot].stability_counter = 1; // First detection
-            peers[target_slot].detected_this_cycle = 1;
-            peers[target_slot].is_established = 0; // Not yet established
-            peers[target_slot].reserved = 0;
-            peer_count++;
-            return;
-        }
-        
-        if (peers[slot].state == PEER_SLOT_DELETED && first_deleted == MAX_PEERS) {
-            first_deleted = slot; // Remember first deleted slot
-        }
-        
-        if (peers[slot].state == PEER_SLOT_OCCUPIED &&
-            memcmp(peers[slot].mac, mac, MAC_LEN) == 0) {
-            // Update existing peer - only if not already detected this cycle
-            if (!peers[slot].detected_this_cycle) {
-                peers[slot].affinity = peer_info->affinity;
-                peers[slot].level = peer_info->level;
-                peers[slot].detected_this_cycle = 1; // Mark as detected this cycle
-            }
-            return;
-        }
-        
-        // Linear probing with prime step
-        slot = (slot + HASH_PROBE_STEP) % MAX_PEERS;
-    } while (slot != original_slot);
+// Blink for STARTUP_DELAY_MS over the LED states the new mode sets, the cycle keeps running
+void platform_mode_transition(void) {
+    play_led_overlay(BIT(RED_LED_PIN) | BIT(GREEN_LED_PIN), LED_BLINK_FAST, STARTUP_DELAY_MS);
 }
 
-// Check if a peer exists in the hash table
-static bool peer_exists(const uint8_t *mac) {
-    uint8_t slot = hash_mac(mac);
-    uint8_t original_slot = slot;
-    
-    do {
-        if (peers[slot].state == PEER_SLOT_EMPTY) {
-            return false; // Not found
-        }
-        
-        if (peers[slot].state == PEER_SLOT_OCCUPIED &&
-            memcmp(peers[slot].mac, mac, MAC_LEN) == 0) {
-            return true; // Found
-        }
-        
-        // Continue probing through deleted slots
-        slot = (slot + HASH_PROBE_STEP) % MAX_PEERS;
-    } while (slot != original_slot);
-    
-    return false; // Not found
+// Wake the main thread to apply a mode change received mid-cycle
+void platform_request_mode_change(void) {
+    k_sem_give(&mode_change_sem);
 }
 
-// Clear the entire peer table
-static void clear_peer_table(void) {
-    for (int i = 0; i < MAX_PEERS; i++) {
-        peers[i].state = PEER_SLOT_EMPTY;
-        peers[i].stability_counter = 0;
-        peers[i].detected_this_cycle = 0;
-        peers[i].is_established = 0;
-        peers[i].reserved = 0;
-    }
-    peer_count = 0;
+// Only queued here: main_loop writes it while the radio is stopped, so a flash
+// erase never stalls the worker or the cycle and repeats of a master advert coalesce
+void platform_store_device_info(const device_info_t *info) {
+    config_store_request(info);
 }
 
-// Age peers based on detection flags and update stability counters
-static void age_peers(void) {
-    for (int i = 0; i < MAX_PEERS; i++) {
-        if (peers[i].state == PEER_SLOT_OCCUPIED) {
-            if (peers[i].detected_this_cycle) {
-                // Peer was detected this cycle
-                if (peers[i].stability_counter < 0) {
-                    peers[i].stability_counter = 1; // Reset to first detection after misses
-                } else if (peers[i].stability_counter < PEER_DETECTION_THRESHOLD) {
-                    peers[i].stability_counter++; // Increment consecutive detections
-                    
-                    // Mark as established once threshold is reached
-                    if (peers[i].stability_counter >= PEER_DETECTION_THRESHOLD) {
-                        peers[i].is_established = 1;
-                    }
-                }
-                peers[i].detected_this_cycle = 0; // Reset flag for next cycle
-            } else {
-                // Peer was not detected this cycle
-                if (peers[i].stability_counter > 0) {
-                    peers[i].stability_counter = -1; // Reset to first miss after detections
-                } else {
-                    peers[i].stability_counter--; // Increment consecutive misses (negative)
-                }
-                
-                // Remove peer if missed for PEER_MISS_THRESHOLD consecutive cycles
-                if (peers[i].stability_counter <= -PEER_MISS_THRESHOLD) {
-                    peers[i].state = PEER_SLOT_DELETED;
-                    peer_count--;
-                }
-            }
-        }
+bool platform_read_provision_record(uint16_t index, uint8_t *record) {
+    off_t offset = (off_t)index * PROVISION_RECORD_LEN;
+    if (offset + PROVISION_RECORD_LEN > (off_t)provision_size) {
+        return false;
     }
+    return flash_read(flash_dev, provision_offset + offset, record, PROVISION_RECORD_LEN) == 0;
 }
 
-// Check if peer should be included in calculations
-// Peer is valid once it has been established (reached PEER_DETECTION_THRESHOLD)
-static bool is_peer_valid_for_calculation(const peer_t *peer) {
-    return (peer->state == PEER_SLOT_OCCUPIED && peer->is_established);
+// Flag a worker stack that came within ADV_WORKER_STACK_LOW bytes of its end. The
+// unused space is the part still holding the CONFIG_INIT_STACKS fill pattern, so it
+// is the low watermark since boot, checked whenever a telemetry advert is built.
+// Only in stack_report.conf builds, which enable both options.
+static void check_worker_stack(void) {
+#if defined(CONFIG_THREAD_STACK_INFO) && defined(CONFIG_INIT_STACKS)
+    size_t unused;
+    if (k_thread_stack_space_get(adv_worker_tid, &unused) == 0 && unused < ADV_WORKER_STACK_LOW) {
+        last_error = ERROR_STACK_LOW;
+    }
+#endif
 }
 
-// --- End Hash Table Implementation ---
-
-// Helper function to check if RSSI passes dynamic threshold for device mode
-static bool check_dynamic_rssi_threshold(int8_t rssi) {
-    // If dynamic threshold is 0, it's disabled - use default behavior
-    if (device_info.dynamic_rssi_threshold == 0) {
-        return true; // Dynamic threshold disabled
-    }
-    
-    // Apply dynamic threshold
-    return rssi >= device_info.dynamic_rssi_threshold;
+void platform_get_telemetry(platform_telemetry_t *telemetry) {
+    check_worker_stack();
+    telemetry->uptime_s = (uint32_t)(k_uptime_get() / MSEC_PER_SEC);
+    telemetry->reports_received = reports_received;
+    telemetry->reports_rssi_rejected = reports_rssi_rejected;
+    telemetry->adv_start_failures = adv_start_failures;
+    telemetry->scan_start_failures = scan_start_failures;
+    telemetry->cycle_overruns = cycle_overruns;
+    telemetry->last_error = (int8_t)last_error;
 }
 
-// Split unity level into magic and techno components
-// For Unity, it returns the biggest part
-static uint8_t split_unity_level(uint8_t level, affinity_t target_affinity) {
-    switch (target_affinity)
-    {
-    case AFFINITY_MAGIC:
-        return (level >> 4) & 0x0F;
-    case AFFINITY_TECHNO:
-        return level & 0x0F;
-    case AFFINITY_UNITY:
-    default:
-        break;
-    }
-    uint8_t magic_level = (level >> 4) & 0x0F; // Magic part
-    uint8_t techno_level = level & 0x0F; // Techno part
-    return magic_level > techno_level ? magic_level : techno_level;
+uint32_t platform_cycles(void) {
+    return k_cycle_get_32(); // nRF51: the 32.768 kHz RTC, the Cortex-M0 has no cycle counter
 }
 
-// --- MODE_AURA handlers ---
-static void init_mode_aura(void) {
-    memset(&mode_state, 0, sizeof(mode_state));
-    mode_state.aura.is_active = 1; // Example: set aura as active by default
-    // Set other aura state fields as needed
-
-    prepare_aura_mesh_adv_data(mode_state.aura.is_active);
-    set_led_state(GREEN_LED_PIN, LED_ON); // Set LEDs to ON initially
-    set_led_state(RED_LED_PIN, LED_OFF); // Set problem LED off initially
-    // Use slower intervals for high peer density environments
-    adv_params.interval_min = BT_GAP_ADV_SLOW_INT_MIN;
-    adv_params.interval_max = BT_GAP_ADV_SLOW_INT_MAX;
+uint32_t platform_cycles_per_sec(void) {
+    return sys_clock_hw_cycles_per_sec();
 }
 
-static void handle_zephyr_aura(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi) {
-    // Only process peers advertising MODE_AURA
-    if (peer_info->mode != MODE_AURA || ! state) {
-        return; // Only interested in AURA mode
-    }
-    if (unlikely(peer_info->level == HOSTILE_ENVIRONMENT_LEVEL &&
-        peer_info->affinity != device_info.affinity && 
-        device_info.affinity != AFFINITY_UNITY)) {
-        mode_state.aura.is_in_hostile_environment = 1;
-        return;
+// Record the cycle (or evaluator) period, once a previous start is known
+static void prof_cycle(void)
+{
+    uint32_t now = prof_start();
+    if (prof_cycle_mark) {
+        prof_record(PROF_CYCLE, now - prof_cycle_mark);
     }
+    prof_cycle_mark = now | 1; // Never 0 while running
 }
 
-static void end_of_cycle_aura(void) {
-    if (mode_state.aura.is_in_hostile_environment) {
-        if ( mode_state.aura.hostility_counter < HOSTILE_ENVIRONMENT_TRESHOLD ) {
-            // If in hostile environment, increase hostility counter
-            mode_state.aura.hostility_counter++;
-            set_led_state(GREEN_LED_PIN, mode_state.aura.is_active);
-            set_led_state(RED_LED_PIN, mode_state.aura.is_active ? LED_BLINK_ONCE : LED_ON);
-        }
-        // Aura mode: check if hostility counter is high, if so, blink LEDs
-        if (mode_state.aura.hostility_counter >= HOSTILE_ENVIRONMENT_TRESHOLD) {
-            // Blink LEDs to indicate active aura mode
-            set_led_state(GREEN_LED_PIN, LED_OFF);
-            set_led_state(RED_LED_PIN, LED_ON);
-            mode_state.aura.is_active = 0; // Disable aura
-            prepare_aura_mesh_adv_data(mode_state.aura.is_active);
-        }
-        mode_state.aura.is_in_hostile_environment = 0; // Reset hostile environment state
-    } else if (mode_state.aura.hostility_counter > 0) {
-        mode_state.aura.hostility_counter--;
-        // If hostility counter is zero, SET LEDs back to ON
-        if (mode_state.aura.hostility_counter == 0) {
-            set_led_state(GREEN_LED_PIN, LED_ON);
-            set_led_state(RED_LED_PIN, LED_OFF);
-            mode_state.aura.is_active = 1; // Enable aura
-            prepare_aura_mesh_adv_data(mode_state.aura.is_active);
-        } else {
-            set_led_state(GREEN_LED_PIN, LED_BLINK_ONCE);
-            set_led_state(RED_LED_PIN, LED_ON);
+// Runs in the BT RX path: only the RSSI gate and the in-place adv_parse() happen here,
+// decoding and peer table work is deferred to adv_worker
+static void scan_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t adv_type,
+                    struct net_buf_simple *buf)
+{
+    uint32_t prof = prof_start();
+    uint8_t payload_len;
+    const uint8_t *payload = mesh_core_find_payload(rssi, buf->data, buf->len, &payload_len);
+    reports_received++;
+    if (!payload) {
+        // Not a mesh advertisement
+        if (rssi < RSSI_SCAN_GATE) {
+            reports_rssi_rejected++; // Counted here so the gate itself stays a single compare
         }
+    } else if (adv_ring_push(addr->a.val, rssi, payload, payload_len)) {
+        k_sem_give(&adv_ready);
     }
+    prof_stop(PROF_SCAN_CB, prof);
 }
 
-// --- MODE_DEVICE handlers ---
-static void init_mode_device(void) {
-    memset(&mode_state, 0, sizeof(mode_state));
-    mode_state.device.is_on = device_info.level ? 0 : 1; // Example: device starts off
-    // Clear overseer tracking
-    memset(mode_state.device.overseer_mac, 0, MAC_LEN);
-    mode_state.device.overseer_rssi = -127; // Minimum RSSI
-    mode_state.device.overseer_stability_counter = 0;
-    mode_state.device.overseer_detected_this_cycle = 0;
-    mode_state.device.overseer_state = 0;
-    mode_state.device.use_overseer = 0;
-
-    set_led_state(GREEN_LED_PIN, 
-        mode_state.device.is_on ? LED_ON : LED_BLINK_ONCE);
-    set_output_pin(mode_state.device.is_on);
-
-    prepare_mesh_adv_data(mode_state.device.is_on);
-    adv_params.interval_min = BT_GAP_ADV_SLOW_INT_MIN;
-    adv_params.interval_max = BT_GAP_ADV_SLOW_INT_MAX;
-}
-
-static void handle_zephyr_device(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi){
-    // Only process peers advertising MODE_AURA
-    if (peer_info->mode != MODE_AURA || ! state ) {
-        return; // Only interested in AURA mode
-    }
-
-    // Apply dynamic RSSI threshold if enabled
-    if (!check_dynamic_rssi_threshold(rssi)) {
-        return; // Signal too weak according to dynamic threshold
+// Process up to max_records queued adverts, caller must hold core_lock
+static void drain_adv_ring(int max_records)
+{
+    adv_record_t record;
+    while (max_records-- > 0 && adv_ring_pop(&record)) {
+        mesh_core_process_payload(record.mac, record.rssi, record.data, record.len);
     }
-
-    count_peer(addr->a.val, peer_info);
 }
 
-static void age_overseer()
+static void adv_worker(void *p1, void *p2, void *p3)
 {
-    if (mode_state.device.overseer_stability_counter > 0)
-    {
-        mode_state.device.overseer_stability_counter = -1; // Reset to first miss
-    }
-    else
-    {
-        mode_state.device.overseer_stability_counter--; // Increment consecutive misses
-    }
-
-    // Stop using overseer if missed for too long
-    if (mode_state.device.overseer_stability_counter <= -OVERSEER_MISS_THRESHOLD)
-    {
-        mode_state.device.use_overseer = 0;
-        memset(mode_state.device.tracked_mac, 0, MAC_LEN);
-        mode_state.device.overseer_rssi = -127;
+    while (1) {
+        k_sem_take(&adv_ready, K_FOREVER);
+        while (adv_ring_count() > 0) {
+            k_mutex_lock(&core_lock, K_FOREVER);
+            drain_adv_ring(ADV_WORKER_BATCH);
+            k_mutex_unlock(&core_lock);
+            k_yield();
+        }
     }
 }
 
-static void track_overseer() {
-    // Age overseer tracking
-    if ( ! mode_state.device.overseer_detected_this_cycle) {
-        age_overseer();
-        return; // Overseer was not detected this cycle
-    }
-    // Overseer was detected this cycle
-    mode_state.device.overseer_detected_this_cycle = 0; // Reset flag
-    if ( ! mode_state.device.use_overseer ) {
-        // If overseer is not used, we track the strongest one
-        memcpy(mode_state.device.tracked_mac, mode_state.device.overseer_mac, MAC_LEN);
-        mode_state.device.overseer_stability_counter = 1; // Set to first detection
-        return;
-    }
+K_THREAD_DEFINE(adv_worker_tid, ADV_WORKER_STACK_SIZE, adv_worker, NULL, NULL, NULL,
+                ADV_WORKER_PRIORITY, 0, 0);
 
+// Copy the advertisement requested by the core into the Zephyr structures
+// (caller must hold core_lock)
+static void load_adv(void)
+{
+    loaded_adv = *mesh_core_adv();
 
-    if ( ! memcmp(mode_state.device.overseer_mac, mode_state.device.tracked_mac, MAC_LEN) ) {
-        // If overseer is our tracked one, update stability counter
-        if (mode_state.device.overseer_stability_counter < 0) {
-            mode_state.device.overseer_stability_counter = 1; // Reset to first detection
-        } else if (mode_state.device.overseer_stability_counter < OVERSEER_DETECTION_THRESHOLD) {
-            mode_state.device.overseer_stability_counter++; // Increment consecutive detections
-            
-            // Start using overseer once threshold is reached
-            if (mode_state.device.overseer_stability_counter >= OVERSEER_DETECTION_THRESHOLD) {
-                mode_state.device.use_overseer = 1;
-                memcpy(mode_state.device.tracked_mac, mode_state.device.overseer_mac, MAC_LEN);
-            }
-        }
-        return; 
-    }
-    // If overseer is not our tracked one, age it
-    age_overseer();
-    // If not tracking overseer after aging, start tracking the new one
-    if ( ! mode_state.device.use_overseer ) {
-        memcpy(mode_state.device.tracked_mac, mode_state.device.overseer_mac, MAC_LEN);
-        mode_state.device.overseer_stability_counter = 1; // Set to first detection
-    }
-      
+    dynamic_ad[0].data = loaded_adv.data;
+    dynamic_ad[0].data_len = loaded_adv.len;
+    dynamic_ad[1].data = loaded_adv.telemetry;
+    dynamic_ad[1].data_len = loaded_adv.telemetry_len;
+    dynamic_ad_count = loaded_adv.telemetry_len ? 2 : 1;
+    adv_params.interval_min = loaded_adv.interval_min;
+    adv_params.interval_max = loaded_adv.interval_max;
 }
 
-static void end_of_cycle_device(void) {
-    // Age all peers (increment miss counters, remove old peers)
-    age_peers();
-    
-    track_overseer();
-    
-    uint8_t new_device_state;
-    uint8_t is_suppressed = 0;
-    
-    if (mode_state.device.use_overseer) {
-        // Use overseer-commanded state
-        new_device_state = mode_state.device.overseer_state;
-    } else {
-        // Count only stable peers (detected 3+ consecutive times) for calculations
-        count_stable_peers_for_calculations();
-        
-        // Count max level and number of peers at max level for each affinity
-        new_device_state = device_info.level ? 0 : 1; // Default to OFF except if level is 0
-        for ( int level = HOSTILE_ENVIRONMENT_LEVEL ; level >= device_info.level; --level ) {
-            if (aura_level_count[HOSTILE_AURAS_IDX][level] == 0 &&
-                aura_level_count[FRIENDLY_AURAS_IDX][level] == 0) {
-                continue; // No peers at this level, skip
-            }
-            // Check if there more or equal friendly auras than hostile auras at this level
-            if (aura_level_count[FRIENDLY_AURAS_IDX][level] >= aura_level_count[HOSTILE_AURAS_IDX][level]) {
-                // If friendly auras are equal or more than hostile, keep device ON
-                new_device_state = 1;
-                break; // Found a level where device can stay ON
-            } else {
-                // If hostile auras are more, turn device OFF
-                new_device_state = 0;
-                is_suppressed = 1;
-                break;
-            }
-        }
-    }
+// Copy the scan settings requested by the core into the Zephyr structures
+// (caller must hold core_lock)
+static void load_scan(void)
+{
+    const mesh_scan_t *scan = mesh_core_scan();
 
-    if (new_device_state != mode_state.device.is_on) {
-        mode_state.device.is_on = new_device_state;
-        set_led_state(GREEN_LED_PIN, 
-            mode_state.device.is_on ? LED_ON : LED_BLINK_ONCE);
-        set_output_pin(mode_state.device.is_on);
-        if ( is_suppressed ) {
-            set_led_state(RED_LED_PIN, LED_ON); // Indicate suppression
-        } else {
-            set_led_state(RED_LED_PIN, LED_OFF); // No suppression
-        }
-        prepare_mesh_adv_data(mode_state.device.is_on);
-    }    
+    scan_param.options = scan->filter_duplicates ? BT_LE_SCAN_OPT_FILTER_DUPLICATE : BT_LE_SCAN_OPT_NONE;
+    scan_param.interval = scan->interval;
+    scan_param.window = scan->window;
+#if !CONTINUOUS_SCAN
+    scan_duration_ms = scan->duration_ms;
+#endif
 }
 
-// --- MODE_LVLUP_TOKEN handlers ---
-static void init_mode_lvlup_token(void) {
-    memset(&mode_state, 0, sizeof(mode_state));
-    // Set lvlup_token state fields as needed
-
-    prepare_mesh_adv_data(1);
-    adv_params.interval_min = BT_GAP_ADV_SLOW_INT_MIN;
-    adv_params.interval_max = BT_GAP_ADV_SLOW_INT_MAX;
-    // indicate that the level-up token is in "charged" state
-    set_led_state(GREEN_LED_PIN, LED_ON);
+// Trigger system restart (similar to power cycle)
+static void system_restart(void)
+{
+    sys_reboot(SYS_REBOOT_COLD); // Cold reset - most similar to power cycle
 }
 
-static void handle_zephyr_lvlup_token(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi) {
-    if ( rssi < LVLUP_TOKEN_RSSI_THRESHOLD) {
-        return; // Ignore weak signals
-    }
-    if ( peer_count > 0 ) {
-        return; // Already found a peer, ignore this advertisement
-    }
-    // Only process peers advertising MODE_AURA
-    if (peer_info->mode != MODE_AURA) {
-        return;
-    }
-
-    if (device_info.affinity == AFFINITY_UNITY && 
-        peer_info->affinity != AFFINITY_UNITY) {
-        // Convert the peer affinity to Unity
-        mode_state.lvlup_token.device_info.affinity = AFFINITY_UNITY;
-        mode_state.lvlup_token.device_info.mode = MODE_AURA;
-        mode_state.lvlup_token.device_info.dynamic_rssi_threshold = 0; // Default: no dynamic threshold
-        if (peer_info->level == HOSTILE_ENVIRONMENT_LEVEL ) {
-            // Unity token cannot be hostile - set to max friendly level
-            peer_info->level = HOSTILE_ENVIRONMENT_LEVEL - 1 ;
-        }
-        if (peer_info->affinity == AFFINITY_MAGIC) {
-            mode_state.lvlup_token.device_info.level = TO_UNITY_LEVEL(peer_info->level, 0);
-        } else if (peer_info->affinity == AFFINITY_TECHNO) {
-            mode_state.lvlup_token.device_info.level = TO_UNITY_LEVEL(0, peer_info->level);
+// Put the core's advertisement on air: the payload is updated in place while
+// advertising keeps running, only a change of interval needs a stop/start
+static void refresh_adv(void)
+{
+    int err = 0;
+
+    k_mutex_lock(&core_lock, K_FOREVER);
+    const mesh_adv_t *adv = mesh_core_adv();
+    bool params_changed = !adv_running ||
+        adv->interval_min != loaded_adv.interval_min ||
+        adv->interval_max != loaded_adv.interval_max;
+    bool data_changed = adv->len != loaded_adv.len ||
+        memcmp(adv->data, loaded_adv.data, adv->len) != 0 ||
+        adv->telemetry_len != loaded_adv.telemetry_len ||
+        memcmp(adv->telemetry, loaded_adv.telemetry, adv->telemetry_len) != 0;
+    if (params_changed || data_changed) {
+        load_adv();
+    }
+    k_mutex_unlock(&core_lock);
+
+    if (params_changed) {
+        if (adv_running) {
+            bt_le_adv_stop();
         }
-        // Save the peer's MAC address and set countdown
-        memcpy(mode_state.lvlup_token.mac, addr->a.val, MAC_LEN);
-        peer_count = 1; // Mark that we found a peer
-        mode_state.lvlup_token.broadcast_countdown = LVLUP_TOKEN_BROADCAST_COUNTDOWN;
-        return;
-    }
-
-    uint8_t current_level = peer_info->level;
-    if ( peer_info->affinity == AFFINITY_UNITY ) {
-        current_level = split_unity_level(peer_info->level, device_info.affinity);
-    } else if ( peer_info->affinity != device_info.affinity ) {
-        // If peer's affinity is not friendly, ignore it
-        return;
+        err = bt_le_adv_start(&adv_params, dynamic_ad, dynamic_ad_count, NULL, 0);
+        adv_running = (err == 0);
+    } else if (data_changed) {
+        err = bt_le_adv_update_data(dynamic_ad, dynamic_ad_count, NULL, 0);
     }
-
-    // Check if level is less by 1 and affinity matches
-    if (current_level != device_info.level - 1) {
-        return; // Not valid to get a level-up
-    }
-
-    // Save the peer's MAC address and set countdown
-    memcpy(mode_state.lvlup_token.mac, addr->a.val, MAC_LEN);
-    peer_count = 1; // Mark that we found a peer
-    mode_state.lvlup_token.broadcast_countdown = LVLUP_TOKEN_BROADCAST_COUNTDOWN;
-
-    if ( peer_info->affinity == AFFINITY_UNITY ) {
-        mode_state.lvlup_token.device_info.affinity = AFFINITY_UNITY;
-        mode_state.lvlup_token.device_info.mode = MODE_AURA;
-        mode_state.lvlup_token.device_info.dynamic_rssi_threshold = 0; // Default: no dynamic threshold
-        if (device_info.affinity == AFFINITY_MAGIC) {
-            mode_state.lvlup_token.device_info.level 
-                = TO_UNITY_LEVEL(device_info.level, split_unity_level(peer_info->level, AFFINITY_TECHNO));
-        } else if (device_info.affinity == AFFINITY_TECHNO) {
-            mode_state.lvlup_token.device_info.level 
-                = TO_UNITY_LEVEL(split_unity_level(peer_info->level, AFFINITY_MAGIC), device_info.level);
-        }
-    } else {
-        // If the peer's affinity is not Unity, keep the same affinity
-        mode_state.lvlup_token.device_info.affinity = peer_info->affinity;
-        mode_state.lvlup_token.device_info.mode = MODE_AURA;
-        mode_state.lvlup_token.device_info.level = device_info.level; // Give level-up to the target token
-        mode_state.lvlup_token.device_info.dynamic_rssi_threshold = 0; // Default: no dynamic threshold
+    if (err) {
+        last_error = ERROR_ADV_START;
+        adv_start_failures++;
     }
-
 }
 
-static void end_of_cycle_lvlup_token(void) {
-    if ( peer_count == 0 || mode_state.lvlup_token.broadcast_countdown == 0 ) {
-        return; // No peers to process
-    }
+#if CONTINUOUS_SCAN
+// --- Continuous scanning ---
+// Scanning and advertising start once per mode and never stop. cycle_work runs the
+// evaluator every PEER_EVAL_INTERVAL_MS (peer aging, device decision) and the mode's
+// end of cycle every PEER_CYCLE_TICKS evaluations.
+static void cycle_handler(struct k_work *work)
+{
+    int err;
+    bool end_of_cycle = ++eval_ticks >= PEER_CYCLE_TICKS;
+    int64_t now = k_uptime_get();
 
-    if ( mode_state.lvlup_token.broadcast_countdown == 3 ) {
-        adv_data[0] = 0xAB;
-        adv_data[1] = 0xAC;
-        memcpy(&adv_data[2], mode_state.lvlup_token.mac, MAC_LEN); // Copy target MAC
-        memcpy(&adv_data[2 + MAC_LEN], &mode_state.lvlup_token.device_info, sizeof(device_info_t)); // Copy device info
-        dynamic_ad[0].data_len = MASTER_ADV_LEN; // Set data length for dynamic advertisement
-        // Blink LEDs indicate broadcast
-        set_led_state(GREEN_LED_PIN, LED_BLINK_FAST);
-        adv_params.interval_min = BT_GAP_ADV_FAST_INT_MIN_2;
-        adv_params.interval_max = BT_GAP_ADV_FAST_INT_MAX_2;
-    } else if ( mode_state.lvlup_token.broadcast_countdown == 1 ) {
-        
-        // broadcast device state and after that the MAC the tocken we gave level-up to
-        if (device_info.level == 1) {
-            prepare_mesh_adv_data(1); // Set state to 1 (active), lvl 1 tokens do not expire
-            set_led_state(GREEN_LED_PIN, LED_ON);
-            peer_count = 0; // Reset peer count after broadcasting
-        } else {
-            // For other levels, prepare as used
-            prepare_mesh_adv_data(0); // Set state to 0 (used)
-            // indicate that the level-up token is in "discharged" state
-            set_led_state(GREEN_LED_PIN, LED_OFF);
-            set_led_state(RED_LED_PIN, LED_BLINK_ONCE);
-        }
-        memcpy(adv_data + MESH_ADV_LEN, mode_state.lvlup_token.mac, MAC_LEN); // Copy target MAC
-        dynamic_ad[0].data_len = MESH_ADV_LEN + MAC_LEN; // Set data length for dynamic advertisement
-        adv_params.interval_min = BT_GAP_ADV_SLOW_INT_MIN;
-        adv_params.interval_max = BT_GAP_ADV_SLOW_INT_MAX;
-    } else {
-        mode_state.lvlup_token.broadcast_countdown--;
+    prof_cycle();
+    if (now - eval_due_ms >= CYCLE_OVERRUN_SLACK_MS) {
+        cycle_overruns++;
     }
-}
+    eval_due_ms = now + PEER_EVAL_INTERVAL_MS;
 
-// --- MODE_OVERSEER handlers ---
-static void init_mode_overseer(void) {
-    memset(&mode_state, 0, sizeof(mode_state));
-    mode_state.overseer.broadcast_countdown = OVERSEER_BROADCAST_COUNTDOWN;
-    // Overseer needs to see all auras as neutral to count them properly
-    // Keep original level and affinity for proper peer classification
-    
-    prepare_overseer_adv_data();
-    set_led_state(GREEN_LED_PIN, LED_BLINK_ONCE);
-    adv_params.interval_min = BT_GAP_ADV_SLOW_INT_MIN;
-    adv_params.interval_max = BT_GAP_ADV_SLOW_INT_MAX;
-}
-
-static void handle_zephyr_overseer(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi) {
-    // Only process peers advertising MODE_AURA
-    if (peer_info->mode != MODE_AURA || !state) {
-        return; // Only interested in active AURA mode
+    k_mutex_lock(&core_lock, K_FOREVER);
+    mesh_core_evaluate();
+    if (end_of_cycle) {
+        eval_ticks = 0;
+        mesh_core_end_of_cycle();
     }
+    k_mutex_unlock(&core_lock);
 
-    count_peer(addr->a.val, peer_info);
-}
-
-static void end_of_cycle_overseer(void) {
-    // Age all peers (increment miss counters, remove old peers)
-    age_peers();
-    
-    // Note: Peer counting for overseer calculations is done within prepare_overseer_adv_data()
-    // for each affinity perspective separately
-    
-    if (mode_state.overseer.broadcast_countdown > 0) {
-        mode_state.overseer.broadcast_countdown--;
-        if (mode_state.overseer.broadcast_countdown == 0) {
-            // Reset countdown for next cycle
-            mode_state.overseer.broadcast_countdown = OVERSEER_BROADCAST_COUNTDOWN;
-            
-            // Prepare overseer advertisement data
-            prepare_overseer_adv_data();
+    refresh_adv(); // Push state changes on air right away
+    if (end_of_cycle && (scan_param.options & BT_LE_SCAN_OPT_FILTER_DUPLICATE)) {
+        // Scan enable resets the controller duplicate filter, back to back with the stop
+        bt_le_scan_stop();
+        err = bt_le_scan_start(&scan_param, scan_cb);
+        if (err) {
+            last_error = ERROR_SCAN_START;
+            scan_start_failures++;
         }
     }
+    k_work_schedule(&cycle_work, K_MSEC(PEER_EVAL_INTERVAL_MS));
 }
 
-// --- MODE_NONE handlers ---
-static void init_mode_none(void) {
-    memset(&mode_state, 0, sizeof(mode_state));
-    // No state to set for none
-
-    set_led_state(GREEN_LED_PIN, LED_BLINK_ONCE); // Set LEDs to blink once initially
-    set_led_state(RED_LED_PIN, LED_BLINK_ONCE);
-    prepare_mesh_adv_data(0);
-    adv_params.interval_min = BT_GAP_ADV_SLOW_INT_MIN;
-    adv_params.interval_max = BT_GAP_ADV_SLOW_INT_MAX;
-}
+static void start_cycle(void)
+{
+    int err;
 
-static void handle_zephyr_none(const bt_addr_le_t *addr, device_info_t *peer_info, uint8_t state, int8_t rssi) {
-    // Do nothing
-}
+    refresh_adv();
+    k_mutex_lock(&core_lock, K_FOREVER);
+    load_scan();
+    k_mutex_unlock(&core_lock);
+    err = bt_le_scan_start(&scan_param, scan_cb);
+    if (err) {
+        last_error = ERROR_SCAN_START;
+        scan_start_failures++;
+    }
+    eval_ticks = 0;
+    eval_due_ms = k_uptime_get() + PEER_EVAL_INTERVAL_MS;
+    prof_cycle_mark = 0;
+    k_work_schedule(&cycle_work, K_MSEC(PEER_EVAL_INTERVAL_MS));
+}
+#else
+// --- Cycle scheduler ---
+// Each cycle is a chain of phases run from a single delayable work item on the
+// system work queue, the CPU idles between phases instead of sleeping in a loop.
+// Optimized for high peer density (120-130 peers) with:
+// - 3.5 second scan cycles
+// - Slow advertisement intervals
+// - Random jitter between advertisement start and scan start to maximize scanning window
+static void cycle_handler(struct k_work *work)
+{
+    int err;
+    uint32_t prof;
 
-static void end_of_cycle_none(void) {
-    // None mode: do nothing
-}
+    switch (cycle_phase) {
+    case CYCLE_ADV_START:
+        // --- Advertising phase ---
+        cycle_start_ms = k_uptime_get();
+        prof_cycle();
+        // Advertising keeps running across cycles, a changed payload is updated in place
+        refresh_adv();
+        k_mutex_lock(&core_lock, K_FOREVER);
+        load_scan();
+        k_mutex_unlock(&core_lock);
 
-// --- Common/utility handlers ---
+        // Add random jitter to maximize scanning window before advertising
+        // This allows more time to discover peers before adding RF noise
+        uint32_t jitter_ms = sys_rand32_get() % PEER_DISCOVERY_JITTER_MS;
+        scan_remaining_ms = scan_duration_ms - jitter_ms;
+        cycle_phase = CYCLE_SCAN_START;
+        k_work_schedule(&cycle_work, K_MSEC(jitter_ms));
+        prof_stop(PROF_ADV_START, prof_cycle_mark);
+        prof_phase_mark = prof_start();
+        prof_jitter_pending = true;
+        break;
 
-// Handle master advertisements that may change device_info and dynamic threshold
-static void handle_master_adv(const bt_addr_le_t *addr, const uint8_t *target_mac, uint8_t mode, uint8_t affinity, uint8_t level, int8_t dynamic_threshold, int8_t rssi) {
-    // Ignore if target_mac does not match this device's MAC
-    if (memcmp(target_mac, static_addr.a.val, MAC_LEN) != 0) {
-        return;
-    }
-    
-    device_info_t new_info;
-    new_info.mode = mode;
-    new_info.affinity = affinity;
-    new_info.level = level;
-    new_info.dynamic_rssi_threshold = dynamic_threshold;
-
-    if ( new_info.affinity == AFFINITY_UNITY ) {
-        if ( new_info.mode == MODE_DEVICE && (new_info.level >= 4) ) {
-            // Unity device mode can only have a single level (0-3)
-            return;
-        } else if ( new_info.mode == MODE_AURA ) {
-            // validate Unity aura levels
-            uint8_t magic_level = split_unity_level(new_info.level, AFFINITY_MAGIC);
-            uint8_t techno_level = split_unity_level(new_info.level, AFFINITY_TECHNO);
-            if ( magic_level > 3 || techno_level > 3 ) {
-                return; // Invalid level for Unity affinity
-            }
+    case CYCLE_SCAN_START:
+        // --- Scanning phase ---
+        if (prof_jitter_pending) {
+            prof_stop(PROF_JITTER, prof_phase_mark); // Not after a duplicate filter re-arm
+            prof_jitter_pending = false;
+        }
+        prof_phase_mark = prof_start();
+        // Scan enable resets the controller duplicate filter
+        err = bt_le_scan_start(&scan_param, scan_cb);
+        if (err) {
+            last_error = ERROR_SCAN_START;
+            scan_start_failures++;
         }
-    }
-    
-    if (memcmp(&device_info, &new_info, sizeof(device_info_t)) != 0) {
-        mode_changed = true;
-        device_info = new_info;
-        nvs_write(&fs, 1, &device_info, sizeof(device_info)); // Store new device_info in flash (ID 1)
-    }
-}
 
-// Handle overseer advertisements in device mode
-static void handle_overseer_adv(const bt_addr_le_t *addr, const uint8_t *data, int8_t rssi) {
-    // Only process in device mode
-    if (device_info.mode != MODE_DEVICE) {
-        return;
-    }
-    
-    // Apply dynamic RSSI threshold if enabled
-    if (!check_dynamic_rssi_threshold(rssi)) {
-        return; // Signal too weak according to dynamic threshold
-    }
-    
-    // Check if this overseer is stronger than current one or if no overseer tracked
-    if (rssi > mode_state.device.overseer_rssi || 
-        memcmp(mode_state.device.overseer_mac, addr->a.val, MAC_LEN) == 0) {
-        
-        // Update overseer tracking
-        memcpy(mode_state.device.overseer_mac, addr->a.val, MAC_LEN);
-        mode_state.device.overseer_rssi = rssi;
-        mode_state.device.overseer_detected_this_cycle = 1;
-        
-        // Extract state for this device's affinity and level
-        uint8_t commanded_state = 0;
-        if (device_info.affinity == AFFINITY_MAGIC && device_info.level >= 0 && device_info.level <= 3) {
-            commanded_state = data[device_info.level]; // Magic levels at positions 0, 1, 2, 3 in data (after header)
-        } else if (device_info.affinity == AFFINITY_TECHNO && device_info.level >= 0 && device_info.level <= 3) {
-            commanded_state = data[device_info.level + 4]; // Techno levels at positions 4, 5, 6, 7 in data
-        } else if (device_info.affinity == AFFINITY_UNITY && device_info.level >= 0 && device_info.level <= 3) {
-            // For Unity, use the better of magic or techno state for this level
-            uint8_t magic_state = data[device_info.level];
-            uint8_t techno_state = data[device_info.level + 4];
-            commanded_state = (magic_state || techno_state) ? 1 : 0;
+        // With duplicate filtering, optionally restart the scan every
+        // SCAN_DUP_FILTER_REARM_MS so changed payloads are reported again
+        int window_ms = scan_remaining_ms;
+        if (SCAN_DUP_FILTER_REARM_MS > 0 && (scan_param.options & BT_LE_SCAN_OPT_FILTER_DUPLICATE)) {
+            window_ms = MIN(window_ms, SCAN_DUP_FILTER_REARM_MS);
         }
-        
-        mode_state.device.overseer_state = commanded_state;
-    }
-}
+        scan_remaining_ms -= window_ms;
+        cycle_phase = CYCLE_SCAN_STOP;
+        k_work_schedule(&cycle_work, K_MSEC(window_ms));
+        break;
 
-// Count stable peers for device state calculations
-// Only includes peers detected for PEER_DETECTION_THRESHOLD consecutive cycles
-static void count_stable_peers_for_calculations(void) {
-    // Reset level counts
-    memset(aura_level_count, 0, sizeof(aura_level_count));
-    
-    for (int i = 0; i < MAX_PEERS; i++) {
-        if (is_peer_valid_for_calculation(&peers[i])) {
-            // Maintain counts of levels for each affinity type using matrix
-            if (peers[i].affinity == AFFINITY_UNITY) {
-                // Unity is the only affinity that can be friendly to all levels
-                aura_level_count[FRIENDLY_AURAS_IDX][split_unity_level(peers[i].level, device_info.affinity)]++;
-            } else if (peers[i].affinity == device_info.affinity &&
-                peers[i].level <= MAX_AURA_LEVEL) { 
-                aura_level_count[FRIENDLY_AURAS_IDX][peers[i].level]++;
-            } else if (device_info.affinity != AFFINITY_UNITY) {
-                // Unity is the only affinity that has no hostile auras
-                // If the peer's affinity is not friendly, count it as hostile
-                aura_level_count[HOSTILE_AURAS_IDX][peers[i].level]++;
-            }
+    case CYCLE_SCAN_STOP:
+        prof_stop(PROF_SCAN_WINDOW, prof_phase_mark);
+        prof = prof_start();
+        bt_le_scan_stop();
+        if (scan_remaining_ms > 0) {
+            cycle_phase = CYCLE_SCAN_START; // Re-arm the duplicate filter
+            k_work_schedule(&cycle_work, K_NO_WAIT);
+            prof_stop(PROF_SCAN_STOP, prof);
+            break;
         }
-    }
-}
+        cycle_phase = CYCLE_END;
+        k_work_schedule(&cycle_work, K_MSEC(CYCLE_DRAIN_MS)); // Allow pending operations to complete
+        prof_stop(PROF_SCAN_STOP, prof);
+        break;
 
-// Count stable peers for overseer calculations from a specific affinity perspective
-// This allows overseer to calculate states for each affinity independently
-static void count_stable_peers_for_overseer_calculations(void) {
-    // Reset level counts
-    memset(aura_level_count, 0, sizeof(aura_level_count));
-    
-    for (int i = 0; i < MAX_PEERS; i++) {
-        if (is_peer_valid_for_calculation(&peers[i])) {
-            // Maintain counts of levels for each affinity type using matrix
-            if (peers[i].affinity == AFFINITY_MAGIC) {
-                aura_level_count[MAGIC_AURAS_IDX][peers[i].level]++;
-            } else if (peers[i].affinity == AFFINITY_TECHNO) { 
-                aura_level_count[TECHNO_AURAS_IDX][peers[i].level]++;
-            } else {
-                // Then it must be Unity
-                aura_level_count[MAGIC_AURAS_IDX][split_unity_level(peers[i].level, AFFINITY_MAGIC)]++;
-                aura_level_count[TECHNO_AURAS_IDX][split_unity_level(peers[i].level, AFFINITY_TECHNO)]++;
-            }
+    case CYCLE_END:
+        // --- End of cycle handler ---
+        if (k_uptime_get() - cycle_start_ms >= scan_duration_ms + CYCLE_DRAIN_MS + CYCLE_OVERRUN_SLACK_MS) {
+            cycle_overruns++; // Work queue or radio calls held the cycle up
         }
-    }
-}
+        k_mutex_lock(&core_lock, K_FOREVER);
+        drain_adv_ring(ADV_RING_SIZE); // Scanning is stopped, finish this cycle's adverts
+        mesh_core_end_of_cycle();
+        k_mutex_unlock(&core_lock);
 
-// Set handlers based on mode
-static void set_mode(operation_mode_t mode) {
-    set_led_state(RED_LED_PIN, LED_BLINK_FAST);
-    set_led_state(GREEN_LED_PIN, LED_BLINK_FAST);
-    operate_leds(STARTUP_DELAY_MS, BLINK_INTERVAL_MS); // Operate LEDs for 5 second, blink every 250ms
-    set_led_state(GREEN_LED_PIN, LED_OFF);
-    set_led_state(RED_LED_PIN, LED_OFF);
-    switch (mode) {
-        case MODE_AURA:
-            current_zephyr_handler = handle_zephyr_aura;
-            current_end_of_cycle = end_of_cycle_aura;
-            init_mode_aura();
-            break;
-        case MODE_DEVICE:
-            current_zephyr_handler = handle_zephyr_device;
-            current_end_of_cycle = end_of_cycle_device;
-            init_mode_device();
-            break;
-        case MODE_LVLUP_TOKEN:
-            current_zephyr_handler = handle_zephyr_lvlup_token;
-            current_end_of_cycle = end_of_cycle_lvlup_token;
-            init_mode_lvlup_token();
-            break;
-        case MODE_OVERSEER:
-            current_zephyr_handler = handle_zephyr_overseer;
-            current_end_of_cycle = end_of_cycle_overseer;
-            init_mode_overseer();
-            break;
-        case MODE_NONE:
-        default:
-            current_zephyr_handler = handle_zephyr_none;
-            current_end_of_cycle = end_of_cycle_none;
-            init_mode_none();
-            break;
+        cycle_phase = CYCLE_ADV_START;
+        k_work_schedule(&cycle_work, K_NO_WAIT);
+        break;
     }
-    mode_changed = false;
-    // Reset peer table and aura level counts and LED states
-    clear_peer_table();
-    memset(aura_level_count, 0, sizeof(aura_level_count));
 }
 
-static void scan_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t adv_type,
-                    struct net_buf_simple *buf)
+static void start_cycle(void)
 {
-    if (rssi < RSSI_THRESHOLD) {
-        return; // Ignore weak signals
-    }
-    uint8_t mfg[16] = {0};
-    int mfg_len = 0;
-    struct net_buf_simple temp = *buf;
-    device_info_t peer_info = {0};
-    while (temp.len > 1) {
-        uint8_t length = net_buf_simple_pull_u8(&temp);
-        if (length == 0 || length > temp.len) {
-            break;
-        }
-        uint8_t type = net_buf_simple_pull_u8(&temp);
-        length -= 1;
-        if (type == BT_DATA_MANUFACTURER_DATA && length >= 2) {
-            memcpy(mfg, temp.data, length > 16 ? 16 : length);
-            mfg_len = length;
-            break;
-        }
-        temp.data += length;
-        temp.len -= length;
-    }
-    if (mfg_len >= MESH_ADV_LEN && mfg[0] == 0xCE && mfg[1] == 0xFA) {
-        // Mesh device advertisement with nibble-packed format
-        peer_info.mode = UNPACK_MODE(mfg[2]);
-        peer_info.affinity = UNPACK_AFFINITY(mfg[2]);
-        peer_info.level = UNPACK_LEVEL(mfg[3], peer_info.affinity);
-        peer_info.dynamic_rssi_threshold = (int8_t)mfg[4];
-        uint8_t state = UNPACK_STATE(mfg[3]);
-        // Call mesh handler (pass addr, peer_info, state, rssi)
-        current_zephyr_handler(addr, &peer_info, state, rssi);
-    } else if (mfg_len >= MASTER_ADV_LEN && mfg[0] == 0xAB && mfg[1] == 0xAC) {
-        // Master advertisement - format: [0xAB, 0xAC, target_mac[6], device_info_t]
-        uint8_t *target_mac = &mfg[2];
-        device_info_t new_device_info;
-        memcpy(&new_device_info, &mfg[2 + MAC_LEN], sizeof(device_info_t));
-        // Call master handler (pass addr, target_mac, new_device_info, rssi)
-        handle_master_adv(addr, target_mac, new_device_info.mode, new_device_info.affinity, 
-                         new_device_info.level, new_device_info.dynamic_rssi_threshold, rssi);
-    } else if (mfg_len >= OVERSEER_ADV_LEN && mfg[0] == 0xDE && mfg[1] == 0xAD) {
-        // Overseer advertisement
-        handle_overseer_adv(addr, &mfg[2], rssi);
-    }
-}
-
-
-// Prepares mesh advertisement data with nibble-packed format
-// Format: [0xCE, 0xFA, mode|affinity, level|state, dynamic_rssi_threshold]
-static void prepare_mesh_adv_data(uint8_t state) {
-    adv_data[0] = 0xCE;
-    adv_data[1] = 0xFA;
-    adv_data[2] = PACK_MODE_AFFINITY(device_info.mode, device_info.affinity);
-    adv_data[3] = PACK_LEVEL_STATE(device_info.level, state);
-    adv_data[4] = (uint8_t)device_info.dynamic_rssi_threshold;
-    dynamic_ad[0].data_len = MESH_ADV_LEN;
-}
-
-// Prepares aura mesh advertisement data with nibble-packed format
-// Format: [0xCE, 0xFA, mode|affinity, level|state, dynamic_rssi_threshold]
-static void prepare_aura_mesh_adv_data(uint8_t state) {
-    adv_data[0] = 0xCE;
-    adv_data[1] = 0xFA;
-    adv_data[2] = PACK_MODE_AFFINITY(device_info.mode, device_info.affinity);
-    adv_data[3] = PACK_AURA_LEVEL_STATE(device_info.level, state, device_info.affinity);
-    adv_data[4] = (uint8_t)device_info.dynamic_rssi_threshold;
-    dynamic_ad[0].data_len = MESH_ADV_LEN;
+    prof_cycle_mark = 0;
+    cycle_phase = CYCLE_ADV_START;
+    k_work_schedule(&cycle_work, K_NO_WAIT);
 }
+#endif
 
-// Prepare overseer advertisement data: [0xDE, 0xAD, states_for_each_level_and_affinity]
-// Format: [header] [magic_lvl0] [magic_lvl1] [magic_lvl2] [magic_lvl3] [techno_lvl0] [techno_lvl1] [techno_lvl2] [techno_lvl3]
-// Each byte contains states for that level/affinity combination using same logic as device mode
-static void prepare_overseer_adv_data(void) {
-    adv_data[0] = 0xDE;
-    adv_data[1] = 0xAD;
-
-    // set default states for all levels
-    memset(adv_data + 2, 0, 8); // Magic and Techno levels
-    adv_data[2] = 1; // Magic level 0 ON
-    adv_data[6] = 1; // Techno level 0 ON
-
-    dynamic_ad[0].data_len = OVERSEER_ADV_LEN;
-    
-    // Calculate device states for Magic affinity devices (levels 0-3)
-    count_stable_peers_for_overseer_calculations();
-
-    int deciding_level = HOSTILE_ENVIRONMENT_LEVEL;
-
-    for ( ; deciding_level > 0; --deciding_level) {
-        if (aura_level_count[MAGIC_AURAS_IDX][deciding_level] == 0 &&
-            aura_level_count[TECHNO_AURAS_IDX][deciding_level] == 0) {
-            continue; // No peers at this level, skip
-        }
-        break; // Found a level with peers
-    }
-
-    if (deciding_level <= 0) {
-        // No peers at any level, leave default states
-        return;
-    }
+// Cancel the running cycle wherever it is and switch off the radio
+static void stop_cycle(void)
+{
+    k_work_cancel_delayable_sync(&cycle_work, &cycle_sync);
+    bt_le_scan_stop();
+    bt_le_adv_stop();
+    adv_running = false;
+}
+
+// --- Main loop ---
+// The cycle runs on the work queue, the main thread only applies mode changes.
+// Master adverts are decoded by adv_worker, so a new mode takes effect
+// mid-cycle instead of waiting for the end of the cycle. A new device_info is
+// written to flash here, with the radio off; a failed write is retried at the
+// next mode change. set_mode does not block (the LED animation plays over the
+// new mode), so the radio is only off for the flash write and the new mode's
+// first cycle starts right away.
+static void main_loop(void)
+{
+    set_mode(device_info.mode);
+    start_cycle();
+    while (1) {
+        k_sem_take(&mode_change_sem, K_FOREVER);
+        stop_cycle();
 
-    if (deciding_level == HOSTILE_ENVIRONMENT_LEVEL) {
-        if ( aura_level_count[MAGIC_AURAS_IDX][HOSTILE_ENVIRONMENT_LEVEL] ) {
-            // If there are magic auras at hostile level, turn all techno devices OFF
-            adv_data[6] = 0; // Techno levels OFF
+        k_mutex_lock(&core_lock, K_FOREVER);
+        if (config_store_commit(&config_flash)) {
+            last_error = ERROR_CONFIG_WRITE;
         }
-        if ( aura_level_count[TECHNO_AURAS_IDX][HOSTILE_ENVIRONMENT_LEVEL] ) {
-            // If there are techno auras at hostile level, turn all magic devices OFF
-            adv_data[2] = 0; // Magic levels OFF
+        if (mesh_core_mode_changed()) {
+            set_mode(device_info.mode);
         }
-        return;
-    }
+        k_mutex_unlock(&core_lock);
 
-    // Calculate which affinity has more peers at the deciding level
-    for ( int i = deciding_level; i >= 0; --i) {
-        // Check values for both Magic and Techno auras at deciding_level
-        if (aura_level_count[MAGIC_AURAS_IDX][deciding_level] > aura_level_count[TECHNO_AURAS_IDX][deciding_level]) {
-            // If magic auras are more, turn magic devices ON and techno devices OFF
-            adv_data[2 + i] = 1; // Magic levels OFF
-            adv_data[6 + i] = 0; // Techno levels OFF
-        } else if (aura_level_count[TECHNO_AURAS_IDX][deciding_level] > aura_level_count[MAGIC_AURAS_IDX][deciding_level]) {
-            // If techno auras are more, turn techno devices ON and magic devices OFF
-            adv_data[2 + i] = 0; // Magic levels OFF
-            adv_data[6 + i] = 1; // Techno levels OFF
-        } else {
-            // If equal, turn both ON
-            adv_data[2 + i] = 1; // Magic levels ON
-            adv_data[6 + i] = 1; // Techno levels ON
-        }
+        start_cycle();
     }
 }
 
-// Trigger system restart (similar to power cycle)
-static void system_restart(void)
+static int config_read(uint16_t offset, void *data, uint16_t len)
 {
-    sys_reboot(SYS_REBOOT_COLD); // Cold reset - most similar to power cycle
+    return flash_read(flash_dev, config_offset + offset, data, len);
 }
 
-// --- Unified main loop ---
-// Optimized for high peer density (120-130 peers) with:
-// - 5 second scan cycles (vs 1.5s)
-// - Slow advertisement intervals (1000ms vs 20-30ms)
-// - Random jitter between scan start and advertisement start to maximize scanning window
-static void main_loop(void)
+static int config_write(uint16_t offset, const void *data, uint16_t len)
 {
-    set_mode(device_info.mode);
-    while (1) {
-        
-        int err;
-        // --- Advertising phase ---
-        err = bt_le_adv_start(&adv_params, dynamic_ad, ARRAY_SIZE(dynamic_ad), NULL, 0);
-        if (err) {
-            last_error = ERROR_ADV_START;
-        }
-        
-        // Add random jitter to maximize scanning window before advertising
-        // This allows more time to discover peers before adding RF noise
-        uint32_t jitter_ms = sys_rand32_get() % PEER_DISCOVERY_JITTER_MS;
-        operate_leds(jitter_ms, jitter_ms); // Random delay using LED operation
-        
-        
-        // --- Scanning phase ---
-        err = bt_le_scan_start(&scan_param, scan_cb);
-        if (err) {
-            last_error = ERROR_SCAN_START;
-        }
-        
-        // Continue scanning and advertising for the remaining cycle time
-        operate_leds(CYCLE_DURATION_MS - jitter_ms, BLINK_INTERVAL_MS);
-        bt_le_scan_stop();
-        bt_le_adv_stop();
-        operate_leds(100, BLINK_INTERVAL_MS); // 100ms delay to allow pending operations to complete
-
-        // --- End of cycle handler ---
-        current_end_of_cycle();
+    return flash_write(flash_dev, config_offset + offset, data, len);
+}
 
-        // Check for mode change
-        if (mode_changed) {
-            set_mode(device_info.mode);
-        }
-    }
+static int config_erase(uint8_t page)
+{
+    return flash_erase(flash_dev, config_offset + page * config_flash.page_size, config_flash.page_size);
 }
 
+// Locate the config pages, NVS is only mounted when they are empty
 static int init_flash(void) 
 {
     int err;
 
     if (!device_is_ready(flash_dev)) {
+        last_error = ERROR_FLASH_NOT_READY;
         return 1;
     }
 
     struct flash_pages_info info;
-    err = flash_get_page_info_by_offs(flash_dev, fs.offset, &info);
+    err = flash_get_page_info_by_offs(flash_dev, FLASH_AREA_OFFSET(storage_partition), &info);
     if (err) {
         last_error = ERROR_FLASH_PAGE_INFO;
         return 1;
     }
 
-    /* Initialize the NVS file system */
     fs.offset = FLASH_AREA_OFFSET(storage_partition);
     fs.sector_size = info.size; // Use the flash page size
     fs.sector_count = 3; // Adjust as needed
     fs.flash_device = flash_dev;
 
-    err = nvs_mount(&fs);
-    if (err) {
-        last_error = ERROR_NVS_MOUNT;
-        return err;
-    }
+    config_offset = FLASH_AREA_OFFSET(storage_partition) + FLASH_AREA_SIZE(storage_partition) -
+                    CONFIG_STORE_PAGES * info.size;
+    config_flash.page_size = (uint16_t)info.size;
+    provision_offset = fs.offset + fs.sector_count * info.size;
+    provision_size = config_offset - provision_offset;
 
     return 0;
 }
 
+// device_info from the config pages: a binary search per page, no NVS mount.
+// Devices configured by older firmware have it in NVS (ID 1) only, it is read
+// from there once and moved to the config pages. The NVS record is deleted once
+// the move succeeded, so a stale configuration can never come back from NVS.
+static void load_device_info(void)
+{
+    if (config_store_load(&config_flash, &device_info)) {
+        return;
+    }
+
+    /* Initialize the NVS file system */
+    if (nvs_mount(&fs)) {
+        last_error = ERROR_NVS_MOUNT;
+        return; // Not configured, use default (already initialized)
+    }
+    // Records of older firmware are 4 bytes (mode, affinity, level, threshold): zone and group keep their defaults
+    if (nvs_read(&fs, NVS_ID_DEVICE_INFO, &device_info, sizeof(device_info)) < 0) {
+        return; // Not found, use default (already initialized)
+    }
+    config_store_request(&device_info);
+    if (config_store_commit(&config_flash)) {
+        last_error = ERROR_CONFIG_WRITE;
+        return; // Still in NVS, the migration runs again at the next boot
+    }
+    if (nvs_delete(&fs, NVS_ID_DEVICE_INFO)) {
+        last_error = ERROR_NVS_DELETE;
+    }
+}
+
 
 int main(void)
 {
     int err;
 
+    k_thread_name_set(adv_worker_tid, "adv_worker"); // For stack_report.conf, no-op without CONFIG_THREAD_NAME
+
     // Initialize LED manager with PWM support (3 LEDs)
     init_led_manager(led_array, 3);
     
@@ -1137,9 +656,7 @@ int main(void)
     if (init_flash() ) {
         return 1;
     }
-
-    // Initialize peer hash table
-    clear_peer_table();
+    load_device_info(); // Before bt_enable, so a migration erase cannot stall the controller
 
     /* Initialize the Bluetooth Subsystem */
     err = bt_enable(NULL);
@@ -1158,12 +675,7 @@ int main(void)
         last_error = ERROR_BT_ID_GET;
         return 0;
     }
-
-    /* Load device_info from flash (ID 1) */
-    err = nvs_read(&fs, NVS_ID_DEVICE_INFO, &device_info, sizeof(device_info));
-    if (err < 0) {
-        // Not found, use default (already initialized)
-    }
+    mesh_core_init(static_addr.a.val);
 
     main_loop();
     return 0;
@@ -0,0 +1,1412 @@
+/* mesh_core.c - Portable protocol and mode logic */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Everything here builds without Zephyr: board access goes through platform.h,
+ * the radio is driven by main.c from mesh_core_adv() and mesh_core_scan_report().
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "mesh_core.h"
+#include "adv_codec.h"
+#include "adv_ring.h"
+#include "config_store.h"
+#include "peer_table.h"
+#include "platform.h"
+#include "profiler.h"
+#include "defines.h"
+
+/******* Global Variables **************/
+
+// Peer discovery and management
+// Use a matrix for level counters: [hostile/friendly][level]
+static uint16_t aura_level_count[2][LEVELS_PER_AFFINITY] = {{0}};
+
+// Advertisement requested by the current mode
+static mesh_adv_t adv = {
+    .len = MESH_ADV_LEN,
+    .interval_min = ADV_SLOW_INT_MIN,
+    .interval_max = ADV_SLOW_INT_MAX,
+};
+static uint8_t *const adv_data = adv.data; // Buffer for dynamic advertisement data
+
+// Scan settings requested by the current mode
+static mesh_scan_t scan;
+
+// Density-adaptive advertising interval (see adapt_adv_interval)
+static bool adv_adaptive; // Mode uses the slow interval and lets it follow density
+static uint8_t cycle_sketch[ADV_SKETCH_BITS / 8]; // hash_mac bitmap of mesh adverts heard this cycle
+static uint16_t density_q4; // Smoothed neighborhood size, 1/16 peer units
+static uint8_t adv_backoff; // Extra interval in eighths, driven by the sighting rate
+
+static uint8_t own_mac[MAC_LEN];
+
+// Telemetry (see prepare_telemetry_adv_data)
+static uint16_t telemetry_cycles; // Cycles since the last report
+static bool telemetry_requested;
+static uint8_t telemetry_request; // TELEMETRY_REQUEST_* asked for, counters for unrequested reports
+static uint8_t telemetry_trimmed_zones; // Zones of the overseer advert before fit_telemetry, 0 = untouched
+
+// Device information structures
+
+static mode_state_t mode_state;
+static bool mode_changed = false;
+static operation_mode_t active_mode = MODE_NONE; // Mode of the last set_mode call
+device_info_t device_info = {
+    .mode = MODE_NONE,
+    .affinity = AFFINITY_UNITY,
+    .level = 0,
+    .dynamic_rssi_threshold = 0 // 0 = disabled, use default RSSI_THRESHOLD
+};
+
+/******* Functions Declarations **************/
+static void age_overseer(void);
+static void track_overseer(void);
+
+// --- Utility and Helper Functions ---
+static void prepare_mesh_adv_data(uint8_t state);
+static void prepare_overseer_adv_data(void);
+static void encode_overseer_adv_data(void);
+static void prepare_overseer_summary_adv_data(void);
+static void prepare_telemetry_adv_data(void);
+static void prepare_profile_adv_data(void);
+static void prepare_provision_adv_data(void);
+static void update_telemetry(void);
+static void fit_telemetry(void);
+static int8_t entry_rssi_threshold(void);
+
+#define TO_UNITY_LEVEL(magic_level, techno_level) \
+    ((magic_level << 4) | (techno_level & 0x0F))
+
+// --- Mode-specific initialization function declarations ---
+static void init_mode_aura(void);
+static void init_mode_device(void);
+static void init_mode_lvlup_token(void);
+static void init_mode_overseer(void);
+static void init_mode_provisioner(void);
+static void init_mode_none(void);
+
+// --- BLE Advertisement/Scan Handlers ---
+static void handle_master_adv(const uint8_t *target_mac, const device_info_t *new_info);
+static void handle_group_master_adv(uint8_t group, const device_info_t *new_info);
+static void handle_zephyr_device(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi);
+static void handle_zephyr_aura(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi);
+static void handle_zephyr_none(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi);
+static void handle_zephyr_lvlup_token(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi);
+static void handle_zephyr_overseer(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi);
+static void handle_zephyr_provisioner(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi);
+static void confirm_provision(const uint8_t *mac, const device_info_t *peer_info);
+static void handle_overseer_adv(const uint8_t *mac, const uint8_t *mfg, uint8_t mfg_len, int8_t rssi);
+
+// --- End-of-Cycle Handlers ---
+static void end_of_cycle_aura(void);
+static void end_of_cycle_device(void);
+static void end_of_cycle_lvlup_token(void);
+static void end_of_cycle_overseer(void);
+static void end_of_cycle_provisioner(void);
+static void end_of_cycle_none(void);
+static void update_device_state(void);
+static uint8_t decide_device_state(uint8_t *is_suppressed);
+static void apply_device_state(uint8_t is_suppressed);
+
+// --- Evaluator Handlers (CONTINUOUS_SCAN, every PEER_EVAL_INTERVAL_MS) ---
+static void evaluate_device(void);
+static void evaluate_peers(void);
+static void evaluate_none(void);
+
+/******* End Functions Declarations **************/
+
+
+// Function pointer types for mode-specific handlers
+typedef void (*zephyr_adv_handler_t)(const uint8_t *, device_info_t*, uint8_t, int8_t);
+typedef void (*end_of_cycle_handler_t)(void);
+
+// Function pointers for current mode
+static zephyr_adv_handler_t current_zephyr_handler = handle_zephyr_none;
+static end_of_cycle_handler_t current_end_of_cycle = end_of_cycle_none;
+static end_of_cycle_handler_t current_evaluate = evaluate_none;
+
+// RSSI needed to start counting an aura or to follow an overseer in device mode.
+// The dynamic threshold (0 = disabled) can only raise RSSI_THRESHOLD, weaker
+// reports are already gone at RSSI_SCAN_GATE and kept only for hysteresis.
+static int8_t entry_rssi_threshold(void) {
+    int8_t dynamic = device_info.dynamic_rssi_threshold;
+    return dynamic != 0 && dynamic > RSSI_THRESHOLD ? dynamic : RSSI_THRESHOLD;
+}
+
+// Select the scan duty cycle and cycle length for the current mode
+static void set_scan_profile(uint16_t interval, uint16_t window, uint16_t duration_ms) {
+    scan.interval = interval;
+    scan.window = window;
+    scan.duration_ms = duration_ms;
+}
+
+// Distinct senders heard this cycle, from the number of bits set in cycle_sketch (linear
+// counting): filling b of m bits takes sum(m / (m - k), k < b) senders on average.
+// Works in every mode and ignores repeat reports, unlike peer_count or a report counter.
+static uint16_t estimate_neighbors(void) {
+    uint16_t bits = 0;
+    for (int i = 0; i < (int)sizeof(cycle_sketch); i++) {
+        for (uint8_t b = cycle_sketch[i]; b; b &= b - 1) {
+            bits++;
+        }
+    }
+    memset(cycle_sketch, 0, sizeof(cycle_sketch));
+    uint32_t estimate_q4 = 0;
+    for (uint16_t k = 0; k < bits && k < ADV_SKETCH_BITS - 1; k++) {
+        estimate_q4 += (ADV_SKETCH_BITS << 4) / (ADV_SKETCH_BITS - k);
+    }
+    uint32_t estimate = estimate_q4 >> 4;
+    return estimate > MAX_PEERS ? MAX_PEERS : estimate;
+}
+
+// Keep the chance of hearing each neighbor per cycle roughly constant as the crowd grows:
+// the interval scales with the smoothed neighborhood size, and is stretched further while
+// too many established peers go unseen in a cycle (a sign of on-air collisions).
+static void adapt_adv_interval(void) {
+    uint16_t sample = estimate_neighbors();
+    if (!adv_adaptive) {
+        return;
+    }
+    if (density_q4 == 0) {
+        density_q4 = sample << 4; // First cycle after set_mode: no history to smooth
+    } else {
+        density_q4 += ((int32_t)(sample << 4) - density_q4) >> ADV_DENSITY_EWMA_SHIFT;
+    }
+
+    const peer_table_stats_t *stats = peer_table_stats();
+    if (stats->cycle_established >= ADV_SIGHTING_MIN_PEERS) {
+        uint16_t sighted_pct = (uint32_t)stats->cycle_sighted * 100 / stats->cycle_established;
+        if (sighted_pct < ADV_SIGHTING_LOW_PCT && adv_backoff < ADV_SIGHTING_MAX_BACKOFF) {
+            adv_backoff++;
+        } else if (sighted_pct > ADV_SIGHTING_HIGH_PCT && adv_backoff > 0) {
+            adv_backoff--;
+        }
+    }
+
+    uint32_t target = ((uint32_t)density_q4 * ADV_ADAPT_UNITS_PER_PEER) >> 4;
+    target += (target * adv_backoff) >> 3;
+    if (target < ADV_ADAPT_MIN_INT) {
+        target = ADV_ADAPT_MIN_INT;
+    } else if (target > ADV_ADAPT_MAX_INT) {
+        target = ADV_ADAPT_MAX_INT;
+    }
+
+    uint16_t current = adv.interval_min;
+    uint16_t diff = target > current ? target - current : current - target;
+    if (diff > (current >> ADV_ADAPT_HYSTERESIS_SHIFT)) {
+        adv.interval_min = target;
+        adv.interval_max = target + ADV_ADAPT_SPAN;
+    }
+}
+
+// --- MODE_AURA handlers ---
+static void init_mode_aura(void) {
+    memset(&mode_state, 0, sizeof(mode_state));
+    mode_state.aura.is_active = 1; // Example: set aura as active by default
+    // Set other aura state fields as needed
+
+    prepare_mesh_adv_data(mode_state.aura.is_active);
+    platform_set_led_state(GREEN_LED_PIN, LED_ON); // Set LEDs to ON initially
+    platform_set_led_state(RED_LED_PIN, LED_OFF); // Set problem LED off initially
+    // Use slower intervals for high peer density environments
+    adv.interval_min = ADV_SLOW_INT_MIN;
+    adv.interval_max = ADV_SLOW_INT_MAX;
+    set_scan_profile(SCAN_LOW_INTERVAL, SCAN_LOW_WINDOW, CYCLE_DURATION_MS);
+}
+
+static void handle_zephyr_aura(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi) {
+    // Only process peers advertising MODE_AURA
+    if (peer_info->mode != MODE_AURA || ! state) {
+        return; // Only interested in AURA mode
+    }
+    if (rssi < RSSI_THRESHOLD) {
+        return; // Hysteresis margin, only device and overseer peer counts use it
+    }
+    if (unlikely(peer_info->level == HOSTILE_ENVIRONMENT_LEVEL &&
+        peer_info->affinity != device_info.affinity && 
+        device_info.affinity != AFFINITY_UNITY)) {
+        mode_state.aura.is_in_hostile_environment = 1;
+        return;
+    }
+}
+
+static void end_of_cycle_aura(void) {
+    if (mode_state.aura.is_in_hostile_environment) {
+        if ( mode_state.aura.hostility_counter < HOSTILE_ENVIRONMENT_TRESHOLD ) {
+            // If in hostile environment, increase hostility counter
+            mode_state.aura.hostility_counter++;
+            platform_set_led_state(GREEN_LED_PIN, mode_state.aura.is_active);
+            platform_set_led_state(RED_LED_PIN, mode_state.aura.is_active ? LED_BLINK_ONCE : LED_ON);
+        }
+        // Aura mode: check if hostility counter is high, if so, blink LEDs
+        if (mode_state.aura.hostility_counter >= HOSTILE_ENVIRONMENT_TRESHOLD) {
+            // Blink LEDs to indicate active aura mode
+            platform_set_led_state(GREEN_LED_PIN, LED_OFF);
+            platform_set_led_state(RED_LED_PIN, LED_ON);
+            mode_state.aura.is_active = 0; // Disable aura
+            prepare_mesh_adv_data(mode_state.aura.is_active);
+        }
+        mode_state.aura.is_in_hostile_environment = 0; // Reset hostile environment state
+    } else if (mode_state.aura.hostility_counter > 0) {
+        mode_state.aura.hostility_counter--;
+        // If hostility counter is zero, SET LEDs back to ON
+        if (mode_state.aura.hostility_counter == 0) {
+            platform_set_led_state(GREEN_LED_PIN, LED_ON);
+            platform_set_led_state(RED_LED_PIN, LED_OFF);
+            mode_state.aura.is_active = 1; // Enable aura
+            prepare_mesh_adv_data(mode_state.aura.is_active);
+        } else {
+            platform_set_led_state(GREEN_LED_PIN, LED_BLINK_ONCE);
+            platform_set_led_state(RED_LED_PIN, LED_ON);
+        }
+    }
+}
+
+// --- MODE_DEVICE handlers ---
+static void init_mode_device(void) {
+    uint8_t is_suppressed;
+    memset(&mode_state, 0, sizeof(mode_state));
+    // Clear overseer tracking
+    memset(mode_state.device.overseer_mac, 0, MAC_LEN);
+    mode_state.device.overseer_rssi = -127; // Minimum RSSI
+    mode_state.device.overseer_stability_counter = 0;
+    mode_state.device.overseer_detected_this_cycle = 0;
+    mode_state.device.overseer_state = 0;
+    mode_state.device.use_overseer = 0;
+
+    // Off unless level 0, or decided by the established auras the peer table kept (see set_mode)
+    mode_state.device.is_on = decide_device_state(&is_suppressed);
+    apply_device_state(is_suppressed);
+    adv.interval_min = ADV_SLOW_INT_MIN;
+    adv.interval_max = ADV_SLOW_INT_MAX;
+    set_scan_profile(SCAN_FULL_INTERVAL, SCAN_FULL_WINDOW, CYCLE_DURATION_MS);
+}
+
+static void handle_zephyr_device(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi){
+    // Only process peers advertising MODE_AURA
+    if (peer_info->mode != MODE_AURA || ! state ) {
+        return; // Only interested in AURA mode
+    }
+
+    // Entry threshold (dynamic if enabled), peers already counted get the hysteresis band
+    count_peer(mac, peer_info, rssi, entry_rssi_threshold());
+}
+
+static void age_overseer()
+{
+    if (mode_state.device.overseer_stability_counter > 0)
+    {
+        mode_state.device.overseer_stability_counter = -1; // Reset to first miss
+    }
+    else
+    {
+        mode_state.device.overseer_stability_counter--; // Increment consecutive misses
+    }
+
+    // Stop using overseer if missed for too long
+    if (mode_state.device.overseer_stability_counter <= -OVERSEER_MISS_THRESHOLD)
+    {
+        mode_state.device.use_overseer = 0;
+        memset(mode_state.device.tracked_mac, 0, MAC_LEN);
+        mode_state.device.overseer_rssi = -127;
+    }
+}
+
+static void track_overseer() {
+    // Age overseer tracking
+    if ( ! mode_state.device.overseer_detected_this_cycle) {
+        age_overseer();
+        return; // Overseer was not detected this cycle
+    }
+    // Overseer was detected this cycle
+    mode_state.device.overseer_detected_this_cycle = 0; // Reset flag
+
+    if ( ! memcmp(mode_state.device.overseer_mac, mode_state.device.tracked_mac, MAC_LEN) ) {
+        // If overseer is our tracked one, update stability counter
+        if (mode_state.device.overseer_stability_counter < 0) {
+            mode_state.device.overseer_stability_counter = 1; // Reset to first detection
+        } else if (mode_state.device.overseer_stability_counter < OVERSEER_DETECTION_THRESHOLD) {
+            mode_state.device.overseer_stability_counter++; // Increment consecutive detections
+            
+            // Start using overseer once threshold is reached
+            if (mode_state.device.overseer_stability_counter >= OVERSEER_DETECTION_THRESHOLD) {
+                mode_state.device.use_overseer = 1;
+                memcpy(mode_state.device.tracked_mac, mode_state.device.overseer_mac, MAC_LEN);
+            }
+        }
+        return; 
+    }
+    // If overseer is not our tracked one, age it
+    age_overseer();
+    // If not tracking overseer after aging, start tracking the new one
+    if ( ! mode_state.device.use_overseer ) {
+        memcpy(mode_state.device.tracked_mac, mode_state.device.overseer_mac, MAC_LEN);
+        mode_state.device.overseer_stability_counter = 1; // Set to first detection
+    }
+      
+}
+
+static void end_of_cycle_device(void) {
+#if !CONTINUOUS_SCAN
+    // Age all peers (increment miss counters, remove old peers)
+    age_peers();
+#endif
+    
+    track_overseer();
+
+#if !CONTINUOUS_SCAN
+    update_device_state();
+#endif
+}
+
+// Periodic evaluator: peer aging and the device decision follow the sliding window
+static void evaluate_device(void) {
+    age_peers();
+    update_device_state();
+}
+
+// Decide ON/OFF from the overseer command or the established peers
+static void update_device_state(void) {
+    uint8_t is_suppressed;
+    uint8_t new_device_state = decide_device_state(&is_suppressed);
+
+    if (new_device_state != mode_state.device.is_on) {
+        mode_state.device.is_on = new_device_state;
+        apply_device_state(is_suppressed);
+    }
+}
+
+static uint8_t decide_device_state(uint8_t *is_suppressed) {
+    uint8_t new_device_state;
+    *is_suppressed = 0;
+
+    if (mode_state.device.use_overseer) {
+        // Use overseer-commanded state
+        new_device_state = mode_state.device.overseer_state;
+    } else {
+        // Count only stable peers (detected 3+ consecutive times) for calculations
+        count_stable_peers_for_calculations(aura_level_count, device_info.affinity);
+        
+        // Count max level and number of peers at max level for each affinity
+        new_device_state = device_info.level ? 0 : 1; // Default to OFF except if level is 0
+        for ( int level = HOSTILE_ENVIRONMENT_LEVEL ; level >= device_info.level; --level ) {
+            if (aura_level_count[HOSTILE_AURAS_IDX][level] == 0 &&
+                aura_level_count[FRIENDLY_AURAS_IDX][level] == 0) {
+                continue; // No peers at this level, skip
+            }
+            // Check if there more or equal friendly auras than hostile auras at this level
+            if (aura_level_count[FRIENDLY_AURAS_IDX][level] >= aura_level_count[HOSTILE_AURAS_IDX][level]) {
+                // If friendly auras are equal or more than hostile, keep device ON
+                new_device_state = 1;
+                break; // Found a level where device can stay ON
+            } else {
+                // If hostile auras are more, turn device OFF
+                new_device_state = 0;
+                *is_suppressed = 1;
+                break;
+            }
+        }
+    }
+    return new_device_state;
+}
+
+// Show mode_state.device.is_on on the output pin, LEDs and advert
+static void apply_device_state(uint8_t is_suppressed) {
+    platform_set_led_state(GREEN_LED_PIN, 
+        mode_state.device.is_on ? LED_ON : LED_BLINK_ONCE);
+    platform_set_output_pin(mode_state.device.is_on);
+    if ( is_suppressed ) {
+        platform_set_led_state(RED_LED_PIN, LED_ON); // Indicate suppression
+    } else {
+        platform_set_led_state(RED_LED_PIN, LED_OFF); // No suppression
+    }
+    prepare_mesh_adv_data(mode_state.device.is_on);
+}
+
+// --- MODE_LVLUP_TOKEN handlers ---
+static void init_mode_lvlup_token(void) {
+    memset(&mode_state, 0, sizeof(mode_state));
+    mode_state.lvlup_token.best_rssi = LVLUP_TOKEN_RSSI_THRESHOLD - 1;
+
+    prepare_mesh_adv_data(1);
+    adv.interval_min = ADV_SLOW_INT_MIN;
+    adv.interval_max = ADV_SLOW_INT_MAX;
+    set_scan_profile(SCAN_FULL_INTERVAL, SCAN_FULL_WINDOW, SCAN_BURST_DURATION_MS);
+    // indicate that the level-up token is in "charged" state
+    platform_set_led_state(GREEN_LED_PIN, LED_ON);
+}
+
+// The device_info this token gives an aura, false if the aura does not qualify
+static bool lvlup_token_grant(const device_info_t *peer_info, device_info_t *grant) {
+    uint8_t peer_level = peer_info->level;
+    grant->mode = MODE_AURA;
+    grant->dynamic_rssi_threshold = 0; // Default: no dynamic threshold
+    grant->zone = 0; // Not sent, the target keeps its zone and group
+    grant->group = 0;
+
+    if (device_info.affinity == AFFINITY_UNITY && 
+        peer_info->affinity != AFFINITY_UNITY) {
+        // Convert the peer affinity to Unity
+        grant->affinity = AFFINITY_UNITY;
+        if (peer_level == HOSTILE_ENVIRONMENT_LEVEL ) {
+            // Unity token cannot be hostile - set to max friendly level
+            peer_level = HOSTILE_ENVIRONMENT_LEVEL - 1 ;
+        }
+        grant->level = peer_info->affinity == AFFINITY_MAGIC ? TO_UNITY_LEVEL(peer_level, 0)
+                                                             : TO_UNITY_LEVEL(0, peer_level);
+        return true;
+    }
+
+    uint8_t current_level = peer_level;
+    if ( peer_info->affinity == AFFINITY_UNITY ) {
+        current_level = split_unity_level(peer_level, device_info.affinity);
+    } else if ( peer_info->affinity != device_info.affinity ) {
+        // If peer's affinity is not friendly, ignore it
+        return false;
+    }
+
+    // Check if level is less by 1 and affinity matches
+    if (current_level != device_info.level - 1) {
+        return false; // Not valid to get a level-up
+    }
+
+    if ( peer_info->affinity == AFFINITY_UNITY ) {
+        grant->affinity = AFFINITY_UNITY;
+        if (device_info.affinity == AFFINITY_MAGIC) {
+            grant->level = TO_UNITY_LEVEL(device_info.level, split_unity_level(peer_level, AFFINITY_TECHNO));
+        } else if (device_info.affinity == AFFINITY_TECHNO) {
+            grant->level = TO_UNITY_LEVEL(split_unity_level(peer_level, AFFINITY_MAGIC), device_info.level);
+        } else {
+            grant->level = 0; // A Unity token gives a Unity aura no level, as it always has
+        }
+    } else {
+        // If the peer's affinity is not Unity, keep the same affinity
+        grant->affinity = peer_info->affinity;
+        grant->level = device_info.level; // Give level-up to the target token
+    }
+    return true;
+}
+
+// Charged: keep the strongest qualifying aura of this burst as the target.
+// Handing over: watch the target's MESH advert for the new configuration.
+static void handle_zephyr_lvlup_token(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi) {
+    mode_lvlup_token_state_t *t = &mode_state.lvlup_token;
+    // Only process peers advertising MODE_AURA
+    if (peer_info->mode != MODE_AURA || t->discharged) {
+        return;
+    }
+    if (t->handing_over) {
+        if (!memcmp(mac, t->mac, MAC_LEN) && peer_info->affinity == t->device_info.affinity &&
+            peer_info->level == t->device_info.level) {
+            t->confirmed = 1;
+        }
+        return;
+    }
+    if ( rssi <= t->best_rssi) {
+        return; // Too far away, or a stronger candidate is already known
+    }
+    device_info_t grant;
+    if (!lvlup_token_grant(peer_info, &grant)) {
+        return;
+    }
+    memcpy(t->mac, mac, MAC_LEN);
+    t->device_info = grant;
+    t->best_rssi = rssi;
+    t->has_target = 1;
+}
+
+// Back to charged, ready for the next candidate
+static void lvlup_token_recharge(void) {
+    mode_lvlup_token_state_t *t = &mode_state.lvlup_token;
+    t->has_target = 0;
+    t->handing_over = 0;
+    t->confirmed = 0;
+    t->best_rssi = LVLUP_TOKEN_RSSI_THRESHOLD - 1;
+    prepare_mesh_adv_data(1);
+    adv.interval_min = ADV_SLOW_INT_MIN;
+    adv.interval_max = ADV_SLOW_INT_MAX;
+}
+
+static void end_of_cycle_lvlup_token(void) {
+    mode_lvlup_token_state_t *t = &mode_state.lvlup_token;
+    if ( ! t->has_target || t->discharged ) {
+        return; // No candidate this burst
+    }
+
+    if ( ! t->handing_over ) {
+        // The strongest candidate of the burst gets the master advert at the fast interval.
+        // Without the zone byte the target keeps its zone
+        adv.len = adv_master_encode(adv_data, t->mac, &t->device_info, false, false);
+        adv.interval_min = ADV_FAST_INT_MIN_2;
+        adv.interval_max = ADV_FAST_INT_MAX_2;
+        t->handing_over = 1;
+        t->cycles_left = LVLUP_TOKEN_CONFIRM_CYCLES;
+        // Blink LEDs indicate broadcast
+        platform_set_led_state(GREEN_LED_PIN, LED_BLINK_FAST);
+        platform_set_led_state(RED_LED_PIN, LED_OFF);
+        return;
+    }
+
+    if ( ! t->confirmed ) {
+        if (--t->cycles_left == 0) {
+            // The target never showed the new level: keep the charge, signal the failure
+            lvlup_token_recharge();
+            platform_set_led_state(GREEN_LED_PIN, LED_ON);
+            platform_set_led_state(RED_LED_PIN, LED_BLINK_ONCE);
+        }
+        return;
+    }
+
+    // Confirmed: broadcast the token state and after that the MAC of the aura we gave level-up to
+    if (device_info.level == 1) {
+        lvlup_token_recharge(); // Set state to 1 (active), lvl 1 tokens do not expire
+        platform_set_led_state(GREEN_LED_PIN, LED_ON);
+    } else {
+        // For other levels, prepare as used
+        t->discharged = 1;
+        prepare_mesh_adv_data(0); // Set state to 0 (used)
+        adv.interval_min = ADV_SLOW_INT_MIN;
+        adv.interval_max = ADV_SLOW_INT_MAX;
+        // indicate that the level-up token is in "discharged" state
+        platform_set_led_state(GREEN_LED_PIN, LED_OFF);
+        platform_set_led_state(RED_LED_PIN, LED_BLINK_ONCE);
+    }
+    memcpy(adv_data + MESH_ADV_LEN, t->mac, MAC_LEN); // Copy target MAC
+    adv.len = MESH_ADV_LEN + MAC_LEN; // Set data length for dynamic advertisement
+}
+
+// --- MODE_OVERSEER handlers ---
+static void init_mode_overseer(void) {
+    memset(&mode_state, 0, sizeof(mode_state));
+    mode_state.overseer.broadcast_countdown = OVERSEER_BROADCAST_COUNTDOWN;
+    mode_state.overseer.summary_countdown = OVERSEER_SUMMARY_INTERVAL;
+    mode_state.overseer.summary_origin = own_mac[0] | (own_mac[1] << 8) | ((uint32_t)own_mac[2] << 16);
+    mode_state.overseer.retired_origin = UINT32_MAX; // Never a 24-bit origin
+    // Overseer needs to see all auras as neutral to count them properly
+    // Keep original level and affinity for proper peer classification
+    
+    prepare_overseer_adv_data();
+    platform_set_led_state(GREEN_LED_PIN, LED_BLINK_ONCE);
+    adv.interval_min = ADV_SLOW_INT_MIN;
+    adv.interval_max = ADV_SLOW_INT_MAX;
+    set_scan_profile(SCAN_FULL_INTERVAL, SCAN_FULL_WINDOW, CYCLE_DURATION_MS);
+}
+
+static void handle_zephyr_overseer(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi) {
+    // Only process peers advertising MODE_AURA
+    if (peer_info->mode != MODE_AURA || !state) {
+        return; // Only interested in active AURA mode
+    }
+
+    count_peer(mac, peer_info, rssi, RSSI_THRESHOLD);
+}
+
+static void end_of_cycle_overseer(void) {
+#if !CONTINUOUS_SCAN
+    // Age all peers (increment miss counters, remove old peers)
+    age_peers();
+#endif
+    
+    // Note: Peer counting for overseer calculations is done within prepare_overseer_adv_data()
+    // for each affinity perspective separately
+    
+    if (mode_state.overseer.broadcast_countdown > 0) {
+        mode_state.overseer.broadcast_countdown--;
+        if (mode_state.overseer.broadcast_countdown == 0) {
+            // Reset countdown for next cycle
+            mode_state.overseer.broadcast_countdown = OVERSEER_BROADCAST_COUNTDOWN;
+            
+            // Prepare overseer advertisement data
+            prepare_overseer_adv_data();
+        }
+    }
+
+    // Every OVERSEER_SUMMARY_INTERVAL cycles the counts go on air instead of the states
+    if (OVERSEER_SUMMARY_INTERVAL && --mode_state.overseer.summary_countdown == 0) {
+        mode_state.overseer.summary_countdown = OVERSEER_SUMMARY_INTERVAL;
+        prepare_overseer_summary_adv_data();
+    } else if (adv_overseer_is_summary(adv_data, adv.len)) {
+        encode_overseer_adv_data(); // Back to the states after a summary cycle
+    }
+
+    // Forget relayed zones whose overseer went quiet
+    overseer_zone_t *relay = mode_state.overseer.relay;
+    for (int i = 0; i < (int)(sizeof(mode_state.overseer.relay) / sizeof(relay[0])); i++) {
+        if (relay[i].age && relay[i].age++ > OVERSEER_V2_RELAY_CYCLES) {
+            relay[i].age = 0;
+        }
+    }
+    overseer_summary_t *summaries = mode_state.overseer.summaries;
+    for (int i = 0; i < (int)(sizeof(mode_state.overseer.summaries) / sizeof(summaries[0])); i++) {
+        if (summaries[i].age && summaries[i].age++ > OVERSEER_SUMMARY_MAX_AGE) {
+            summaries[i].age = 0;
+        }
+    }
+}
+
+// --- MODE_PROVISIONER handlers ---
+
+// Entries in the flash queue, up to the first erased record
+static uint16_t count_provision_queue(void) {
+    uint8_t record[PROVISION_RECORD_LEN];
+    uint16_t count = 0;
+    while (count < PROVISION_QUEUE_MAX && platform_read_provision_record(count, record) &&
+           !provision_record_erased(record)) {
+        count++;
+    }
+    return count;
+}
+
+static bool provision_confirmed(uint16_t index) {
+    return mode_state.provisioner.confirmed[index >> 3] & (1 << (index & 7));
+}
+
+static bool provision_in_slot(uint16_t index) {
+    const provision_slot_t *slots = mode_state.provisioner.slots;
+    for (int i = 0; i < (int)(sizeof(mode_state.provisioner.slots) / sizeof(slots[0])); i++) {
+        if (slots[i].attempts && slots[i].index == index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Give a free slot the next unconfirmed entry, wrapping around the queue so deferred
+// entries get another pass. Its first cycle only listens: a target that already has
+// the configuration (provisioner restarted) is confirmed without a master advert.
+static void load_provision_slot(provision_slot_t *slot) {
+    mode_provisioner_state_t *p = &mode_state.provisioner;
+    uint8_t record[PROVISION_RECORD_LEN];
+    for (uint16_t tries = 0; tries < p->stats.queued; tries++) {
+        uint16_t index = p->next_index;
+        p->next_index = (uint16_t)((index + 1) % p->stats.queued);
+        if (provision_confirmed(index) || provision_in_slot(index)) {
+            continue;
+        }
+        if (!platform_read_provision_record(index, record) ||
+            !provision_record_decode(record, slot->mac, &slot->device_info)) {
+            continue; // Corrupt entry, skipped
+        }
+        slot->index = index;
+        slot->attempts = 1; // Marks the slot used, the first master advert makes it 2
+        slot->wait = 2; // Counted down once in this end of cycle already
+        return;
+    }
+}
+
+static void init_mode_provisioner(void) {
+    memset(&mode_state, 0, sizeof(mode_state));
+    mode_state.provisioner.stats.queued = count_provision_queue();
+    telemetry_request = TELEMETRY_REQUEST_PROVISION; // Unrequested reports carry the progress
+
+    prepare_mesh_adv_data(0);
+    adv.interval_min = ADV_SLOW_INT_MIN;
+    adv.interval_max = ADV_SLOW_INT_MAX;
+    // Full duty: confirmations are single MESH adverts of targets that just rebooted into a new mode
+    set_scan_profile(SCAN_FULL_INTERVAL, SCAN_FULL_WINDOW, CYCLE_DURATION_MS);
+    platform_set_led_state(GREEN_LED_PIN, LED_BLINK_FAST);
+}
+
+static void handle_zephyr_provisioner(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi) {
+    confirm_provision(mac, peer_info);
+}
+
+// A target confirms its assignment by advertising it: the MESH fields for all modes
+// but overseer, whose advert carries no device_info (peer_info = NULL, mode only)
+static void confirm_provision(const uint8_t *mac, const device_info_t *peer_info) {
+    mode_provisioner_state_t *p = &mode_state.provisioner;
+    for (int i = 0; i < (int)(sizeof(p->slots) / sizeof(p->slots[0])); i++) {
+        provision_slot_t *slot = &p->slots[i];
+        if (!slot->attempts || memcmp(slot->mac, mac, MAC_LEN)) {
+            continue;
+        }
+        const device_info_t *want = &slot->device_info;
+        if (peer_info ? peer_info->mode != want->mode || peer_info->affinity != want->affinity ||
+                            peer_info->level != want->level ||
+                            peer_info->dynamic_rssi_threshold != want->dynamic_rssi_threshold
+                      : want->mode != MODE_OVERSEER) {
+            return; // Still the old configuration (or not rebooted into the new one yet)
+        }
+        p->confirmed[slot->index >> 3] |= 1 << (slot->index & 7);
+        p->stats.confirmed++;
+        slot->attempts = 0;
+        return;
+    }
+}
+
+static void end_of_cycle_provisioner(void) {
+    mode_provisioner_state_t *p = &mode_state.provisioner;
+    int slot_count = (int)(sizeof(p->slots) / sizeof(p->slots[0]));
+    provision_slot_t *next = NULL;
+
+    for (int i = 0; i < slot_count; i++) {
+        provision_slot_t *slot = &p->slots[i];
+        if (slot->attempts > PROVISION_MAX_ATTEMPTS && slot->wait <= 1) {
+            slot->attempts = 0; // Out of attempts, the entry waits for the next pass over the queue
+            p->stats.deferred++;
+        }
+        if (!slot->attempts && p->stats.confirmed < p->stats.queued) {
+            load_provision_slot(slot);
+        }
+        if (slot->attempts && slot->wait) {
+            slot->wait--;
+        }
+    }
+    // One master advert per cycle, round robin over the slots that are due
+    for (int n = 0; n < slot_count && !next; n++) {
+        provision_slot_t *slot = &p->slots[(p->turn + n) % slot_count];
+        if (slot->attempts && !slot->wait) {
+            next = slot;
+            p->turn = (uint8_t)((p->turn + n + 1) % slot_count);
+        }
+    }
+
+    if (!next) {
+        prepare_mesh_adv_data(p->stats.confirmed == p->stats.queued); // State 1 = queue done
+        adv.interval_min = ADV_SLOW_INT_MIN;
+        adv.interval_max = ADV_SLOW_INT_MAX;
+        platform_set_led_state(GREEN_LED_PIN, p->stats.confirmed == p->stats.queued ? LED_ON : LED_BLINK_FAST);
+        return;
+    }
+    // The whole configuration, zone and group included
+    adv.len = adv_master_encode(adv_data, next->mac, &next->device_info, true, true);
+    adv.interval_min = ADV_FAST_INT_MIN_2;
+    adv.interval_max = ADV_FAST_INT_MAX_2;
+    uint16_t backoff = (uint16_t)(PROVISION_RETRY_CYCLES << (next->attempts - 1)); // attempts <= PROVISION_MAX_ATTEMPTS
+    next->wait = backoff > PROVISION_MAX_BACKOFF ? PROVISION_MAX_BACKOFF : (uint8_t)backoff;
+    next->attempts++;
+    p->stats.attempts++;
+}
+
+static void evaluate_peers(void) {
+    age_peers();
+}
+
+static void evaluate_none(void) {
+    // No peer table in this mode
+}
+
+// --- MODE_NONE handlers ---
+static void init_mode_none(void) {
+    memset(&mode_state, 0, sizeof(mode_state));
+    // No state to set for none
+
+    platform_set_led_state(GREEN_LED_PIN, LED_BLINK_ONCE); // Set LEDs to blink once initially
+    platform_set_led_state(RED_LED_PIN, LED_BLINK_ONCE);
+    prepare_mesh_adv_data(0);
+    adv.interval_min = ADV_SLOW_INT_MIN;
+    adv.interval_max = ADV_SLOW_INT_MAX;
+    set_scan_profile(SCAN_IDLE_INTERVAL, SCAN_IDLE_WINDOW, CYCLE_DURATION_MS);
+}
+
+static void handle_zephyr_none(const uint8_t *mac, device_info_t *peer_info, uint8_t state, int8_t rssi) {
+    // Do nothing
+}
+
+static void end_of_cycle_none(void) {
+    // None mode: do nothing
+}
+
+// --- Common/utility handlers ---
+
+// Validate and apply the device_info carried by a (group) master advertisement
+static void apply_master_config(const device_info_t *new_info) {
+    if ( new_info->affinity == AFFINITY_UNITY ) {
+        if ( new_info->mode == MODE_DEVICE && (new_info->level >= 4) ) {
+            // Unity device mode can only have a single level (0-3)
+            return;
+        } else if ( new_info->mode == MODE_AURA ) {
+            // validate Unity aura levels
+            uint8_t magic_level = split_unity_level(new_info->level, AFFINITY_MAGIC);
+            uint8_t techno_level = split_unity_level(new_info->level, AFFINITY_TECHNO);
+            if ( magic_level > 3 || techno_level > 3 ) {
+                return; // Invalid level for Unity affinity
+            }
+        }
+    }
+    
+    if (memcmp(&device_info, new_info, sizeof(device_info_t)) != 0) {
+        mode_changed = true;
+        device_info = *new_info;
+        platform_store_device_info(&device_info); // Store new device_info in flash
+        platform_request_mode_change();
+    }
+}
+
+// Handle master advertisements that may change device_info and dynamic threshold
+static void handle_master_adv(const uint8_t *target_mac, const device_info_t *new_info) {
+    // Ignore if target_mac does not match this device's MAC
+    if (memcmp(target_mac, own_mac, MAC_LEN) != 0) {
+        return;
+    }
+    apply_master_config(new_info);
+}
+
+// Handle group master advertisements: one advert configures every member of a group
+static void handle_group_master_adv(uint8_t group, const device_info_t *new_info) {
+    if (group == 0 || group != device_info.group) {
+        return; // Not in this group, or not in any group
+    }
+    apply_master_config(new_info);
+}
+
+// Remember the own zone of another V2 overseer, to repeat it in our advert
+static void relay_overseer_zone(const uint8_t *mfg, uint8_t mfg_len) {
+    if (!adv_overseer_is_v2(mfg, mfg_len)) {
+        return; // Only relay V2 own entries (first entry): one hop, no loops
+    }
+    uint8_t zone = mfg[3];
+    if (zone == device_info.zone) {
+        return; // We drive this zone ourselves
+    }
+    overseer_zone_t *relay = mode_state.overseer.relay;
+    const int relays = sizeof(mode_state.overseer.relay) / sizeof(mode_state.overseer.relay[0]);
+    overseer_zone_t *slot = NULL;
+    for (int i = 0; i < relays; i++) {
+        if (relay[i].age && relay[i].zone == zone) {
+            slot = &relay[i]; // Refresh existing entry
+            break;
+        }
+        if (!slot && !relay[i].age) {
+            slot = &relay[i]; // First free entry
+        }
+    }
+    if (slot) {
+        slot->zone = zone;
+        slot->states = mfg[4];
+        slot->age = 1;
+    }
+}
+
+// Another overseer sends its own summary under our origin: the low MAC bytes collided.
+// Both move to an origin mixed with their high MAC bytes, which differ, and drop the old
+// one, whose copies keep being relayed until they expire.
+static void change_summary_origin(void) {
+    uint32_t high = own_mac[3] | (own_mac[4] << 8) | ((uint32_t)own_mac[5] << 16);
+    mode_state.overseer.retired_origin = mode_state.overseer.summary_origin;
+    mode_state.overseer.summary_origin = ((mode_state.overseer.summary_origin ^ high) + 1) & 0xFFFFFF;
+}
+
+// Keep another overseer's summary: one entry per origin whatever path it came by,
+// the shortest path wins, nothing from beyond OVERSEER_SUMMARY_MAX_HOPS
+static void merge_overseer_summary(const uint8_t *mfg, uint8_t mfg_len) {
+    overseer_summary_t heard;
+    if (!adv_overseer_summary_decode(mfg, mfg_len, &heard) || heard.origin == mode_state.overseer.retired_origin) {
+        return;
+    }
+    if (heard.origin == mode_state.overseer.summary_origin) {
+        if (heard.hops == 0) {
+            change_summary_origin(); // Sent by its origin, and we do not hear ourselves
+        } else {
+            return; // Our own coming back
+        }
+    }
+    heard.hops++; // Count ourselves
+    if (heard.hops > OVERSEER_SUMMARY_MAX_HOPS) {
+        return;
+    }
+    overseer_summary_t *summaries = mode_state.overseer.summaries;
+    const int slots = sizeof(mode_state.overseer.summaries) / sizeof(mode_state.overseer.summaries[0]);
+    overseer_summary_t *slot = NULL;
+    for (int i = 0; i < slots; i++) {
+        if (summaries[i].age && summaries[i].origin == heard.origin) {
+            slot = &summaries[i]; // Known origin
+            break;
+        }
+        if (!slot && !summaries[i].age) {
+            slot = &summaries[i]; // First free entry
+        }
+    }
+    if (!slot || (slot->age && heard.hops > slot->hops)) {
+        return; // Table full, or an older copy by a longer path
+    }
+    heard.age = 1;
+    *slot = heard;
+}
+
+// Handle overseer advertisements: devices follow their zone, overseers relay other zones
+// and pool their aura counts
+static void handle_overseer_adv(const uint8_t *mac, const uint8_t *mfg, uint8_t mfg_len, int8_t rssi) {
+    if (device_info.mode == MODE_PROVISIONER) {
+        confirm_provision(mac, NULL);
+        return;
+    }
+    if (device_info.mode == MODE_OVERSEER) {
+        relay_overseer_zone(mfg, mfg_len);
+        merge_overseer_summary(mfg, mfg_len);
+        return;
+    }
+    // Only process in device mode
+    if (device_info.mode != MODE_DEVICE) {
+        return;
+    }
+    
+    // Apply dynamic RSSI threshold if enabled
+    if (rssi < entry_rssi_threshold()) {
+        return; // Signal too weak according to dynamic threshold
+    }
+
+    uint8_t states;
+    if (!adv_overseer_zone_states(mfg, mfg_len, device_info.zone, &states)) {
+        return; // This overseer does not drive our zone
+    }
+    
+    // Check if this overseer is stronger than current one or if no overseer tracked
+    if (rssi > mode_state.device.overseer_rssi || 
+        memcmp(mode_state.device.overseer_mac, mac, MAC_LEN) == 0) {
+        
+        // Update overseer tracking
+        memcpy(mode_state.device.overseer_mac, mac, MAC_LEN);
+        mode_state.device.overseer_rssi = rssi;
+        mode_state.device.overseer_detected_this_cycle = 1;
+        
+        // Extract state for this device's affinity and level
+        mode_state.device.overseer_state =
+            adv_overseer_state_for(states, device_info.affinity, device_info.level);
+    }
+}
+
+// Device and overseer both count established MODE_AURA peers in the peer table.
+// Entries hold the aura's own fields, the counts apply the own affinity and level
+// when they are taken, so a reconfiguration between these modes can keep the table.
+static bool mode_uses_peer_table(operation_mode_t mode) {
+    return mode == MODE_DEVICE || mode == MODE_OVERSEER;
+}
+
+// Set handlers based on mode
+void set_mode(operation_mode_t mode) {
+    platform_mode_transition(); // LED animation over the new mode's LEDs, the radio keeps running
+    uint32_t start = prof_start();
+    // A new dynamic threshold only applies to auras entering the count, counted ones keep the hysteresis band
+    if (!mode_uses_peer_table(active_mode) || !mode_uses_peer_table(mode)) {
+        clear_peer_table();
+    }
+    memset(aura_level_count, 0, sizeof(aura_level_count));
+    platform_set_led_state(GREEN_LED_PIN, LED_OFF);
+    platform_set_led_state(RED_LED_PIN, LED_OFF);
+    switch (mode) {
+        case MODE_AURA:
+            current_zephyr_handler = handle_zephyr_aura;
+            current_end_of_cycle = end_of_cycle_aura;
+            current_evaluate = evaluate_none;
+            init_mode_aura();
+            break;
+        case MODE_DEVICE:
+            current_zephyr_handler = handle_zephyr_device;
+            current_end_of_cycle = end_of_cycle_device;
+            current_evaluate = evaluate_device;
+            init_mode_device();
+            break;
+        case MODE_LVLUP_TOKEN:
+            current_zephyr_handler = handle_zephyr_lvlup_token;
+            current_end_of_cycle = end_of_cycle_lvlup_token;
+            current_evaluate = evaluate_none;
+            init_mode_lvlup_token();
+            break;
+        case MODE_OVERSEER:
+            current_zephyr_handler = handle_zephyr_overseer;
+            current_end_of_cycle = end_of_cycle_overseer;
+            current_evaluate = evaluate_peers;
+            init_mode_overseer();
+            break;
+        case MODE_PROVISIONER:
+            current_zephyr_handler = handle_zephyr_provisioner;
+            current_end_of_cycle = end_of_cycle_provisioner;
+            current_evaluate = evaluate_none;
+            init_mode_provisioner();
+            break;
+        case MODE_NONE:
+        default:
+            current_zephyr_handler = handle_zephyr_none;
+            current_end_of_cycle = end_of_cycle_none;
+            current_evaluate = evaluate_none;
+            init_mode_none();
+            break;
+    }
+    // Level-up token and provisioner must see payload changes, everyone else only needs one report per cycle
+    scan.filter_duplicates = SCAN_FILTER_DUPLICATES && mode != MODE_LVLUP_TOKEN && mode != MODE_PROVISIONER;
+    // Level-up tokens and provisioners switch to fast bursts themselves, all other modes adapt the slow interval
+    adv_adaptive = mode != MODE_LVLUP_TOKEN && mode != MODE_PROVISIONER;
+    memset(cycle_sketch, 0, sizeof(cycle_sketch));
+    density_q4 = 0;
+    adv_backoff = 0;
+    mode_changed = false;
+    telemetry_trimmed_zones = 0;
+    active_mode = mode;
+    prof_stop(PROF_SET_MODE, start);
+}
+
+bool mesh_core_mode_changed(void) {
+    return mode_changed;
+}
+
+void mesh_core_init(const uint8_t *mac) {
+    memcpy(own_mac, mac, MAC_LEN);
+    // Initialize peer hash table
+    clear_peer_table();
+    active_mode = MODE_NONE;
+}
+
+void mesh_core_process_payload(const uint8_t *mac, int8_t rssi, const uint8_t *mfg, uint8_t mfg_len) {
+    if (mfg_len < 2) {
+        return;
+    }
+    // Reports between RSSI_SCAN_GATE and RSSI_THRESHOLD only keep counted peers in their hysteresis band
+    if (rssi < RSSI_THRESHOLD && adv_kind(mfg) != ADV_KIND_MESH) {
+        return;
+    }
+    switch (adv_kind(mfg)) {
+    case ADV_KIND_MESH: {
+        // Mesh device advertisement with nibble-packed format
+        device_info_t peer_info;
+        uint8_t state;
+        if (!adv_mesh_decode(mfg, mfg_len, &peer_info, &state)) {
+            return;
+        }
+        if (rssi >= RSSI_THRESHOLD) {
+            uint16_t h = hash_mac(mac) & (ADV_SKETCH_BITS - 1);
+            cycle_sketch[h >> 3] |= 1 << (h & 7);
+        }
+        // Call mesh handler (pass mac, peer_info, state, rssi)
+        current_zephyr_handler(mac, &peer_info, state, rssi);
+        break;
+    }
+    case ADV_KIND_MASTER: {
+        // Master advertisement - format: [0xAB, 0xAC, target_mac[6], device_info_t:4, (zone, (group))]
+        const uint8_t *target_mac;
+        device_info_t new_device_info;
+        bool has_zone;
+        new_device_info.zone = device_info.zone; // Without the optional zone byte the device keeps its zone
+        new_device_info.group = device_info.group; // ... and without the group byte its group
+        if (!adv_master_decode(mfg, mfg_len, &target_mac, &new_device_info, &has_zone)) {
+            return;
+        }
+        handle_master_adv(target_mac, &new_device_info);
+        break;
+    }
+    case ADV_KIND_GROUP_MASTER: {
+        // Group master advertisement - format: [0xAB, 0xAD, group, device_info_t:4, (zone)]
+        uint8_t group;
+        device_info_t new_device_info;
+        bool has_zone;
+        new_device_info.zone = device_info.zone;
+        new_device_info.group = device_info.group; // Members stay in their group
+        if (!adv_group_master_decode(mfg, mfg_len, &group, &new_device_info, &has_zone)) {
+            return;
+        }
+        handle_group_master_adv(group, &new_device_info);
+        break;
+    }
+    case ADV_KIND_OVERSEER:
+        // Overseer advertisement, legacy or V2
+        if (mfg_len >= OVERSEER_V2_LEN(1)) {
+            handle_overseer_adv(mac, mfg, mfg_len, rssi);
+        }
+        break;
+    case ADV_KIND_TELEMETRY:
+        // Other nodes' reports are for sniffers, only requests matter here
+        if (adv_telemetry_request_for(mfg, mfg_len, own_mac)) {
+            telemetry_requested = true;
+            telemetry_request = adv_telemetry_request_what(mfg);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+const uint8_t *mesh_core_find_payload(int8_t rssi, const uint8_t *data, uint16_t len, uint8_t *payload_len) {
+    if (rssi < RSSI_SCAN_GATE) {
+        return NULL; // Ignore weak signals, RSSI_THRESHOLD applies per kind in mesh_core_process_payload
+    }
+    const uint8_t *payload;
+    return adv_parse(data, len, &payload, payload_len) != ADV_KIND_NONE ? payload : NULL;
+}
+
+void mesh_core_scan_report(const uint8_t *mac, int8_t rssi, const uint8_t *data, uint16_t len)
+{
+    uint8_t payload_len;
+    const uint8_t *payload = mesh_core_find_payload(rssi, data, len, &payload_len);
+    if (payload) {
+        mesh_core_process_payload(mac, rssi, payload, payload_len);
+    }
+}
+
+void mesh_core_end_of_cycle(void) {
+    uint32_t start = prof_start();
+    current_end_of_cycle();
+    adapt_adv_interval();
+    prof_stop(PROF_END_OF_CYCLE, start); // The report below carries this cycle's sample
+    update_telemetry();
+}
+
+void mesh_core_evaluate(void) {
+    current_evaluate();
+}
+
+const mesh_adv_t *mesh_core_adv(void) {
+    return &adv;
+}
+
+const mesh_scan_t *mesh_core_scan(void) {
+    return &scan;
+}
+
+
+// Prepares mesh advertisement data with nibble-packed format (see adv_codec.h)
+// Format: [0xCE, 0xFA, mode|affinity, level|state, dynamic_rssi_threshold]
+static void prepare_mesh_adv_data(uint8_t state) {
+    adv.len = adv_mesh_encode(adv_data, &device_info, state);
+}
+
+// Telemetry goes on air for one cycle: on request, or every TELEMETRY_INTERVAL_CYCLES
+static void update_telemetry(void) {
+    adv.telemetry_len = 0;
+    if (telemetry_trimmed_zones) {
+        // The relayed zones left out last cycle are still in adv_data
+        adv_put(adv_data, overseer_v2_header, telemetry_trimmed_zones);
+        adv.len = OVERSEER_V2_LEN(telemetry_trimmed_zones);
+        telemetry_trimmed_zones = 0;
+    }
+    if (TELEMETRY_INTERVAL_CYCLES > 0 && ++telemetry_cycles >= TELEMETRY_INTERVAL_CYCLES) {
+        telemetry_requested = true;
+    }
+    if (telemetry_requested && !adv_overseer_is_summary(adv_data, adv.len)) {
+        // Postponed over a summary cycle, the summary leaves no room
+        telemetry_requested = false;
+        telemetry_cycles = 0;
+        if (CYCLE_PROFILER && telemetry_request == TELEMETRY_REQUEST_PROFILE) {
+            prepare_profile_adv_data();
+        } else if (device_info.mode == MODE_PROVISIONER && telemetry_request != TELEMETRY_REQUEST_COUNTERS) {
+            prepare_provision_adv_data();
+        } else {
+            prepare_telemetry_adv_data();
+        }
+        telemetry_request = device_info.mode == MODE_PROVISIONER ? TELEMETRY_REQUEST_PROVISION
+                                                                 : TELEMETRY_REQUEST_COUNTERS;
+        fit_telemetry();
+    }
+}
+
+// Both structures must fit ADV_DATA_MAX_LEN. Only an overseer advert can be too long:
+// it leaves its last relayed zones out for the telemetry cycle (own zone comes first).
+// A legacy overseer advert cannot shrink, it sends no telemetry.
+static void fit_telemetry(void) {
+    if (adv.len + adv.telemetry_len + 4 <= ADV_DATA_MAX_LEN) {
+        return;
+    }
+    if (!adv_overseer_is_v2(adv_data, adv.len)) {
+        adv.telemetry_len = 0;
+        return;
+    }
+    uint8_t zones = adv_get(adv_data, overseer_v2_header);
+    telemetry_trimmed_zones = zones;
+    while (zones > 1 && OVERSEER_V2_LEN(zones) + adv.telemetry_len + 4 > ADV_DATA_MAX_LEN) {
+        zones--;
+    }
+    adv_put(adv_data, overseer_v2_header, zones);
+    adv.len = OVERSEER_V2_LEN(zones);
+}
+
+static void prepare_telemetry_adv_data(void) {
+    platform_telemetry_t platform;
+    const peer_table_stats_t *stats = peer_table_stats();
+    platform_get_telemetry(&platform);
+
+    telemetry_t t = {
+        .mode = device_info.mode,
+        .uptime_min = platform.uptime_s / 60 > UINT16_MAX ? UINT16_MAX : (uint16_t)(platform.uptime_s / 60),
+        .reports_received = (uint16_t)platform.reports_received,
+        .reports_rssi_rejected = (uint16_t)platform.reports_rssi_rejected,
+        .peers = peer_count,
+        .established = stats->cycle_established,
+        .max_probe = stats->max_probe,
+        .peers_refused = adv_saturate8(stats->dropped),
+        .ring_dropped = adv_saturate8(adv_ring_stats()->dropped),
+        .adv_start_failures = adv_saturate8(platform.adv_start_failures),
+        .scan_start_failures = adv_saturate8(platform.scan_start_failures),
+        .cycle_overruns = adv_saturate8(platform.cycle_overruns),
+        .last_error = platform.last_error,
+    };
+    adv.telemetry_len = adv_telemetry_encode(adv.telemetry, &t);
+}
+
+static void prepare_profile_adv_data(void) {
+    uint32_t khz = platform_cycles_per_sec() / 1000;
+    telemetry_profile_t p = {
+        .mode = device_info.mode,
+        .clock_khz = khz > UINT16_MAX ? UINT16_MAX : (uint16_t)khz,
+    };
+    for (int i = 0; i < TELEMETRY_PROFILE_PROBES; i++) {
+        p.max_bucket[i] = prof_percentile_bucket((prof_probe_t)i, 100);
+        p.p50_bucket[i] = prof_percentile_bucket((prof_probe_t)i, 50);
+    }
+    adv.telemetry_len = adv_telemetry_profile_encode(adv.telemetry, &p);
+}
+
+static void prepare_provision_adv_data(void) {
+    const mode_provisioner_state_t *p = &mode_state.provisioner;
+    telemetry_provision_t t = {
+        .mode = MODE_PROVISIONER,
+        .stats = p->stats,
+    };
+    for (int i = 0; i < (int)(sizeof(p->slots) / sizeof(p->slots[0])); i++) {
+        t.active += p->slots[i].attempts > 0;
+    }
+    adv.telemetry_len = adv_telemetry_provision_encode(adv.telemetry, &t);
+}
+
+// Pool the counts of the overseers within OVERSEER_SUMMARY_MAX_HOPS into our own, all in
+// half auras. An aura heard by two overseers is weak at both (OVERSEER_SUMMARY_CORE_RSSI)
+// and adds up to one aura, and every overseer of the region sums the same summaries, so
+// they reach the same decision where their ranges meet.
+// Returns false, leaving counts alone, when no summary is held.
+static bool add_overseer_summaries(uint16_t counts[2][LEVELS_PER_AFFINITY]) {
+    const overseer_summary_t *summaries = mode_state.overseer.summaries;
+    bool added = false;
+    for (int i = 0; i < (int)(sizeof(mode_state.overseer.summaries) / sizeof(summaries[0])); i++) {
+        if (!summaries[i].age) {
+            continue;
+        }
+        added = true;
+        for (int level = 1; level <= OVERSEER_SUMMARY_LEVELS; level++) {
+            counts[MAGIC_AURAS_IDX][level] += summaries[i].counts[MAGIC_AURAS_IDX][level - 1];
+            counts[TECHNO_AURAS_IDX][level] += summaries[i].counts[TECHNO_AURAS_IDX][level - 1];
+        }
+    }
+    return added;
+}
+
+// Calculate device states for this overseer's zone:
+// levels = [magic_lvl0] [magic_lvl1] [magic_lvl2] [magic_lvl3] [techno_lvl0] [techno_lvl1] [techno_lvl2] [techno_lvl3]
+// Each entry contains states for that level/affinity combination using same logic as device mode
+static void calculate_overseer_levels(uint8_t levels[8]) {
+    // set default states for all levels
+    memset(levels, 0, 8); // Magic and Techno levels
+    levels[0] = 1; // Magic level 0 ON
+    levels[4] = 1; // Techno level 0 ON
+    
+    // Calculate device states for Magic affinity devices (levels 0-3)
+#if OVERSEER_SUMMARY_INTERVAL
+    count_stable_peers_for_overseer_summary(aura_level_count);
+    if (!add_overseer_summaries(aura_level_count)) {
+        // No other overseer heard: whole auras, same thresholds as a standalone overseer
+        count_stable_peers_for_overseer_calculations(aura_level_count);
+    }
+#else
+    count_stable_peers_for_overseer_calculations(aura_level_count);
+#endif
+
+    int deciding_level = HOSTILE_ENVIRONMENT_LEVEL;
+
+    for ( ; deciding_level > 0; --deciding_level) {
+        if (aura_level_count[MAGIC_AURAS_IDX][deciding_level] == 0 &&
+            aura_level_count[TECHNO_AURAS_IDX][deciding_level] == 0) {
+            continue; // No peers at this level, skip
+        }
+        break; // Found a level with peers
+    }
+
+    if (deciding_level <= 0) {
+        // No peers at any level, leave default states
+        return;
+    }
+
+    if (deciding_level == HOSTILE_ENVIRONMENT_LEVEL) {
+        if ( aura_level_count[MAGIC_AURAS_IDX][HOSTILE_ENVIRONMENT_LEVEL] ) {
+            // If there are magic auras at hostile level, turn all techno devices OFF
+            levels[4] = 0; // Techno levels OFF
+        }
+        if ( aura_level_count[TECHNO_AURAS_IDX][HOSTILE_ENVIRONMENT_LEVEL] ) {
+            // If there are techno auras at hostile level, turn all magic devices OFF
+            levels[0] = 0; // Magic levels OFF
+        }
+        return;
+    }
+
+    // Calculate which affinity has more peers at the deciding level
+    for ( int i = deciding_level; i >= 0; --i) {
+        // Check values for both Magic and Techno auras at deciding_level
+        if (aura_level_count[MAGIC_AURAS_IDX][deciding_level] > aura_level_count[TECHNO_AURAS_IDX][deciding_level]) {
+            // If magic auras are more, turn magic devices ON and techno devices OFF
+            levels[i] = 1; // Magic levels OFF
+            levels[4 + i] = 0; // Techno levels OFF
+        } else if (aura_level_count[TECHNO_AURAS_IDX][deciding_level] > aura_level_count[MAGIC_AURAS_IDX][deciding_level]) {
+            // If techno auras are more, turn techno devices ON and magic devices OFF
+            levels[i] = 0; // Magic levels OFF
+            levels[4 + i] = 1; // Techno levels OFF
+        } else {
+            // If equal, turn both ON
+            levels[i] = 1; // Magic levels ON
+            levels[4 + i] = 1; // Techno levels ON
+        }
+    }
+}
+
+// Prepare overseer advertisement data, V2 by default:
+// [0xDE, 0xAD, 0xA0|zones, own_zone, own_states, relayed_zone, relayed_states, ...]
+// With OVERSEER_LEGACY_ADV: [0xDE, 0xAD, one byte per (affinity, level)]
+static void prepare_overseer_adv_data(void) {
+    uint8_t levels[8];
+    calculate_overseer_levels(levels);
+    mode_state.overseer.states = adv_overseer_pack_levels(levels);
+    encode_overseer_adv_data();
+}
+
+// States advert from the last decision, with the zones currently relayed
+static void encode_overseer_adv_data(void) {
+    uint8_t states = mode_state.overseer.states;
+#if OVERSEER_LEGACY_ADV
+    adv.len = adv_overseer_legacy_encode(adv_data, states);
+#else
+    uint8_t zone_ids[OVERSEER_V2_MAX_ZONES];
+    uint8_t zone_states[OVERSEER_V2_MAX_ZONES];
+    telemetry_trimmed_zones = 0; // Fresh advert, nothing to restore
+    uint8_t zones = 1; // Own zone always comes first, other overseers relay only that entry
+    zone_ids[0] = device_info.zone;
+    zone_states[0] = states;
+    const overseer_zone_t *relay = mode_state.overseer.relay;
+    for (int i = 0; i < (int)(sizeof(mode_state.overseer.relay) / sizeof(relay[0])); i++) {
+        if (relay[i].age) {
+            zone_ids[zones] = relay[i].zone;
+            zone_states[zones] = relay[i].states;
+            zones++;
+        }
+    }
+    adv.len = adv_overseer_v2_encode(adv_data, zone_ids, zone_states, zones);
+#endif
+}
+
+// Summary advert for one cycle: our own counts, or every other time the next summary
+// that may travel one more hop (round robin), so summaries reach OVERSEER_SUMMARY_MAX_HOPS
+static void prepare_overseer_summary_adv_data(void) {
+    const overseer_summary_t *summaries = mode_state.overseer.summaries;
+    const int slots = sizeof(mode_state.overseer.summaries) / sizeof(mode_state.overseer.summaries[0]);
+    uint8_t turn = mode_state.overseer.summary_turn++;
+    telemetry_trimmed_zones = 0; // adv_data no longer holds the states advert
+
+    if (turn & 1) {
+        for (int n = 0; n < slots; n++) {
+            int i = (mode_state.overseer.summary_relay_next + n) % slots;
+            if (summaries[i].age && summaries[i].hops < OVERSEER_SUMMARY_MAX_HOPS) {
+                mode_state.overseer.summary_relay_next = (uint8_t)((i + 1) % slots);
+                adv.len = adv_overseer_summary_encode(adv_data, &summaries[i], summaries[i].hops);
+                return;
+            }
+        }
+    }
+    overseer_summary_t own = { .origin = mode_state.overseer.summary_origin };
+    count_stable_peers_for_overseer_summary(aura_level_count);
+    for (int level = 1; level <= OVERSEER_SUMMARY_LEVELS; level++) {
+        own.counts[MAGIC_AURAS_IDX][level - 1] = adv_saturate8(aura_level_count[MAGIC_AURAS_IDX][level]);
+        own.counts[TECHNO_AURAS_IDX][level - 1] = adv_saturate8(aura_level_count[TECHNO_AURAS_IDX][level]);
+    }
+    adv.len = adv_overseer_summary_encode(adv_data, &own, 0);
+}
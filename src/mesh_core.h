@@ -0,0 +1,52 @@
+/* mesh_core.h - Portable protocol and mode logic */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MESH_CORE_H
+#define MESH_CORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+
+// Current device configuration (loaded from flash / set by master adverts)
+extern device_info_t device_info;
+
+// Initialize the core with this device's own MAC (used to match master adverts)
+void mesh_core_init(const uint8_t *own_mac);
+
+// Set handlers based on mode
+void set_mode(operation_mode_t mode);
+// True once a master advert changed device_info and set_mode() must be called
+bool mesh_core_mode_changed(void);
+
+// Process one received advert: raw AD structures as delivered to scan_cb
+// (mesh_core_find_payload + mesh_core_process_payload in one call)
+void mesh_core_scan_report(const uint8_t *mac, int8_t rssi, const uint8_t *data, uint16_t len);
+// Cheap check safe for the BT RX path: RSSI gate, then adv_parse() in place.
+// Returns a pointer into data at a complete mesh payload (0xCE/0xAB/0xDE magic), or NULL.
+const uint8_t *mesh_core_find_payload(int8_t rssi, const uint8_t *data, uint16_t len, uint8_t *payload_len);
+// Decode a payload returned by mesh_core_find_payload and run the mode handlers
+void mesh_core_process_payload(const uint8_t *mac, int8_t rssi, const uint8_t *mfg, uint8_t mfg_len);
+// Run the current mode's end-of-cycle handler
+void mesh_core_end_of_cycle(void);
+// CONTINUOUS_SCAN only: age peers and re-evaluate the device state, every PEER_EVAL_INTERVAL_MS
+void mesh_core_evaluate(void);
+
+// Advertisement the current mode wants on air
+const mesh_adv_t *mesh_core_adv(void);
+// Scan settings the current mode wants
+const mesh_scan_t *mesh_core_scan(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MESH_CORE_H */
@@ -0,0 +1,541 @@
+/* peer_table.c - Peer hash table used by device and overseer modes */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "peer_table.h"
+#include "platform.h"
+#include "profiler.h"
+
+// Struct-of-arrays storage: a packed per-peer struct took 16 bytes with padding,
+// a slot now costs 7 bytes plus three bits. Peers are keyed by a 32-bit mix of their MAC
+// (peer_key) instead of the 6-byte MAC, and the key also gives the home slot, so the
+// probe distance is recomputed instead of stored. 512 slots take 3776 bytes, with or
+// without CONTINUOUS_SCAN; the old 255-entry table took 4080 bytes.
+static uint32_t peer_keys[PEER_TABLE_SIZE]; // peer_key of the MAC, low bits = home slot
+static uint8_t peer_meta[PEER_TABLE_SIZE]; // PEER_META_*: occupied, affinity, level
+static uint8_t peer_track[PEER_TABLE_SIZE]; // PEER_TRACK_*: last-seen tick, stability counter
+static uint8_t peer_detected[PEER_TABLE_SIZE / 8]; // Bit-plane: detected this cycle
+static uint8_t peer_established[PEER_TABLE_SIZE / 8]; // Bit-plane: reached PEER_DETECTION_THRESHOLD
+static uint8_t peer_rssi[PEER_TABLE_SIZE]; // Smoothed RSSI, rssi_q1 scale
+static uint8_t peer_inside[PEER_TABLE_SIZE / 8]; // Bit-plane: smoothed RSSI inside the hysteresis band
+uint16_t peer_count = 0; // Number of discovered peers
+#if CONTINUOUS_SCAN
+static uint8_t peer_tick; // Incremented by every age_peers call, kept in peer_track modulo 32
+#define PEER_ESTABLISH_THRESHOLD PEER_ESTABLISH_SIGHTINGS
+#else
+#define PEER_ESTABLISH_THRESHOLD PEER_DETECTION_THRESHOLD
+#endif
+
+// Established peers by (affinity, level), indexed by the low 6 bits of peer_meta.
+// Kept up to date as peers get established, evicted or change affinity/level,
+// so the count_stable_peers_* functions never walk the table.
+#define PEER_BUCKETS 64
+#define META_BUCKET(meta) ((meta) & (PEER_BUCKETS - 1))
+static uint16_t established_count[PEER_BUCKETS];
+// Of those, the ones with a smoothed RSSI at or above OVERSEER_SUMMARY_CORE_RSSI, which count
+// twice in the half-aura overseer summaries. Follows the same events plus core crossings.
+static uint16_t core_count[PEER_BUCKETS];
+#define PEER_CORE_Q1 rssi_q1(OVERSEER_SUMMARY_CORE_RSSI)
+
+static peer_table_stats_t stats;
+
+// peer_meta layout: [occupied:1][spare:1][affinity:2][level:4]
+// Magic/Techno levels (0-4) are stored as-is, Unity magic<<4|techno is
+// squeezed to magic<<2|techno (both parts are capped at 3).
+#define PEER_META_OCCUPIED 0x80
+#define PEER_META_AFFINITY_SHIFT 4
+#define PEER_META_LEVEL_MASK 0x0F
+
+// peer_track layout: [seen_tick:5][stability_counter:3, signed]
+// seen_tick is the evaluator tick of the last sighting (CONTINUOUS_SCAN only, wraps at 32)
+#define PEER_TRACK_SEEN_SHIFT 3
+#define PEER_TRACK_SEEN_MASK 0x1F
+#define PEER_TRACK_STABILITY_MASK 0x07
+
+#if PEER_ESTABLISH_THRESHOLD > 3 || PEER_MISS_THRESHOLD > 4
+#error "stability counter must fit the signed 3 bits of peer_track"
+#endif
+#if CONTINUOUS_SCAN && (PEER_SEEN_WINDOW_TICKS > PEER_TRACK_SEEN_MASK || PEER_CYCLE_TICKS > PEER_SEEN_WINDOW_TICKS)
+#error "seen ticks are 5 bits: keep PEER_SEEN_WINDOW_MS under 32 evaluator periods"
+#endif
+
+#define BIT_GET(plane, i) (((plane)[(i) >> 3] >> ((i) & 7)) & 1)
+#define BIT_SET(plane, i) ((plane)[(i) >> 3] |= (uint8_t)(1 << ((i) & 7)))
+#define BIT_CLR(plane, i) ((plane)[(i) >> 3] &= (uint8_t)~(1 << ((i) & 7)))
+#define BIT_PUT(plane, i, v) do { if (v) { BIT_SET(plane, i); } else { BIT_CLR(plane, i); } } while (0)
+
+// Smoothed RSSI is kept in half-dB steps above -128 dBm: 0 = -128 dBm, 254 = -1 dBm
+static inline int16_t rssi_q1(int16_t rssi) {
+    return rssi >= 0 ? 254 : rssi <= -128 ? 0 : (int16_t)((rssi + 128) << 1);
+}
+
+static inline bool slot_occupied(uint16_t i) {
+    return peer_meta[i] & PEER_META_OCCUPIED;
+}
+
+// Distance from the home slot, which is the low bits of the key
+static inline uint8_t slot_dist(uint16_t i) {
+    return (uint8_t)((i - peer_keys[i]) & PEER_TABLE_MASK);
+}
+
+static inline int8_t slot_stability(uint16_t i) {
+    int8_t value = peer_track[i] & PEER_TRACK_STABILITY_MASK;
+    return value > 3 ? value - 8 : value; // Sign-extend 3 bits
+}
+
+static inline void slot_set_stability(uint16_t i, int8_t stability) {
+    peer_track[i] = (uint8_t)((peer_track[i] & ~PEER_TRACK_STABILITY_MASK) | (stability & PEER_TRACK_STABILITY_MASK));
+}
+
+#if CONTINUOUS_SCAN
+// Evaluator ticks since the last sighting of slot
+static inline uint8_t slot_seen_age(uint16_t i) {
+    return (uint8_t)((peer_tick - (peer_track[i] >> PEER_TRACK_SEEN_SHIFT)) & PEER_TRACK_SEEN_MASK);
+}
+
+static inline void slot_set_seen(uint16_t i) {
+    peer_track[i] = (uint8_t)(((peer_tick & PEER_TRACK_SEEN_MASK) << PEER_TRACK_SEEN_SHIFT) |
+                              (peer_track[i] & PEER_TRACK_STABILITY_MASK));
+}
+#endif
+
+static inline uint8_t meta_affinity(uint8_t meta) {
+    return (meta >> PEER_META_AFFINITY_SHIFT) & 0x03;
+}
+
+// Level in device_info_t form (Unity expanded back to magic<<4|techno)
+static inline uint8_t meta_level(uint8_t meta) {
+    uint8_t level = meta & PEER_META_LEVEL_MASK;
+    if (meta_affinity(meta) == AFFINITY_UNITY) {
+        return (uint8_t)(((level >> 2) << 4) | (level & 0x03));
+    }
+    return level;
+}
+
+static inline uint8_t pack_meta(const device_info_t *peer_info) {
+    uint8_t level = peer_info->level;
+    if (peer_info->affinity == AFFINITY_UNITY) {
+        level = (uint8_t)((((level >> 4) & 0x03) << 2) | (level & 0x03));
+    }
+    return (uint8_t)(PEER_META_OCCUPIED |
+        ((peer_info->affinity & 0x03) << PEER_META_AFFINITY_SHIFT) |
+        (level & PEER_META_LEVEL_MASK));
+}
+
+static void move_slot(uint16_t to, uint16_t from) {
+    peer_keys[to] = peer_keys[from];
+    peer_meta[to] = peer_meta[from];
+    peer_track[to] = peer_track[from];
+    BIT_PUT(peer_detected, to, BIT_GET(peer_detected, from));
+    BIT_PUT(peer_established, to, BIT_GET(peer_established, from));
+    peer_rssi[to] = peer_rssi[from];
+    BIT_PUT(peer_inside, to, BIT_GET(peer_inside, from));
+}
+
+static void record_probe(uint8_t probe_len) {
+    stats.lookups++;
+    stats.probes += probe_len;
+    stats.probe_histogram[probe_len]++;
+    if (probe_len > stats.max_probe) {
+        stats.max_probe = probe_len;
+    }
+}
+
+// 32-bit peer key, shifts and XORs only for the nRF51822 (no multiply).
+// The first four MAC bytes (the NIC part of a public address and a byte of its OUI)
+// go through invertible xorshift steps, so MACs differing only there never share a
+// key; the last two bytes are mixed in before. Every byte reaches the 9 home-slot bits.
+// Two MACs differing in their last bytes collide with odds 2^-32: with MAX_PEERS
+// random addresses about 2e-5 per full table, and they are then counted as one peer.
+static uint32_t peer_key(const uint8_t *mac) {
+    uint32_t key = mac[0] | ((uint32_t)mac[1] << 8) | ((uint32_t)mac[2] << 16) | ((uint32_t)mac[3] << 24);
+    key ^= (uint32_t)(mac[4] | (mac[5] << 8)) << 11;
+    key ^= key >> 15;
+    key ^= key << 7;
+    key ^= key >> 13;
+    return key;
+}
+
+uint16_t hash_mac(const uint8_t *mac) {
+    return (uint16_t)(peer_key(mac) & PEER_TABLE_MASK);
+}
+
+// Find the slot holding key. Returns its index, or PEER_TABLE_SIZE if absent;
+// in that case *insert_at is where Robin Hood order says the peer belongs.
+static uint16_t find_slot(uint32_t key, uint16_t *insert_at) {
+    uint16_t slot = key & PEER_TABLE_MASK;
+    uint8_t dist = 0;
+
+    for (; dist < PEER_MAX_PROBE_LENGTH; dist++, slot = (slot + 1) & PEER_TABLE_MASK) {
+        // An empty slot or a resident closer to its home than we are to ours
+        // ends the search: the peer would have been stored here
+        if (!slot_occupied(slot) || slot_dist(slot) < dist) {
+            break;
+        }
+        if (peer_keys[slot] == key) {
+            record_probe(dist + 1);
+            return slot;
+        }
+    }
+    record_probe(dist + (dist < PEER_MAX_PROBE_LENGTH));
+    *insert_at = (dist < PEER_MAX_PROBE_LENGTH) ? slot : PEER_TABLE_SIZE;
+    return PEER_TABLE_SIZE;
+}
+
+// Insert a new peer at slot, shifting the rest of the cluster one slot forward.
+// Fails without touching the table if any shifted entry would exceed the probe bound.
+static bool insert_at_slot(uint16_t slot, uint32_t key, const device_info_t *peer_info, int8_t rssi) {
+    uint16_t end = slot;
+    while (slot_occupied(end)) {
+        if (slot_dist(end) + 1 >= PEER_MAX_PROBE_LENGTH) {
+            return false;
+        }
+        end = (end + 1) & PEER_TABLE_MASK;
+    }
+    while (end != slot) {
+        uint16_t prev = (end - 1) & PEER_TABLE_MASK;
+        move_slot(end, prev); // One slot further from its home
+        end = prev;
+    }
+
+    peer_keys[slot] = key;
+    peer_meta[slot] = pack_meta(peer_info);
+    peer_track[slot] = 0;
+    slot_set_stability(slot, 1); // First detection
+#if CONTINUOUS_SCAN
+    slot_set_seen(slot);
+#endif
+    BIT_SET(peer_detected, slot);
+    BIT_CLR(peer_established, slot); // Not yet established
+    peer_rssi[slot] = (uint8_t)rssi_q1(rssi);
+    BIT_SET(peer_inside, slot); // Only inserted at or above the entry threshold
+    return true;
+}
+
+// Remove the peer at slot and pull the following displaced entries one slot back
+static void remove_slot(uint16_t slot) {
+    if (BIT_GET(peer_established, slot)) {
+        established_count[META_BUCKET(peer_meta[slot])]--;
+        core_count[META_BUCKET(peer_meta[slot])] -= peer_rssi[slot] >= PEER_CORE_Q1;
+    }
+    uint16_t next = (slot + 1) & PEER_TABLE_MASK;
+    while (slot_occupied(next) && slot_dist(next) > 0) {
+        move_slot(slot, next); // One slot closer to its home
+        slot = next;
+        next = (next + 1) & PEER_TABLE_MASK;
+    }
+    peer_meta[slot] = 0;
+    peer_track[slot] = 0;
+    BIT_CLR(peer_detected, slot);
+    BIT_CLR(peer_established, slot);
+    BIT_CLR(peer_inside, slot);
+    peer_count--;
+}
+
+// Fold a report into the smoothed RSSI of slot and move it across the hysteresis band:
+// in at enter_rssi, out below enter_rssi - RSSI_HYSTERESIS_DB. Returns whether it is in.
+static bool smooth_rssi(uint16_t slot, int8_t rssi, int8_t enter_rssi) {
+    int16_t smoothed = peer_rssi[slot];
+    smoothed += (rssi_q1(rssi) - smoothed + (1 << (PEER_RSSI_EWMA_SHIFT - 1))) >> PEER_RSSI_EWMA_SHIFT;
+    if (BIT_GET(peer_established, slot) && (peer_rssi[slot] >= PEER_CORE_Q1) != (smoothed >= PEER_CORE_Q1)) {
+        if (smoothed >= PEER_CORE_Q1) {
+            core_count[META_BUCKET(peer_meta[slot])]++;
+        } else {
+            core_count[META_BUCKET(peer_meta[slot])]--;
+        }
+    }
+    peer_rssi[slot] = (uint8_t)smoothed;
+
+    if (smoothed >= rssi_q1(enter_rssi)) {
+        BIT_SET(peer_inside, slot);
+    } else if (smoothed < rssi_q1(enter_rssi - RSSI_HYSTERESIS_DB) && BIT_GET(peer_inside, slot)) {
+        BIT_CLR(peer_inside, slot);
+        stats.rssi_exits++;
+    }
+    return BIT_GET(peer_inside, slot);
+}
+
+// Count peer and store its information into the hash table
+// This function is called by the zephyr handlers to count unique peers and store their information.
+// New peers need rssi >= enter_rssi; known ones keep being counted until their smoothed RSSI
+// falls out of the hysteresis band, and then simply age out like a peer that went silent.
+void count_peer(const uint8_t *mac, device_info_t *peer_info, int8_t rssi, int8_t enter_rssi) {
+    uint32_t key = peer_key(mac);
+    uint16_t insert_at;
+    uint16_t slot = find_slot(key, &insert_at);
+
+    if (slot != PEER_TABLE_SIZE) {
+        if (!smooth_rssi(slot, rssi, enter_rssi)) {
+            return; // Outside the band: not a sighting
+        }
+        // Update existing peer - only if not already detected this cycle
+        if (!BIT_GET(peer_detected, slot)) {
+            uint8_t meta = pack_meta(peer_info);
+            if (meta != peer_meta[slot] && BIT_GET(peer_established, slot)) {
+                established_count[META_BUCKET(peer_meta[slot])]--;
+                established_count[META_BUCKET(meta)]++;
+                if (peer_rssi[slot] >= PEER_CORE_Q1) {
+                    core_count[META_BUCKET(peer_meta[slot])]--;
+                    core_count[META_BUCKET(meta)]++;
+                }
+            }
+            peer_meta[slot] = meta;
+            BIT_SET(peer_detected, slot); // Mark as detected this cycle
+        }
+        return;
+    }
+
+    if (rssi < enter_rssi) {
+        return; // Too weak to start tracking
+    }
+    if (peer_count >= MAX_PEERS || insert_at == PEER_TABLE_SIZE) {
+        stats.dropped++; // Peer table is full, ignore this advertisement
+        return;
+    }
+    if (!insert_at_slot(insert_at, key, peer_info, rssi)) {
+        stats.dropped++; // Would push a neighbour past PEER_MAX_PROBE_LENGTH
+        return;
+    }
+    peer_count++;
+}
+
+// Check if a peer exists in the hash table
+bool peer_exists(const uint8_t *mac) {
+    uint16_t insert_at;
+    return find_slot(peer_key(mac), &insert_at) != PEER_TABLE_SIZE;
+}
+
+// Clear the entire peer table
+void clear_peer_table(void) {
+    memset(peer_meta, 0, sizeof(peer_meta));
+    memset(peer_track, 0, sizeof(peer_track));
+    memset(peer_detected, 0, sizeof(peer_detected));
+    memset(peer_established, 0, sizeof(peer_established));
+    memset(peer_inside, 0, sizeof(peer_inside));
+    memset(established_count, 0, sizeof(established_count));
+    memset(core_count, 0, sizeof(core_count));
+    peer_count = 0;
+}
+
+// Age peers based on detection flags and update stability counters.
+// With CONTINUOUS_SCAN this runs every PEER_EVAL_INTERVAL_MS: the stability counter
+// counts evaluator periods with a sighting, and peers are evicted once not heard
+// for PEER_SEEN_WINDOW_MS instead of after PEER_MISS_THRESHOLD missed cycles.
+void age_peers(void) {
+    uint32_t prof = prof_start();
+#if CONTINUOUS_SCAN
+    peer_tick++;
+#endif
+    // Start right after an empty slot (one always exists since MAX_PEERS < PEER_TABLE_SIZE):
+    // no cluster wraps past it, so backward shifts only ever pull not-yet-aged entries
+    // into the current slot, which is then examined again.
+    uint16_t start = 0;
+    while (slot_occupied(start)) {
+        start++;
+    }
+    uint8_t max_displacement = 0;
+    uint16_t established = 0;
+    uint16_t sighted = 0;
+
+    for (int n = 1; n <= PEER_TABLE_SIZE; n++) {
+        uint16_t i = (start + n) & PEER_TABLE_MASK;
+        if (!slot_occupied(i)) {
+            continue;
+        }
+        int8_t stability_counter = slot_stability(i);
+        if (BIT_GET(peer_established, i)) {
+            established++;
+#if CONTINUOUS_SCAN
+            // Heard within the last cycle
+            sighted += BIT_GET(peer_detected, i) || slot_seen_age(i) < PEER_CYCLE_TICKS;
+#else
+            sighted += BIT_GET(peer_detected, i);
+#endif
+        }
+        if (BIT_GET(peer_detected, i)) {
+            // Peer was detected this cycle
+#if CONTINUOUS_SCAN
+            slot_set_seen(i);
+#endif
+            if (stability_counter < 0) {
+                stability_counter = 1; // Reset to first detection after misses
+            } else if (stability_counter < PEER_ESTABLISH_THRESHOLD) {
+                stability_counter++; // Increment consecutive detections
+                
+                // Mark as established once threshold is reached
+                if (stability_counter >= PEER_ESTABLISH_THRESHOLD && !BIT_GET(peer_established, i)) {
+                    BIT_SET(peer_established, i);
+                    established_count[META_BUCKET(peer_meta[i])]++;
+                    core_count[META_BUCKET(peer_meta[i])] += peer_rssi[i] >= PEER_CORE_Q1;
+                }
+            }
+            BIT_CLR(peer_detected, i); // Reset flag for next cycle
+        } else {
+#if CONTINUOUS_SCAN
+            // Sliding window: evict once silent for PEER_SEEN_WINDOW_MS
+            if (slot_seen_age(i) >= PEER_SEEN_WINDOW_TICKS) {
+                remove_slot(i);
+                n--; // Re-examine slot i, it now holds the next entry of the cluster
+                continue;
+            }
+#else
+            // Peer was not detected this cycle
+            if (stability_counter > 0) {
+                stability_counter = -1; // Reset to first miss after detections
+            } else {
+                stability_counter--; // Increment consecutive misses (negative)
+            }
+            
+            // Remove peer if missed for PEER_MISS_THRESHOLD consecutive cycles
+            if (stability_counter <= -PEER_MISS_THRESHOLD) {
+                remove_slot(i);
+                n--; // Re-examine slot i, it now holds the next entry of the cluster
+                continue;
+            }
+#endif
+        }
+        slot_set_stability(i, stability_counter);
+        if (slot_dist(i) > max_displacement) {
+            max_displacement = slot_dist(i);
+        }
+    }
+    stats.max_displacement = max_displacement;
+    stats.cycle_established = established;
+    stats.cycle_sighted = sighted;
+    prof_stop(PROF_AGE_PEERS, prof);
+}
+
+// Add n peers with the given meta to counts[hostile/friendly][level]
+static void classify_for_device(uint16_t counts[2][LEVELS_PER_AFFINITY], uint8_t meta, uint8_t own_affinity, uint16_t n) {
+    uint8_t affinity = meta_affinity(meta);
+    uint8_t level = meta_level(meta);
+    // Maintain counts of levels for each affinity type using matrix
+    if (affinity == AFFINITY_UNITY) {
+        // Unity is the only affinity that can be friendly to all levels
+        counts[FRIENDLY_AURAS_IDX][split_unity_level(level, own_affinity)] += n;
+    } else if (affinity == own_affinity &&
+        level <= MAX_AURA_LEVEL) { 
+        counts[FRIENDLY_AURAS_IDX][level] += n;
+    } else if (own_affinity != AFFINITY_UNITY && level < LEVELS_PER_AFFINITY) {
+        // Unity is the only affinity that has no hostile auras
+        // If the peer's affinity is not friendly, count it as hostile
+        counts[HOSTILE_AURAS_IDX][level] += n;
+    }
+}
+
+// Add n peers with the given meta to counts[magic/techno][level]
+static void classify_for_overseer(uint16_t counts[2][LEVELS_PER_AFFINITY], uint8_t meta, uint16_t n) {
+    uint8_t affinity = meta_affinity(meta);
+    uint8_t level = meta_level(meta);
+    // Maintain counts of levels for each affinity type using matrix
+    if (affinity == AFFINITY_MAGIC) {
+        if (level < LEVELS_PER_AFFINITY) {
+            counts[MAGIC_AURAS_IDX][level] += n;
+        }
+    } else if (affinity == AFFINITY_TECHNO) { 
+        if (level < LEVELS_PER_AFFINITY) {
+            counts[TECHNO_AURAS_IDX][level] += n;
+        }
+    } else if (affinity == AFFINITY_UNITY) {
+        counts[MAGIC_AURAS_IDX][split_unity_level(level, AFFINITY_MAGIC)] += n;
+        counts[TECHNO_AURAS_IDX][split_unity_level(level, AFFINITY_TECHNO)] += n;
+    }
+}
+
+#ifdef MESH_DEBUG_CHECKS
+// Full-table recount, used to cross-check the incremental counters
+static void check_established_counts(void) {
+    uint16_t expected[PEER_BUCKETS] = {0};
+    uint16_t expected_core[PEER_BUCKETS] = {0};
+    for (uint16_t i = 0; i < PEER_TABLE_SIZE; i++) {
+        if (slot_occupied(i) && BIT_GET(peer_established, i)) {
+            expected[META_BUCKET(peer_meta[i])]++;
+            expected_core[META_BUCKET(peer_meta[i])] += peer_rssi[i] >= PEER_CORE_Q1;
+        }
+    }
+    MESH_ASSERT(memcmp(expected, established_count, sizeof(expected)) == 0);
+    MESH_ASSERT(memcmp(expected_core, core_count, sizeof(expected_core)) == 0);
+}
+#else
+static inline void check_established_counts(void) {}
+#endif
+
+// Count stable peers for device state calculations
+// Only includes peers detected for PEER_DETECTION_THRESHOLD consecutive cycles
+// O(PEER_BUCKETS): works from the incremental established_count buckets
+void count_stable_peers_for_calculations(uint16_t counts[2][LEVELS_PER_AFFINITY], uint8_t own_affinity) {
+    check_established_counts(); // Debug builds only, kept out of the profile
+    uint32_t prof = prof_start();
+    // Reset level counts
+    memset(counts, 0, 2 * LEVELS_PER_AFFINITY * sizeof(counts[0][0]));
+
+    for (uint8_t bucket = 0; bucket < PEER_BUCKETS; bucket++) {
+        if (established_count[bucket]) {
+            classify_for_device(counts, bucket, own_affinity, established_count[bucket]);
+        }
+    }
+    prof_stop(PROF_COUNT_STABLE, prof);
+}
+
+// Count stable peers for overseer calculations from a specific affinity perspective
+// This allows overseer to calculate states for each affinity independently
+void count_stable_peers_for_overseer_calculations(uint16_t counts[2][LEVELS_PER_AFFINITY]) {
+    check_established_counts(); // Debug builds only, kept out of the profile
+    uint32_t prof = prof_start();
+    // Reset level counts
+    memset(counts, 0, 2 * LEVELS_PER_AFFINITY * sizeof(counts[0][0]));
+
+    for (uint8_t bucket = 0; bucket < PEER_BUCKETS; bucket++) {
+        if (established_count[bucket]) {
+            classify_for_overseer(counts, bucket, established_count[bucket]);
+        }
+    }
+    prof_stop(PROF_COUNT_STABLE, prof);
+}
+
+// Overseer counts in half auras for pooling with other overseers: an established peer whose
+// smoothed RSSI is at least OVERSEER_SUMMARY_CORE_RSSI counts 2, a weaker one 1.
+// O(PEER_BUCKETS) like the flat counts, from established_count and core_count.
+void count_stable_peers_for_overseer_summary(uint16_t counts[2][LEVELS_PER_AFFINITY]) {
+    check_established_counts(); // Debug builds only, kept out of the profile
+    uint32_t prof = prof_start();
+    memset(counts, 0, 2 * LEVELS_PER_AFFINITY * sizeof(counts[0][0]));
+
+    for (uint8_t bucket = 0; bucket < PEER_BUCKETS; bucket++) {
+        if (established_count[bucket]) {
+            classify_for_overseer(counts, bucket, established_count[bucket] + core_count[bucket]);
+        }
+    }
+    prof_stop(PROF_COUNT_STABLE, prof);
+}
+
+// Split unity level into magic and techno components
+// For Unity, it returns the biggest part
+uint8_t split_unity_level(uint8_t level, affinity_t target_affinity) {
+    switch (target_affinity)
+    {
+    case AFFINITY_MAGIC:
+        return (level >> 4) & 0x0F;
+    case AFFINITY_TECHNO:
+        return level & 0x0F;
+    case AFFINITY_UNITY:
+    default:
+        break;
+    }
+    uint8_t magic_level = (level >> 4) & 0x0F; // Magic part
+    uint8_t techno_level = level & 0x0F; // Techno part
+    return magic_level > techno_level ? magic_level : techno_level;
+}
+
+const peer_table_stats_t *peer_table_stats(void) {
+    return &stats;
+}
+
+void peer_table_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
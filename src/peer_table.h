@@ -0,0 +1,65 @@
+/* peer_table.h - Peer hash table used by device and overseer modes */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PEER_TABLE_H
+#define PEER_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+#include "defines.h"
+
+// Open addressing with linear probing, Robin Hood insertion and backward-shift
+// deletion: evicted peers leave no tombstones, and no entry is ever stored more
+// than PEER_MAX_PROBE_LENGTH - 1 slots away from its home slot, so every lookup
+// visits at most PEER_MAX_PROBE_LENGTH slots regardless of churn.
+// Storage is struct-of-arrays (see peer_table.c) to fit 400+ peers in ~4KB.
+
+// Probe statistics, updated on every count_peer/peer_exists lookup
+typedef struct {
+    uint32_t lookups; // Number of lookups
+    uint32_t probes; // Total slots visited by all lookups
+    uint8_t max_probe; // Longest probe sequence seen
+    uint8_t max_displacement; // Largest probe_dist currently stored (updated by age_peers)
+    uint32_t dropped; // New peers refused: table full or probe bound would be exceeded
+    uint32_t probe_histogram[PEER_MAX_PROBE_LENGTH + 1]; // Lookups by number of slots visited
+    uint16_t cycle_established; // Established peers at the last age_peers call
+    uint16_t cycle_sighted; // How many of those were detected in that cycle
+    uint32_t rssi_exits; // Peers whose smoothed RSSI fell out of the hysteresis band
+} peer_table_stats_t;
+
+extern uint16_t peer_count; // Number of discovered peers
+
+uint16_t hash_mac(const uint8_t *mac);
+// Sighting of an aura at rssi; enter_rssi is the threshold for starting to count it (see peer_table.c)
+void count_peer(const uint8_t *mac, device_info_t *peer_info, int8_t rssi, int8_t enter_rssi);
+bool peer_exists(const uint8_t *mac);
+void clear_peer_table(void);
+void age_peers(void);
+
+// Fill counts[hostile/friendly][level] from the point of view of own_affinity
+void count_stable_peers_for_calculations(uint16_t counts[2][LEVELS_PER_AFFINITY], uint8_t own_affinity);
+// Fill counts[magic/techno][level] for overseer calculations
+void count_stable_peers_for_overseer_calculations(uint16_t counts[2][LEVELS_PER_AFFINITY]);
+// Same in half auras: peers weaker than OVERSEER_SUMMARY_CORE_RSSI count 1, the others 2
+void count_stable_peers_for_overseer_summary(uint16_t counts[2][LEVELS_PER_AFFINITY]);
+
+// Split unity level into magic and techno components
+uint8_t split_unity_level(uint8_t level, affinity_t target_affinity);
+
+const peer_table_stats_t *peer_table_stats(void);
+void peer_table_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PEER_TABLE_H */
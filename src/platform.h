@@ -0,0 +1,69 @@
+/* platform.h - Thin platform shim used by the portable mesh core */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+
+// The core (peer_table.c, mesh_core.c) never talks to Zephyr directly.
+// Everything it needs from the board goes through these functions:
+// main.c implements them for the firmware, host/platform_host.c for Linux builds.
+
+#ifndef likely
+#define likely(x) __builtin_expect(!!(x), 1)
+#endif
+#ifndef unlikely
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+// Debug-only consistency checks (e.g. incremental counters vs. full recount):
+// on with CONFIG_ASSERT on target, and in host builds without NDEBUG.
+#ifdef __ZEPHYR__
+#include <zephyr/sys/__assert.h>
+#define MESH_ASSERT(cond) __ASSERT_NO_MSG(cond)
+#if defined(CONFIG_ASSERT)
+#define MESH_DEBUG_CHECKS 1
+#endif
+#else
+#include <assert.h>
+#define MESH_ASSERT(cond) assert(cond)
+#if !defined(NDEBUG)
+#define MESH_DEBUG_CHECKS 1
+#endif
+#endif
+
+// Drive the device output pin (active high)
+void platform_set_output_pin(bool state);
+// Set LED state by index (see *_LED_PIN in defines.h)
+void platform_set_led_state(int led_idx, enum led_state state);
+// Start the mode-change LED animation (STARTUP_DELAY_MS), must not block
+void platform_mode_transition(void);
+// A master advert changed device_info, ask the platform to call set_mode soon
+void platform_request_mode_change(void);
+// Persist device_info after a master reconfiguration
+void platform_store_device_info(const device_info_t *info);
+// Provisioner queue entry index (PROVISION_RECORD_LEN bytes, see config_store.h),
+// false past the end of the queue area. Erased flash (all 0xFF) ends the queue.
+bool platform_read_provision_record(uint16_t index, uint8_t *record);
+// Fill the platform's counters for a telemetry advert
+void platform_get_telemetry(platform_telemetry_t *telemetry);
+// Free-running counter for the cycle profiler (wraps at 32 bits), and its rate in Hz
+uint32_t platform_cycles(void);
+uint32_t platform_cycles_per_sec(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PLATFORM_H */
@@ -0,0 +1,63 @@
+/* profiler.c - Log2 histograms of cycle phase and handler run times */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "profiler.h"
+
+#if CYCLE_PROFILER
+
+// Each probe is recorded from one context only (scan_cb from BT RX, the rest
+// from the cycle work item or under core_lock), so no locking is needed.
+static prof_histogram_t histograms[PROF_PROBE_COUNT];
+
+// Bucket of a duration: 0 for 0, else 1 + floor(log2(cycles))
+static uint8_t prof_bucket(uint32_t cycles) {
+    return cycles ? (uint8_t)(32 - __builtin_clz(cycles)) : 0;
+}
+
+void prof_record(prof_probe_t probe, uint32_t cycles) {
+    prof_histogram_t *h = &histograms[probe];
+    uint8_t bucket = prof_bucket(cycles);
+    if (bucket >= PROF_BUCKETS) {
+        bucket = PROF_BUCKETS - 1;
+    }
+    if (h->buckets[bucket] < UINT16_MAX) {
+        h->buckets[bucket]++;
+    }
+    h->count++;
+    if (cycles > h->max) {
+        h->max = cycles;
+    }
+}
+
+const prof_histogram_t *prof_histogram(prof_probe_t probe) {
+    return &histograms[probe];
+}
+
+uint8_t prof_percentile_bucket(prof_probe_t probe, uint8_t pct) {
+    const prof_histogram_t *h = &histograms[probe];
+    uint32_t total = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        total += h->buckets[b]; // Bucket counts, not h->count: buckets saturate
+    }
+    uint32_t target = (total * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen && seen >= target) {
+            return (uint8_t)b;
+        }
+    }
+    return 0;
+}
+
+void prof_reset(void) {
+    memset(histograms, 0, sizeof(histograms));
+}
+
+#endif
@@ -0,0 +1,87 @@
+/* profiler.h - Log2 histograms of cycle phase and handler run times */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "platform.h"
+#include "defines.h"
+
+// Every probe keeps a histogram of durations in platform_cycles() units:
+// bucket b counts durations in [2^(b-1), 2^b), bucket 0 counts zero. With
+// CYCLE_PROFILER off the calls compile away and the histograms take no RAM.
+
+typedef enum {
+    PROF_ADV_START, // CYCLE_ADV_START phase: refresh_adv, load_scan
+    PROF_JITTER, // Elapsed from the end of CYCLE_ADV_START to scan start (planned: the jitter)
+    PROF_SCAN_WINDOW, // Elapsed from scan start to CYCLE_SCAN_STOP (planned: the scan window)
+    PROF_SCAN_STOP, // CYCLE_SCAN_STOP phase: bt_le_scan_stop
+    PROF_END_OF_CYCLE, // mesh_core_end_of_cycle
+    PROF_AGE_PEERS, // age_peers
+    PROF_COUNT_STABLE, // count_stable_peers_for_calculations / _for_overseer_calculations
+    PROF_SET_MODE, // set_mode, without the LED animation
+    PROF_SCAN_CB, // scan_cb, BT RX context
+    PROF_CYCLE, // Cycle period, CYCLE_ADV_START to CYCLE_ADV_START (evaluator period with CONTINUOUS_SCAN)
+    PROF_PROBE_COUNT
+} prof_probe_t;
+
+typedef struct {
+    uint16_t buckets[PROF_BUCKETS]; // Saturate at UINT16_MAX
+    uint32_t count; // Samples recorded
+    uint32_t max; // Longest sample
+} prof_histogram_t;
+
+#if CYCLE_PROFILER
+
+// Record one sample of a probe
+void prof_record(prof_probe_t probe, uint32_t cycles);
+// Histogram of a probe, NULL with CYCLE_PROFILER off
+const prof_histogram_t *prof_histogram(prof_probe_t probe);
+// Bucket holding the pct-th percentile sample (0 if the probe has none)
+uint8_t prof_percentile_bucket(prof_probe_t probe, uint8_t pct);
+void prof_reset(void);
+
+// Timestamp for prof_stop
+static inline uint32_t prof_start(void) {
+    return platform_cycles();
+}
+
+// Record the cycles elapsed since a prof_start timestamp
+static inline void prof_stop(prof_probe_t probe, uint32_t start) {
+    prof_record(probe, platform_cycles() - start);
+}
+
+#else
+
+static inline void prof_record(prof_probe_t probe, uint32_t cycles) {}
+static inline const prof_histogram_t *prof_histogram(prof_probe_t probe) { return 0; }
+static inline uint8_t prof_percentile_bucket(prof_probe_t probe, uint8_t pct) { return 0; }
+static inline void prof_reset(void) {}
+static inline uint32_t prof_start(void) { return 0; }
+static inline void prof_stop(prof_probe_t probe, uint32_t start) {}
+
+#endif
+
+// Probe name for printouts
+static inline const char *prof_probe_name(prof_probe_t probe) {
+    static const char *const names[PROF_PROBE_COUNT] = {
+        "adv_start", "jitter", "scan_window", "scan_stop", "end_of_cycle",
+        "age_peers", "count_stable", "set_mode", "scan_cb", "cycle",
+    };
+    return probe < PROF_PROBE_COUNT ? names[probe] : "?";
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROFILER_H */
@@ -25,7 +25,9 @@ typedef enum {
     // Level-up token mode, used to level up aura pendants
     MODE_LVLUP_TOKEN,
     // Overseer mode, broadcasts device states to surrounding devices
-    MODE_OVERSEER
+    MODE_OVERSEER,
+    // Provisioner mode, configures the devices of a queue stored in flash
+    MODE_PROVISIONER
 } operation_mode_t;
 
 typedef enum {
@@ -39,24 +41,9 @@ typedef struct {
     uint8_t affinity; // affinity_t
     uint8_t level; // 0 to 3, 4 = hostile environment
     int8_t dynamic_rssi_threshold; // Dynamic RSSI threshold (0 = disabled, use default)
-} device_info_t;
-
-typedef enum {
-    PEER_SLOT_EMPTY = 0,   // Never used
-    PEER_SLOT_OCCUPIED,    // Currently used
-    PEER_SLOT_DELETED      // Previously used, now deleted
-} peer_slot_state_t;
-
-typedef struct peer {
-    peer_slot_state_t state; // Slot state for open addressing
-    uint8_t mac[6]; // MAC address
-    uint8_t affinity; // affinity_t (removed mode to save memory)
-    uint8_t level; // 0 to 3, 4 = hostile environment
-    int8_t stability_counter; // Positive: consecutive detections, Negative: consecutive misses
-    uint8_t detected_this_cycle : 1; // Flag set if detected in current cycle
-    uint8_t is_established : 1; // Flag set once peer reaches PEER_DETECTION_THRESHOLD
-    uint8_t reserved : 6; // Reserved bits for future use
-} peer_t;
+    uint8_t zone; // Overseer zone this device follows / overseer drives (0 = default zone)
+    uint8_t group; // Group addressed by group master adverts (0 = none)
+} device_info_t; // Only the first DEVICE_INFO_ADV_LEN bytes travel in MASTER adverts
 
 typedef struct {
     uint8_t is_on;
@@ -80,20 +67,111 @@ typedef struct {
 typedef struct {
     uint8_t mac[6]; // MAC address of receiving aura pendant
     device_info_t device_info; // Device info to broadcast
-    uint8_t broadcast_countdown; // Countdown for broadcasting
+    int8_t best_rssi; // Strongest qualifying aura of this burst (the target)
+    uint8_t has_target; // Set once a receiving aura pendant has been found
+    uint8_t handing_over; // Master advert on air, waiting for the target's new MESH advert
+    uint8_t cycles_left; // Cycles until an unconfirmed hand-over is given up
+    uint8_t confirmed; // Target advertised the new level
+    uint8_t discharged; // Used up (all levels but 1)
 } mode_lvlup_token_state_t;
 
+// State vector of one overseer zone: bit n = magic level n ON, bit 4+n = techno level n ON
+typedef struct {
+    uint8_t zone; // Zone ID
+    uint8_t states; // Packed per-level states
+    uint8_t age; // Cycles since last heard, 0 = unused entry
+} overseer_zone_t;
+
+// Established aura counts of one overseer, as carried by an overseer summary advert
+typedef struct {
+    uint32_t origin; // 24-bit ID of the counting overseer, the low three bytes of its MAC unless they collided
+    uint8_t hops; // On air: relays so far. Stored: overseers from the origin to us, us included
+    uint8_t age; // Cycles since last heard, 0 = unused entry
+    uint8_t counts[2][4]; // [MAGIC/TECHNO_AURAS_IDX][level - 1], half auras, saturating (OVERSEER_SUMMARY_LEVELS)
+} overseer_summary_t;
+
 typedef struct {
     uint8_t broadcast_countdown; // Countdown for broadcasting device states
+    uint8_t states; // Own zone states from the last decision
+    overseer_zone_t relay[3]; // Other overseers' zones repeated in our V2 advert (OVERSEER_V2_MAX_ZONES - 1)
+    uint8_t summary_countdown; // Cycles until the next summary advert
+    uint8_t summary_turn; // Odd summary adverts relay someone else's summary
+    uint8_t summary_relay_next; // Round robin: the entry to try first on the next relay turn
+    uint32_t summary_origin; // Our own summary origin
+    uint32_t retired_origin; // Origin given up after a collision, its copies are still being relayed
+    overseer_summary_t summaries[6]; // Summaries heard from other overseers (OVERSEER_SUMMARY_SLOTS)
 } mode_overseer_state_t;
 
+// One provisioner assignment in progress
+typedef struct {
+    uint8_t mac[6]; // Target
+    device_info_t device_info; // Configuration to give it
+    uint16_t index; // Queue entry
+    uint8_t attempts; // 1 + master adverts sent, 0 = unused slot
+    uint8_t wait; // Cycles until the next master advert
+} provision_slot_t;
+
+// Provisioner progress, reported in provision telemetry
+typedef struct {
+    uint16_t queued; // Valid entries in the queue
+    uint16_t confirmed; // ... confirmed by the target's advert
+    uint16_t attempts; // Master adverts sent
+    uint16_t deferred; // Entries given up after PROVISION_MAX_ATTEMPTS, retried on the next pass
+} provision_stats_t;
+
+typedef struct {
+    provision_slot_t slots[4]; // PROVISION_SLOTS, attempts = 0 for a free slot
+    uint8_t confirmed[32]; // One bit per queue entry (PROVISION_QUEUE_MAX)
+    uint16_t next_index; // Next queue entry to give a free slot
+    uint8_t turn; // Round robin over the slots
+    provision_stats_t stats;
+} mode_provisioner_state_t;
+
 typedef union {
     mode_device_state_t device;
     mode_aura_state_t aura;
     mode_lvlup_token_state_t lvlup_token;
     mode_overseer_state_t overseer;
+    mode_provisioner_state_t provisioner;
 } mode_state_t;
 
+// LED states (shared between the LED manager and the portable core)
+enum led_state {
+    LED_OFF,
+    LED_ON,
+    LED_BLINK_FAST,
+    LED_BLINK_ONCE
+};
+
+// Advertisement currently requested by the core
+typedef struct {
+    uint8_t data[16]; // Manufacturer data payload
+    uint8_t len; // Payload length in bytes
+    uint8_t telemetry[20]; // Telemetry payload (TELEMETRY_ADV_LEN), a second manufacturer data structure
+    uint8_t telemetry_len; // 0 = no telemetry on air
+    uint16_t interval_min; // Advertising interval min (0.625ms units)
+    uint16_t interval_max; // Advertising interval max (0.625ms units)
+} mesh_adv_t;
+
+// Counters kept by the platform for the telemetry advert (see platform_get_telemetry)
+typedef struct {
+    uint32_t uptime_s; // Seconds since boot
+    uint32_t reports_received; // Scan reports that reached scan_cb
+    uint32_t reports_rssi_rejected; // ... of which mesh_core_find_payload dropped below RSSI_SCAN_GATE
+    uint16_t adv_start_failures; // bt_le_adv_start/update_data errors
+    uint16_t scan_start_failures; // bt_le_scan_start errors
+    uint16_t cycle_overruns; // Cycles that ended CYCLE_OVERRUN_SLACK_MS or more late
+    int8_t last_error; // Last ERROR_* code (errors.h)
+} platform_telemetry_t;
+
+// Scan settings requested by the core
+typedef struct {
+    uint8_t filter_duplicates; // Let the controller drop repeat reports (filter is reset every cycle)
+    uint16_t interval; // Scan interval (0.625ms units)
+    uint16_t window; // Scan window (0.625ms units), window/interval is the radio duty cycle
+    uint16_t duration_ms; // Scan time per cycle, jitter included
+} mesh_scan_t;
+
 
 #ifdef __cplusplus
 }
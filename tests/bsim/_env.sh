@@ -0,0 +1,46 @@
+# SPDX-License-Identifier: Apache-2.0
+
+# Common settings of the BabbleSim scenarios, sourced by compile.sh and every
+# script in scenarios/. Needs ZEPHYR_BASE, BSIM_OUT_PATH and BSIM_COMPONENTS_PATH
+# as for Zephyr's own bsim tests.
+
+: "${ZEPHYR_BASE:?ZEPHYR_BASE must be set}"
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be set}"
+
+EXECUTE_TIMEOUT=${EXECUTE_TIMEOUT:-600} # Wall clock seconds per process
+source ${ZEPHYR_BASE}/tests/bsim/sh_common.source
+
+BSIM_TESTS_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+BOARD=${BOARD:-nrf52_bsim}
+BOARD_TS=${BOARD//\//_}
+BUILD_DIR=${BUILD_DIR:-${BSIM_TESTS_DIR}/build}
+DUT_EXE=${BSIM_OUT_PATH}/bin/bs_${BOARD_TS}_aura_mesh_dut
+ACTOR_EXE=${BSIM_OUT_PATH}/bin/bs_${BOARD_TS}_aura_mesh_actor
+PHY_EXE=${BSIM_OUT_PATH}/bin/bs_2G4_phy_v1
+verbosity_level=${verbosity_level:-2}
+
+# Channel attenuation between two nodes, dB. Every node transmits at -20 dBm
+# (CONFIG_BT_CTLR_TX_PWR_MINUS_20), so the RSSI is -20 - attenuation.
+ATT_TOUCH=20 # -40 dBm, inside LVLUP_TOKEN_RSSI_THRESHOLD (-45)
+ATT_NEAR=30 # -50 dBm, well inside RSSI_THRESHOLD (-70)
+ATT_FAR=100 # -120 dBm, never heard: every pair not listed
+
+# Write the multiatt channel file for this simulation and print its path.
+# Each argument is "<device> <device> <attenuation>", applied both ways.
+att_file() {
+    local file=${BUILD_DIR}/${simulation_id}.att
+    mkdir -p ${BUILD_DIR}
+    : > ${file}
+    for pair in "$@"; do
+        read -r a b att <<< "${pair}"
+        echo "${a} ${b} : ${att}" >> ${file}
+        echo "${b} ${a} : ${att}" >> ${file}
+    done
+    echo ${file}
+}
+
+# run_phy <device count> <simulated seconds> <attenuation file>
+run_phy() {
+    Execute ${PHY_EXE} -v=${verbosity_level} -s=${simulation_id} -D=$1 -sim_length=$(($2 * 1000000)) \
+        -channel=multiatt -argschannel -at=${ATT_FAR} -file=$3
+}
@@ -0,0 +1,214 @@
+/* bsim_actor.c - Scripted nodes of the BabbleSim scenarios */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * An actor stands for whatever the scenario moves around: it puts one MESH or
+ * OVERSEER advert on air between on= and off= (an aura walking into range and
+ * out again, an overseer taking over a zone), and it scans the whole time to
+ * time what the firmware nodes do about it:
+ *
+ *   watch=<mode> expect=<at_ms>,<state>,<limit_ms>
+ *       first MESH advert from a node in <mode> carrying <state>
+ *   master=<limit_ms>
+ *       first MASTER advert addressed to this actor after on= (a level-up
+ *       token handing over its level)
+ *
+ * Test ids: "aura" (MESH advert), "overseer" (V2 advert), "probe" (scan only).
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+#include "bs_tracing.h"
+#include "bstests.h"
+
+#include "adv_codec.h"
+#include "bsim_scenario.h"
+#include "types.h"
+#include "defines.h"
+
+static device_info_t actor_info = { .mode = MODE_AURA };
+static uint8_t actor_state = 1;
+static uint8_t overseer_zone;
+static uint8_t overseer_states;
+static int64_t on_ms;
+static int64_t off_ms; // 0 = stay on air until the end
+static bool is_overseer;
+static bool advertises;
+static const char *actor_role;
+
+static int watch_mode = -1; // MESH adverts of this mode feed watch_expect
+static bsim_expect_t watch_expect[BSIM_MAX_EXPECT];
+static int watch_expect_count;
+static int64_t master_limit_ms = -1; // -1 = not checked
+static bsim_expect_t master_expect[1];
+static int master_expect_count;
+
+static bt_addr_le_t own_addr;
+
+static void actor_args(const char *role, int argc, char *argv[]) {
+    actor_role = role;
+    for (int i = 0; i < argc; i++) {
+        const char *value;
+        if ((value = bsim_arg(argv[i], "mode"))) {
+            actor_info.mode = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "affinity"))) {
+            actor_info.affinity = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "level"))) {
+            actor_info.level = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "state"))) {
+            actor_state = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "zone"))) {
+            overseer_zone = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "states"))) {
+            overseer_states = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "on"))) {
+            on_ms = bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "off"))) {
+            off_ms = bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "watch"))) {
+            watch_mode = (int)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "expect"))) {
+            if (!bsim_expect_add(watch_expect, &watch_expect_count, value)) {
+                bs_trace_error_line("bad expect=%s\n", value);
+            }
+        } else if ((value = bsim_arg(argv[i], "master"))) {
+            master_limit_ms = bsim_arg_long(value);
+        } else {
+            bs_trace_error_line("unknown argument %s\n", argv[i]);
+        }
+    }
+    if (master_limit_ms >= 0) {
+        master_expect[0] = (bsim_expect_t){ .at_ms = on_ms, .state = 1, .limit_ms = master_limit_ms, .seen_ms = -1 };
+        master_expect_count = 1;
+    }
+}
+
+static void actor_args_aura(int argc, char *argv[]) {
+    advertises = true;
+    actor_args("aura", argc, argv);
+}
+
+static void actor_args_overseer(int argc, char *argv[]) {
+    advertises = true;
+    is_overseer = true;
+    actor_args("overseer", argc, argv);
+}
+
+static void actor_args_probe(int argc, char *argv[]) {
+    actor_args("probe", argc, argv);
+}
+
+static void scan_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t adv_type, struct net_buf_simple *buf) {
+    const uint8_t *payload;
+    uint8_t len;
+    device_info_t info;
+    uint8_t state;
+    const uint8_t *target_mac;
+    bool has_zone;
+    int64_t now = k_uptime_get();
+
+    switch (adv_parse(buf->data, buf->len, &payload, &len)) {
+    case ADV_KIND_MESH:
+        if (adv_mesh_decode(payload, len, &info, &state) && info.mode == watch_mode) {
+            bsim_expect_observe(watch_expect, watch_expect_count, state, now);
+        }
+        break;
+    case ADV_KIND_MASTER:
+        if (adv_master_decode(payload, len, &target_mac, &info, &has_zone) &&
+            !memcmp(target_mac, own_addr.a.val, MAC_LEN)) {
+            bsim_expect_observe(master_expect, master_expect_count, 1, now);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void actor_main(void) {
+    struct bt_le_scan_param scan_param = {
+        .type = BT_LE_SCAN_TYPE_PASSIVE,
+        .options = BT_LE_SCAN_OPT_NONE, // Every advert, state changes must not be filtered
+        .interval = SCAN_FULL_INTERVAL,
+        .window = SCAN_FULL_WINDOW,
+    };
+    uint8_t data[ADV_RECORD_MAX_DATA];
+    uint8_t len;
+    size_t count = 1;
+
+    if (bt_enable(NULL)) {
+        bs_trace_error_line("bt_enable failed\n");
+    }
+    bt_id_get(&own_addr, &count);
+    if (bt_le_scan_start(&scan_param, scan_cb)) {
+        bs_trace_error_line("scan start failed\n");
+    }
+    if (!advertises) {
+        return;
+    }
+
+    if (is_overseer) {
+        len = adv_overseer_v2_encode(data, &overseer_zone, &overseer_states, 1);
+    } else {
+        len = adv_mesh_encode(data, &actor_info, actor_state);
+    }
+    struct bt_data ad[] = {
+        BT_DATA(BT_DATA_MANUFACTURER_DATA, data, len),
+    };
+
+    k_sleep(K_TIMEOUT_ABS_MS(on_ms));
+    if (bt_le_adv_start(BT_LE_ADV_PARAM(BT_LE_ADV_OPT_USE_IDENTITY, ADV_SLOW_INT_MIN, ADV_SLOW_INT_MAX, NULL),
+                        ad, ARRAY_SIZE(ad), NULL, 0)) {
+        bs_trace_error_line("adv start failed\n");
+    }
+    if (off_ms > 0) {
+        k_sleep(K_TIMEOUT_ABS_MS(off_ms));
+        bt_le_adv_stop();
+    }
+}
+
+static void actor_delete(void) {
+    bool ok = bsim_expect_report(actor_role, watch_expect, watch_expect_count);
+    ok = bsim_expect_report("master", master_expect, master_expect_count) && ok;
+    bst_result = ok ? Passed : Failed;
+}
+
+static const struct bst_test_instance actor_tests[] = {
+    {
+        .test_id = "aura",
+        .test_descr = "MESH advert between on= and off=",
+        .test_args_f = actor_args_aura,
+        .test_main_f = actor_main,
+        .test_delete_f = actor_delete,
+    },
+    {
+        .test_id = "overseer",
+        .test_descr = "OVERSEER V2 advert for one zone between on= and off=",
+        .test_args_f = actor_args_overseer,
+        .test_main_f = actor_main,
+        .test_delete_f = actor_delete,
+    },
+    {
+        .test_id = "probe",
+        .test_descr = "Scan only, times the firmware's adverts",
+        .test_args_f = actor_args_probe,
+        .test_main_f = actor_main,
+        .test_delete_f = actor_delete,
+    },
+    BSTEST_END_MARKER
+};
+
+static struct bst_test_list *actor_install(struct bst_test_list *tests) {
+    return bst_add_tests(tests, actor_tests);
+}
+
+bst_test_install_t test_installers[] = { actor_install, NULL };
+
+int main(void) {
+    bst_main();
+    return 0;
+}
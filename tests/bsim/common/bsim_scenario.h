@@ -0,0 +1,106 @@
+/* bsim_scenario.h - Argument parsing and latency expectations shared by the BabbleSim images */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BSIM_SCENARIO_H
+#define BSIM_SCENARIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/sys/printk.h>
+
+// Scenario arguments are key=value words after -argstest, e.g.
+//   -argstest affinity=1 level=1 expect=20000,1,12000
+//
+// An expectation is "<at_ms>,<state>,<limit_ms>": the first observation of
+// <state> at or after <at_ms> (simulated time, all devices boot at 0) gives the
+// latency, which must not exceed <limit_ms>. What is observed depends on the
+// image: output pin writes on the firmware, advert state on the actor.
+
+#define BSIM_MAX_EXPECT 4
+
+typedef struct {
+    int64_t at_ms; // Scripted event time
+    uint8_t state; // State the observed node must reach
+    int64_t limit_ms; // Latency budget
+    int64_t seen_ms; // First matching observation, -1 = none yet
+} bsim_expect_t;
+
+// Value of "key=value" if arg has that key
+static inline const char *bsim_arg(const char *arg, const char *key) {
+    size_t len = strlen(key);
+    if (strncmp(arg, key, len) || arg[len] != '=') {
+        return NULL;
+    }
+    return arg + len + 1;
+}
+
+static inline long bsim_arg_long(const char *value) {
+    return strtol(value, NULL, 0); // Accepts 0x.. for state bytes
+}
+
+// Append an expectation parsed from "<at_ms>,<state>,<limit_ms>", false if malformed or full
+static inline bool bsim_expect_add(bsim_expect_t *expect, int *count, const char *value) {
+    char *end;
+    if (*count >= BSIM_MAX_EXPECT) {
+        return false;
+    }
+    bsim_expect_t *e = &expect[*count];
+    e->at_ms = strtoll(value, &end, 0);
+    if (*end != ',') {
+        return false;
+    }
+    e->state = (uint8_t)strtol(end + 1, &end, 0);
+    if (*end != ',') {
+        return false;
+    }
+    e->limit_ms = strtoll(end + 1, &end, 0);
+    if (*end != '\0') {
+        return false;
+    }
+    e->seen_ms = -1;
+    (*count)++;
+    return true;
+}
+
+// Feed one observation of the node's state at now_ms
+static inline void bsim_expect_observe(bsim_expect_t *expect, int count, uint8_t state, int64_t now_ms) {
+    for (int i = 0; i < count; i++) {
+        if (expect[i].seen_ms < 0 && now_ms >= expect[i].at_ms && state == expect[i].state) {
+            expect[i].seen_ms = now_ms;
+        }
+    }
+}
+
+// Print one LATENCY line per expectation (collected by run_all.sh), true if all were met in time
+static inline bool bsim_expect_report(const char *who, const bsim_expect_t *expect, int count) {
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        const bsim_expect_t *e = &expect[i];
+        bool met = e->seen_ms >= 0 && e->seen_ms - e->at_ms <= e->limit_ms;
+        if (e->seen_ms >= 0) {
+            printk("LATENCY %s at=%lld state=%u latency_ms=%lld limit_ms=%lld %s\n", who, (long long)e->at_ms,
+                   e->state, (long long)(e->seen_ms - e->at_ms), (long long)e->limit_ms, met ? "ok" : "FAIL");
+        } else {
+            printk("LATENCY %s at=%lld state=%u latency_ms=- limit_ms=%lld FAIL\n", who, (long long)e->at_ms,
+                   e->state, (long long)e->limit_ms);
+        }
+        ok = ok && met;
+    }
+    return ok;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BSIM_SCENARIO_H */
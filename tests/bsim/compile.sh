@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# Build the firmware image (dut/) and the scenario actor (actor/) for
+# nrf52_bsim and install them next to the BabbleSim Phy.
+
+set -ue
+source "$(dirname "${BASH_SOURCE[0]}")/_env.sh"
+
+for app in dut actor; do
+    west build -p auto -b ${BOARD} -d ${BUILD_DIR}/${app} ${BSIM_TESTS_DIR}/${app}
+    cp ${BUILD_DIR}/${app}/zephyr/zephyr.exe ${BSIM_OUT_PATH}/bin/bs_${BOARD_TS}_aura_mesh_${app}
+done
@@ -0,0 +1,174 @@
+/* bsim_dut.c - Scenario hooks linked into the unchanged firmware image */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * main(), main_loop(), scan_cb() and the Zephyr BT host/controller run exactly
+ * as on target. The hooks only do two things:
+ *
+ * - Provision: the test id picks the mode, -argstest the rest of device_info.
+ *   It is written to NVS from an APPLICATION level SYS_INIT, after the flash
+ *   driver is up and before main() reads it back, the way older firmware
+ *   left it; main() moves it to the config page on the way.
+ * - Observe: mesh_core.c is compiled with platform_set_output_pin renamed to
+ *   bsim_dut_output_pin (see CMakeLists.txt). Every pin write is timestamped
+ *   against the expect= arguments, then forwarded to main.c's implementation.
+ *
+ * Advert changes are observed on air by the actor image (probe role). The
+ * image is built with CYCLE_PROFILER, its phase histograms are printed at the
+ * end as PROFILE lines.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "bs_tracing.h"
+#include "bstests.h"
+
+#include "bsim_scenario.h"
+#include "platform.h"
+#include "profiler.h"
+#include "types.h"
+#include "defines.h"
+
+static device_info_t dut_info;
+static bool dut_provisioned; // A scenario test id was given, write dut_info before main()
+static const char *dut_role;
+static bsim_expect_t pin_expect[BSIM_MAX_EXPECT];
+static int pin_expect_count;
+
+// --- Observation ---
+
+void bsim_dut_output_pin(bool state) {
+    bsim_expect_observe(pin_expect, pin_expect_count, state, k_uptime_get());
+    platform_set_output_pin(state);
+}
+
+// --- Provisioning ---
+
+static void dut_args(operation_mode_t mode, const char *role, int argc, char *argv[]) {
+    dut_info.mode = mode;
+    dut_role = role;
+    for (int i = 0; i < argc; i++) {
+        const char *value;
+        if ((value = bsim_arg(argv[i], "affinity"))) {
+            dut_info.affinity = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "level"))) {
+            dut_info.level = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "rssi"))) {
+            dut_info.dynamic_rssi_threshold = (int8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "zone"))) {
+            dut_info.zone = (uint8_t)bsim_arg_long(value);
+        } else if ((value = bsim_arg(argv[i], "expect"))) {
+            if (!bsim_expect_add(pin_expect, &pin_expect_count, value)) {
+                bs_trace_error_line("bad expect=%s\n", value);
+            }
+        } else {
+            bs_trace_error_line("unknown argument %s\n", argv[i]);
+        }
+    }
+    dut_provisioned = true;
+}
+
+static void dut_args_aura(int argc, char *argv[]) {
+    dut_args(MODE_AURA, "aura", argc, argv);
+}
+
+static void dut_args_device(int argc, char *argv[]) {
+    dut_args(MODE_DEVICE, "device", argc, argv);
+}
+
+static void dut_args_token(int argc, char *argv[]) {
+    dut_args(MODE_LVLUP_TOKEN, "token", argc, argv);
+}
+
+static void dut_args_overseer(int argc, char *argv[]) {
+    dut_args(MODE_OVERSEER, "overseer", argc, argv);
+}
+
+static int dut_provision(void) {
+    const struct device *dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_flash_controller));
+    struct nvs_fs fs = {
+        .offset = FLASH_AREA_OFFSET(storage_partition),
+        .sector_count = 3, // Same layout as init_flash() in main.c
+        .flash_device = dev,
+    };
+    struct flash_pages_info info;
+
+    if (!dut_provisioned) {
+        return 0;
+    }
+    if (!device_is_ready(dev) || flash_get_page_info_by_offs(dev, fs.offset, &info)) {
+        bs_trace_error_line("flash not ready\n");
+    }
+    fs.sector_size = info.size;
+    if (nvs_mount(&fs) || nvs_write(&fs, NVS_ID_DEVICE_INFO, &dut_info, sizeof(dut_info)) < 0) {
+        bs_trace_error_line("cannot provision device_info\n");
+    }
+    return 0;
+}
+
+SYS_INIT(dut_provision, APPLICATION, 0);
+
+// --- Verdict at the end of the simulation ---
+
+// One line per probe with samples: median and maximum bucket bounds in microseconds
+static void dut_print_profile(void) {
+    uint64_t hz = platform_cycles_per_sec();
+    for (int probe = 0; probe < PROF_PROBE_COUNT; probe++) {
+        const prof_histogram_t *h = prof_histogram((prof_probe_t)probe);
+        if (!h->count) {
+            continue;
+        }
+        printk("PROFILE %s %s n=%u p50_us<%llu max_us=%llu\n", dut_role, prof_probe_name((prof_probe_t)probe),
+               h->count, (1ull << prof_percentile_bucket((prof_probe_t)probe, 50)) * 1000000 / hz,
+               (uint64_t)h->max * 1000000 / hz);
+    }
+}
+
+static void dut_delete(void) {
+    if (dut_role) {
+        dut_print_profile();
+    }
+    bst_result = bsim_expect_report(dut_role, pin_expect, pin_expect_count) ? Passed : Failed;
+}
+
+static const struct bst_test_instance dut_tests[] = {
+    {
+        .test_id = "aura",
+        .test_descr = "Firmware in MODE_AURA",
+        .test_args_f = dut_args_aura,
+        .test_delete_f = dut_delete,
+    },
+    {
+        .test_id = "device",
+        .test_descr = "Firmware in MODE_DEVICE, expect= checks the output pin",
+        .test_args_f = dut_args_device,
+        .test_delete_f = dut_delete,
+    },
+    {
+        .test_id = "token",
+        .test_descr = "Firmware in MODE_LVLUP_TOKEN",
+        .test_args_f = dut_args_token,
+        .test_delete_f = dut_delete,
+    },
+    {
+        .test_id = "overseer",
+        .test_descr = "Firmware in MODE_OVERSEER",
+        .test_args_f = dut_args_overseer,
+        .test_delete_f = dut_delete,
+    },
+    BSTEST_END_MARKER
+};
+
+static struct bst_test_list *dut_install(struct bst_test_list *tests) {
+    return bst_add_tests(tests, dut_tests);
+}
+
+bst_test_install_t test_installers[] = { dut_install, NULL };
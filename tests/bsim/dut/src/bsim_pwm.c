@@ -0,0 +1,34 @@
+/* bsim_pwm.c - PWM controller stub for the LED aliases on nrf52_bsim */
+
+/*
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// nrf52_bsim has no PWM peripheral model. LEDManager.c only needs pwm_set_dt()
+// to succeed, so the LED aliases point at this controller (see the board overlay).
+
+#define DT_DRV_COMPAT aura_mesh_bsim_pwm
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/pwm.h>
+
+static int bsim_pwm_set_cycles(const struct device *dev, uint32_t channel, uint32_t period_cycles,
+                               uint32_t pulse_cycles, pwm_flags_t flags) {
+    return 0;
+}
+
+static int bsim_pwm_get_cycles_per_sec(const struct device *dev, uint32_t channel, uint64_t *cycles) {
+    *cycles = 1000000; // 1 MHz, any rate works for a stub
+    return 0;
+}
+
+static const struct pwm_driver_api bsim_pwm_api = {
+    .set_cycles = bsim_pwm_set_cycles,
+    .get_cycles_per_sec = bsim_pwm_get_cycles_per_sec,
+};
+
+#define BSIM_PWM_DEFINE(n) \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, NULL, NULL, POST_KERNEL, CONFIG_PWM_INIT_PRIORITY, &bsim_pwm_api);
+
+DT_INST_FOREACH_STATUS_OKAY(BSIM_PWM_DEFINE)
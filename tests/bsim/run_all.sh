@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# Run every scenario, print its LATENCY lines and exit non-zero if any
+# expectation failed: the regression gate for timing changes.
+# Logs go to ${BUILD_DIR}/<scenario>.log.
+
+source "$(dirname "${BASH_SOURCE[0]}")/_env.sh"
+mkdir -p ${BUILD_DIR}
+
+failed=0
+for scenario in ${BSIM_TESTS_DIR}/scenarios/*.sh; do
+    name=$(basename ${scenario} .sh)
+    log=${BUILD_DIR}/${name}.log
+    if ${scenario} > ${log} 2>&1; then
+        echo "${name}: PASS"
+    else
+        echo "${name}: FAIL (${log})"
+        failed=$((failed + 1))
+    fi
+    grep -o "LATENCY .*" ${log} | sed 's/^/    /'
+done
+exit ${failed}
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# A Magic level 1 device and a Magic level 2 aura share a room; the device is
+# on. At 30 s a Techno hostile-environment aura (level 4) walks in: the device
+# must switch off within a few cycles, and the Magic aura must go inactive on
+# air once HOSTILE_ENVIRONMENT_TRESHOLD cycles have passed.
+
+simulation_id="aura_mesh_hostile_aura"
+source "$(dirname "${BASH_SOURCE[0]}")/../_env.sh"
+
+BOOT_BUDGET_MS=25000 # Boot and the first cycles; the mode-change animation no longer holds the radio
+SUPPRESS_BUDGET_MS=12000
+INACTIVE_BUDGET_MS=85000 # 20 cycles of 3.5 s, plus slack
+
+att=$(att_file "0 1 ${ATT_NEAR}" "0 2 ${ATT_NEAR}" "1 2 ${ATT_NEAR}")
+
+Execute ${DUT_EXE} -v=${verbosity_level} -s=${simulation_id} -d=0 -testid=device \
+    -argstest affinity=1 level=1 expect=0,1,${BOOT_BUDGET_MS} expect=30000,0,${SUPPRESS_BUDGET_MS}
+Execute ${DUT_EXE} -v=${verbosity_level} -s=${simulation_id} -d=1 -testid=aura \
+    -argstest affinity=1 level=2
+# The hostile aura also watches the Magic aura's MESH advert (mode 1) on air
+Execute ${ACTOR_EXE} -v=${verbosity_level} -s=${simulation_id} -d=2 -testid=aura \
+    -argstest affinity=2 level=4 on=30000 watch=1 expect=30000,0,${INACTIVE_BUDGET_MS}
+run_phy 3 130 ${att}
+
+wait_for_background_jobs
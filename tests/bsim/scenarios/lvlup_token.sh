@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# A charged Magic level 2 token; at 20 s a Magic level 1 aura is held against
+# it (above LVLUP_TOKEN_RSSI_THRESHOLD). The token must address a MASTER advert
+# to that aura within the budget.
+
+simulation_id="aura_mesh_lvlup_token"
+source "$(dirname "${BASH_SOURCE[0]}")/../_env.sh"
+
+HANDOFF_BUDGET_MS=6000
+
+att=$(att_file "0 1 ${ATT_TOUCH}")
+
+Execute ${DUT_EXE} -v=${verbosity_level} -s=${simulation_id} -d=0 -testid=token \
+    -argstest affinity=1 level=2
+Execute ${ACTOR_EXE} -v=${verbosity_level} -s=${simulation_id} -d=1 -testid=aura \
+    -argstest affinity=1 level=1 on=20000 master=${HANDOFF_BUDGET_MS}
+run_phy 2 40 ${att}
+
+wait_for_background_jobs
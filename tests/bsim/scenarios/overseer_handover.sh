@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# A Magic level 1 device in zone 1 with no auras around. Overseer A commands
+# it on (states 0x02: Magic level 1) from 5 s; at 50 s A goes silent and a
+# stronger overseer B, commanding off, takes over the zone. The device must
+# adopt A within OVERSEER_DETECTION_THRESHOLD cycles and follow B promptly.
+
+simulation_id="aura_mesh_overseer_handover"
+source "$(dirname "${BASH_SOURCE[0]}")/../_env.sh"
+
+ADOPT_BUDGET_MS=20000
+HANDOVER_BUDGET_MS=8000
+
+att=$(att_file "0 1 $((ATT_NEAR + 2))" "0 2 $((ATT_NEAR - 4))")
+
+Execute ${DUT_EXE} -v=${verbosity_level} -s=${simulation_id} -d=0 -testid=device \
+    -argstest affinity=1 level=1 zone=1 expect=5000,1,${ADOPT_BUDGET_MS} expect=50000,0,${HANDOVER_BUDGET_MS}
+Execute ${ACTOR_EXE} -v=${verbosity_level} -s=${simulation_id} -d=1 -testid=overseer \
+    -argstest zone=1 states=0x02 on=5000 off=50000
+Execute ${ACTOR_EXE} -v=${verbosity_level} -s=${simulation_id} -d=2 -testid=overseer \
+    -argstest zone=1 states=0x00 on=50000
+run_phy 3 80 ${att}
+
+wait_for_background_jobs
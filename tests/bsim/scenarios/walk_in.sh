@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# A Magic level 1 aura walks into a Magic level 1 device's range at 20 s and
+# leaves at 60 s. The device output must switch on, then off, within the budgets
+# (PEER_DETECTION_THRESHOLD / PEER_MISS_THRESHOLD cycles plus one cycle of slack).
+
+simulation_id="aura_mesh_walk_in"
+source "$(dirname "${BASH_SOURCE[0]}")/../_env.sh"
+
+ON_BUDGET_MS=12000
+OFF_BUDGET_MS=14000
+
+att=$(att_file "0 1 ${ATT_NEAR}")
+
+Execute ${DUT_EXE} -v=${verbosity_level} -s=${simulation_id} -d=0 -testid=device \
+    -argstest affinity=1 level=1 expect=20000,1,${ON_BUDGET_MS} expect=60000,0,${OFF_BUDGET_MS}
+Execute ${ACTOR_EXE} -v=${verbosity_level} -s=${simulation_id} -d=1 -testid=aura \
+    -argstest affinity=1 level=1 on=20000 off=60000
+run_phy 2 90 ${att}
+
+wait_for_background_jobs